@@ -0,0 +1,23 @@
+// -----------------------------
+//  NATIVE ADDON LOADER
+// -----------------------------
+// Loads the in-process lexer and parser built by `npm run build:addon`. A module that
+// is missing or was built for another Node version is reported as null, and callers
+// fall back to spawning the binaries.
+
+const { addonPath } = require('../tools/build');
+
+function load(name) {
+  const file = addonPath(name);
+  try {
+    return { file, ...require(file) };
+  } catch (err) {
+    if (err.code !== 'MODULE_NOT_FOUND') console.error(`[addon] could not load ${file}: ${err.message}`);
+    return null;
+  }
+}
+
+module.exports = {
+  lexer: load('lexer'),
+  parser: load('parser'),
+};
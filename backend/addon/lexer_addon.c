@@ -0,0 +1,274 @@
+/* ========== LEXER NODE ADDON ========== */
+/* Node-API module that runs the lexer inside the server process, on the libuv thread pool.
+   Build with `npm run build:addon`; loaded through addon/index.js.
+
+     lex(code, { columns, table }) -> Promise<{ output, tokens }>
+
+   code is a string or a Buffer. output is the token table the lexer binary prints (with
+   --columns when columns is set, omitted when table is false). tokens holds one typed
+   array per field: types (Uint8Array, indexes into tokenTypeNames), offsets and lengths
+   (Uint32Array, UTF-8 byte offsets as in --emit-tokens), lines and, with columns, columns. */
+
+#define CNACK_NO_MAIN
+#include "../lexer.c"
+
+#include <node_api.h>
+
+typedef struct
+{
+    char *source;  /* NUL-terminated copy of the input */
+    int columns;   /* --columns */
+    int table;     /* Format the token table */
+    TokenList list;
+    uint32_t *token_columns;
+    OutputBuffer out;
+    int ok;
+    napi_deferred deferred;
+    napi_async_work work;
+} LexRequest;
+
+/* ========== WORKER THREAD ========== */
+
+/* Runs on a libuv pool thread: everything here is this thread's lexer state */
+static void executeLex(napi_env env, void *data)
+{
+    (void)env;
+    LexRequest *request = (LexRequest *)data;
+    TokenList *list = &request->list;
+
+    memset(&stats, 0, sizeof(stats));
+    lazy_lines = request->columns;
+    request->ok = tokenizeCode(request->source, list);
+    if (request->ok && request->table)
+    {
+        emitTarget = &request->out;
+        printTokenTable(list);
+        emitTarget = NULL;
+    }
+
+    /* Resolve lazy lines here, so the main thread only wraps the arrays */
+    if (request->ok && list->line_starts)
+    {
+        request->token_columns = (uint32_t *)malloc((size_t)list->count * sizeof(uint32_t));
+        request->ok = request->token_columns != NULL;
+        for (int i = 0; request->ok && i < list->count; i++)
+        {
+            Token t = tokenAt(list, i);
+            list->lines[i] = (uint32_t)t.line;
+            request->token_columns[i] = (uint32_t)t.column;
+        }
+    }
+    free(list->line_starts);
+    list->line_starts = NULL;
+    lazy_lines = 0;
+}
+
+/* ========== MAIN THREAD ========== */
+
+static void freeBlock(napi_env env, void *data, void *hint)
+{
+    (void)env;
+    (void)hint;
+    free(data);
+}
+
+/* Hand a malloc'd block to JavaScript, copying it only where external buffers are not allowed */
+static napi_status wrapBlock(napi_env env, void *block, size_t bytes, napi_value *result)
+{
+    napi_status status = napi_create_external_arraybuffer(env, block, bytes, freeBlock, NULL, result);
+    if (status == napi_ok)
+        return napi_ok;
+
+    void *copy;
+    status = napi_create_arraybuffer(env, bytes, &copy, result);
+    if (status == napi_ok)
+        memcpy(copy, block, bytes);
+    free(block);
+    return status;
+}
+
+static napi_status setArray(napi_env env, napi_value object, const char *name, napi_typedarray_type type,
+                            size_t length, napi_value buffer, size_t offset)
+{
+    napi_value array;
+    napi_status status = napi_create_typedarray(env, type, length, buffer, offset, &array);
+    return status == napi_ok ? napi_set_named_property(env, object, name, array) : status;
+}
+
+/* The four token arrays share one block (offsets|lengths|lines|types), so they become views of one ArrayBuffer */
+static napi_status tokenArrays(napi_env env, LexRequest *request, napi_value *result)
+{
+    TokenList *list = &request->list;
+    size_t capacity = (size_t)list->capacity;
+    napi_value block, count;
+    napi_status status;
+
+    if ((status = napi_create_object(env, result)) != napi_ok ||
+        (status = napi_create_uint32(env, (uint32_t)list->count, &count)) != napi_ok ||
+        (status = napi_set_named_property(env, *result, "count", count)) != napi_ok)
+        return status;
+
+    status = wrapBlock(env, list->offsets, capacity * (3 * sizeof(uint32_t) + sizeof(uint8_t)), &block);
+    list->offsets = NULL; /* Owned by the ArrayBuffer now */
+    if (status != napi_ok ||
+        (status = setArray(env, *result, "offsets", napi_uint32_array, list->count, block, 0)) != napi_ok ||
+        (status = setArray(env, *result, "lengths", napi_uint32_array, list->count, block, capacity * 4)) != napi_ok ||
+        (status = setArray(env, *result, "lines", napi_uint32_array, list->count, block, capacity * 8)) != napi_ok ||
+        (status = setArray(env, *result, "types", napi_uint8_array, list->count, block, capacity * 12)) != napi_ok)
+        return status;
+
+    if (request->token_columns)
+    {
+        status = wrapBlock(env, request->token_columns, (size_t)list->count * sizeof(uint32_t), &block);
+        request->token_columns = NULL;
+        if (status != napi_ok ||
+            (status = setArray(env, *result, "columns", napi_uint32_array, list->count, block, 0)) != napi_ok)
+            return status;
+    }
+    return napi_ok;
+}
+
+static napi_status lexResult(napi_env env, LexRequest *request, napi_value *result)
+{
+    napi_value tokens, output;
+    napi_status status;
+    if ((status = napi_create_object(env, result)) != napi_ok ||
+        (status = tokenArrays(env, request, &tokens)) != napi_ok ||
+        (status = napi_set_named_property(env, *result, "tokens", tokens)) != napi_ok)
+        return status;
+    if (request->table)
+    {
+        if ((status = napi_create_string_utf8(env, request->out.data ? request->out.data : "", request->out.length, &output)) != napi_ok ||
+            (status = napi_set_named_property(env, *result, "output", output)) != napi_ok)
+            return status;
+    }
+    return napi_ok;
+}
+
+static void rejectWith(napi_env env, napi_deferred deferred, const char *message)
+{
+    napi_value text, error;
+    napi_create_string_utf8(env, message, NAPI_AUTO_LENGTH, &text);
+    napi_create_error(env, NULL, text, &error);
+    napi_reject_deferred(env, deferred, error);
+}
+
+static void completeLex(napi_env env, napi_status status, void *data)
+{
+    LexRequest *request = (LexRequest *)data;
+    napi_value result;
+
+    if (status != napi_ok)
+        rejectWith(env, request->deferred, "Lexing was cancelled");
+    else if (!request->ok)
+        rejectWith(env, request->deferred, "Memory allocation failed");
+    else if (lexResult(env, request, &result) != napi_ok)
+        rejectWith(env, request->deferred, "Could not build the lexer result");
+    else
+        napi_resolve_deferred(env, request->deferred, result);
+
+    napi_delete_async_work(env, request->work);
+    freeTokens(&request->list);
+    free(request->token_columns);
+    free(request->out.data);
+    free(request->source);
+    free(request);
+}
+
+/* Copy a string or Buffer argument into a NUL-terminated buffer */
+static char *sourceArgument(napi_env env, napi_value value)
+{
+    bool is_buffer = false;
+    char *source = NULL;
+    size_t length = 0;
+
+    napi_is_buffer(env, value, &is_buffer);
+    if (is_buffer)
+    {
+        void *data;
+        if (napi_get_buffer_info(env, value, &data, &length) != napi_ok)
+            return NULL;
+        source = (char *)malloc(length + 1);
+        if (source != NULL)
+        {
+            memcpy(source, data, length);
+            source[length] = '\0';
+        }
+        return source;
+    }
+
+    if (napi_get_value_string_utf8(env, value, NULL, 0, &length) != napi_ok)
+        return NULL;
+    source = (char *)malloc(length + 1);
+    if (source != NULL)
+        napi_get_value_string_utf8(env, value, source, length + 1, &length);
+    return source;
+}
+
+/* Read a boolean option; missing or undefined options keep their default */
+static int flagOption(napi_env env, napi_value options, const char *name, int fallback)
+{
+    bool has = false, flag = false;
+    napi_value value;
+    napi_valuetype type;
+    if (options == NULL || napi_has_named_property(env, options, name, &has) != napi_ok || !has)
+        return fallback;
+    napi_get_named_property(env, options, name, &value);
+    napi_typeof(env, value, &type);
+    if (type == napi_undefined)
+        return fallback;
+    napi_coerce_to_bool(env, value, &value);
+    napi_get_value_bool(env, value, &flag);
+    return flag ? 1 : 0;
+}
+
+static napi_value lex(napi_env env, napi_callback_info info)
+{
+    size_t argc = 2;
+    napi_value argv[2], promise, name;
+    napi_valuetype type = napi_undefined;
+
+    napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    if (argc > 1)
+        napi_typeof(env, argv[1], &type);
+
+    LexRequest *request = (LexRequest *)calloc(1, sizeof(LexRequest));
+    if (request == NULL)
+    {
+        napi_throw_error(env, NULL, "Memory allocation failed");
+        return NULL;
+    }
+    request->source = argc > 0 ? sourceArgument(env, argv[0]) : NULL;
+    if (request->source == NULL)
+    {
+        free(request);
+        napi_throw_type_error(env, NULL, "lex() expects the source as a string or Buffer");
+        return NULL;
+    }
+    request->columns = flagOption(env, type == napi_object ? argv[1] : NULL, "columns", 0);
+    request->table = flagOption(env, type == napi_object ? argv[1] : NULL, "table", 1);
+
+    napi_create_promise(env, &request->deferred, &promise);
+    napi_create_string_utf8(env, "cnack.lex", NAPI_AUTO_LENGTH, &name);
+    napi_create_async_work(env, NULL, name, executeLex, completeLex, request, &request->work);
+    napi_queue_async_work(env, request->work);
+    return promise;
+}
+
+static napi_value init(napi_env env, napi_value exports)
+{
+    napi_value fn, names, text;
+    napi_create_function(env, "lex", NAPI_AUTO_LENGTH, lex, NULL, &fn);
+    napi_set_named_property(env, exports, "lex", fn);
+
+    napi_create_array_with_length(env, TOKEN_EOF + 1, &names);
+    for (int i = 0; i <= TOKEN_EOF; i++)
+    {
+        napi_create_string_utf8(env, getTokenTypeName((TokenType)i), NAPI_AUTO_LENGTH, &text);
+        napi_set_element(env, names, (uint32_t)i, text);
+    }
+    napi_set_named_property(env, exports, "tokenTypeNames", names);
+    return exports;
+}
+
+NAPI_MODULE(cnack_lexer, init)
@@ -0,0 +1,182 @@
+/* ========== PARSER NODE ADDON ========== */
+/* Node-API module that parses and runs a program inside the server process, on the libuv
+   thread pool. Build with `npm run build:addon`; loaded through addon/index.js.
+
+     parse(code) -> Promise<{ success, output, diagnostics }>
+
+   output is exactly what the parser binary prints for the program on stdin. diagnostics
+   lists its "[Kind] Line N: message" reports as { kind, line, message } objects.
+   Parse caching (--cache) stays with the binary. */
+
+#define CNACK_NO_MAIN
+#include "../parser.c"
+
+#include <node_api.h>
+
+typedef struct
+{
+    BatchJob job; /* source is the NUL-terminated input, out the program's output */
+    napi_deferred deferred;
+    napi_async_work work;
+} ParseRequest;
+
+/* ========== WORKER THREAD ========== */
+
+/* Runs on a libuv pool thread, with that thread's parser state; parseJob() resets it */
+static void executeParse(napi_env env, void *data)
+{
+    (void)env;
+    ParseRequest *request = (ParseRequest *)data;
+    memset(&stats, 0, sizeof(stats));
+    parseJob(&request->job);
+
+    /* NUL-terminate the output for the diagnostic scan */
+    if (appendOutput(&request->job.out, "", 1))
+        request->job.out.length--;
+}
+
+/* ========== MAIN THREAD ========== */
+
+static napi_status setString(napi_env env, napi_value object, const char *name, const char *text, size_t length)
+{
+    napi_value value;
+    napi_status status = napi_create_string_utf8(env, text, length, &value);
+    return status == napi_ok ? napi_set_named_property(env, object, name, value) : status;
+}
+
+/* One { kind, line, message } per "[Kind] Line N: message" line before the summary */
+static napi_status diagnosticList(napi_env env, const char *text, size_t length, napi_value *result)
+{
+    static const char summary[] = ">>> SYNTAX ANALYSIS";
+    napi_status status = napi_create_array(env, result);
+    const char *end = text + length;
+
+    uint32_t count = 0;
+    for (const char *line = text; status == napi_ok && line < end;)
+    {
+        const char *eol = memchr(line, '\n', (size_t)(end - line));
+        if (eol == NULL)
+            eol = end;
+        if ((size_t)(eol - line) >= sizeof(summary) - 1 && memcmp(line, summary, sizeof(summary) - 1) == 0)
+            break; /* Program output follows the summary */
+
+        const char *close = line[0] == '[' ? memchr(line, ']', (size_t)(eol - line)) : NULL;
+        int number = 0, consumed = 0;
+        if (close != NULL && sscanf(close + 1, " Line %d: %n", &number, &consumed) == 1 && consumed > 0 &&
+            close + 1 + consumed <= eol)
+        {
+            const char *message = close + 1 + consumed;
+            napi_value diagnostic, value;
+            if ((status = napi_create_object(env, &diagnostic)) == napi_ok &&
+                (status = setString(env, diagnostic, "kind", line + 1, (size_t)(close - line - 1))) == napi_ok &&
+                (status = napi_create_int32(env, number, &value)) == napi_ok &&
+                (status = napi_set_named_property(env, diagnostic, "line", value)) == napi_ok &&
+                (status = setString(env, diagnostic, "message", message, (size_t)(eol - message))) == napi_ok)
+                status = napi_set_element(env, *result, count++, diagnostic);
+        }
+        line = eol + 1;
+    }
+    return status;
+}
+
+static napi_status parseResult(napi_env env, BatchJob *job, napi_value *result)
+{
+    const char *text = job->out.data ? job->out.data : "";
+    napi_value flag, diagnostics;
+    napi_status status;
+    if ((status = napi_create_object(env, result)) != napi_ok ||
+        (status = napi_get_boolean(env, job->status == 0, &flag)) != napi_ok ||
+        (status = napi_set_named_property(env, *result, "success", flag)) != napi_ok ||
+        (status = setString(env, *result, "output", text, job->out.length)) != napi_ok ||
+        (status = diagnosticList(env, text, job->out.length, &diagnostics)) != napi_ok)
+        return status;
+    return napi_set_named_property(env, *result, "diagnostics", diagnostics);
+}
+
+static void completeParse(napi_env env, napi_status status, void *data)
+{
+    ParseRequest *request = (ParseRequest *)data;
+    napi_value result, text, error;
+
+    if (status == napi_ok && parseResult(env, &request->job, &result) == napi_ok)
+        napi_resolve_deferred(env, request->deferred, result);
+    else
+    {
+        napi_create_string_utf8(env, status == napi_ok ? "Could not build the parser result" : "Parsing was cancelled",
+                                NAPI_AUTO_LENGTH, &text);
+        napi_create_error(env, NULL, text, &error);
+        napi_reject_deferred(env, request->deferred, error);
+    }
+
+    napi_delete_async_work(env, request->work);
+    free(request->job.out.data);
+    free(request->job.source);
+    free(request);
+}
+
+/* Copy a string or Buffer argument into a NUL-terminated buffer */
+static char *sourceArgument(napi_env env, napi_value value, size_t *length)
+{
+    bool is_buffer = false;
+    char *source = NULL;
+
+    napi_is_buffer(env, value, &is_buffer);
+    if (is_buffer)
+    {
+        void *data;
+        if (napi_get_buffer_info(env, value, &data, length) != napi_ok)
+            return NULL;
+        source = (char *)malloc(*length + 1);
+        if (source != NULL)
+        {
+            memcpy(source, data, *length);
+            source[*length] = '\0';
+        }
+        return source;
+    }
+
+    if (napi_get_value_string_utf8(env, value, NULL, 0, length) != napi_ok)
+        return NULL;
+    source = (char *)malloc(*length + 1);
+    if (source != NULL)
+        napi_get_value_string_utf8(env, value, source, *length + 1, length);
+    return source;
+}
+
+static napi_value parse(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value argv[1], promise, name;
+    napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+
+    ParseRequest *request = (ParseRequest *)calloc(1, sizeof(ParseRequest));
+    if (request == NULL)
+    {
+        napi_throw_error(env, NULL, "Memory allocation failed");
+        return NULL;
+    }
+    request->job.path = "<input>";
+    request->job.source = argc > 0 ? sourceArgument(env, argv[0], &request->job.size) : NULL;
+    if (request->job.source == NULL)
+    {
+        free(request);
+        napi_throw_type_error(env, NULL, "parse() expects the source as a string or Buffer");
+        return NULL;
+    }
+
+    napi_create_promise(env, &request->deferred, &promise);
+    napi_create_string_utf8(env, "cnack.parse", NAPI_AUTO_LENGTH, &name);
+    napi_create_async_work(env, NULL, name, executeParse, completeParse, request, &request->work);
+    napi_queue_async_work(env, request->work);
+    return promise;
+}
+
+static napi_value init(napi_env env, napi_value exports)
+{
+    napi_value fn;
+    napi_create_function(env, "parse", NAPI_AUTO_LENGTH, parse, NULL, &fn);
+    napi_set_named_property(env, exports, "parse", fn);
+    return exports;
+}
+
+NAPI_MODULE(cnack_parser, init)
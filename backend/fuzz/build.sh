@@ -0,0 +1,25 @@
+#!/bin/sh
+# Build the fuzz targets.
+#   ./build.sh            clang + libFuzzer + ASan/UBSan  -> out/fuzz_lexer, out/fuzz_parser
+#   ./build.sh replay     gcc + ASan/UBSan replay drivers -> out/fuzz_lexer_replay, out/fuzz_parser_replay
+#
+# Run with the test programs as seed corpus, e.g.
+#   out/fuzz_parser -timeout=5 -max_len=4096 corpus/ ../../tests ../../tests/fuzz
+set -e
+cd "$(dirname "$0")"
+mkdir -p out corpus
+
+SANITIZE="-fsanitize=address,undefined -fno-sanitize-recover=undefined"
+
+if [ "$1" = "replay" ]; then
+    CC=${CC:-gcc}
+    for target in lexer parser; do
+        $CC -g -O1 $SANITIZE fuzz_$target.c standalone_main.c -o out/fuzz_${target}_replay -lm -pthread
+    done
+else
+    CC=${CC:-clang}
+    for target in lexer parser; do
+        $CC -g -O1 -fsanitize=fuzzer $SANITIZE fuzz_$target.c -o out/fuzz_$target -lm -pthread
+    done
+fi
+echo "Fuzz targets written to $(pwd)/out"
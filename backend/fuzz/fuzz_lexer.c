@@ -0,0 +1,31 @@
+/* ========== LEXER FUZZ TARGET ========== */
+/* libFuzzer entry point that runs the getNextToken loop over arbitrary bytes.
+   Build with fuzz/build.sh (clang + sanitizers) or the standalone driver (gcc). */
+
+#define CNACK_NO_MAIN
+#include "../lexer.c"
+
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size)
+{
+    /* The scanner expects a NUL-terminated source */
+    char *source = (char *)malloc(size + 1);
+    if (source == NULL)
+        return 0;
+    memcpy(source, data, size);
+    source[size] = '\0';
+
+    Token token;
+    unsigned checksum = 0;
+    initScanner(source);
+    do
+    {
+        token = getNextToken();
+
+        /* Touch every lexeme byte so out-of-bounds lexemes are caught by ASan */
+        for (int i = 0; i < token.lexeme_length; i++)
+            checksum += (unsigned char)token.lexeme_start[i];
+    } while (token.type != TOKEN_EOF);
+
+    free(source);
+    return (int)(checksum & 0);
+}
@@ -0,0 +1,30 @@
+/* ========== PARSER FUZZ TARGET ========== */
+/* libFuzzer entry point that parses and executes a whole program.
+   Program output is discarded; only crashes and sanitizer reports matter. */
+
+#define CNACK_NO_MAIN
+#include "../parser.c"
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    (void)argc;
+    (void)argv;
+    if (freopen("/dev/null", "w", stdout) == NULL)
+        return 0;
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size)
+{
+    char *source = (char *)malloc(size + 1);
+    if (source == NULL)
+        return 0;
+    memcpy(source, data, size);
+    source[size] = '\0';
+
+    resetParserState();
+    parseProgram(source);
+
+    free(source);
+    return 0;
+}
@@ -0,0 +1,37 @@
+/* ========== STANDALONE FUZZ DRIVER ========== */
+/* Replays files through LLVMFuzzerTestOneInput for toolchains without libFuzzer
+   (e.g. gcc -fsanitize=address). Usage: fuzz_parser_replay file... */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size);
+__attribute__((weak)) int LLVMFuzzerInitialize(int *argc, char ***argv);
+
+int main(int argc, char *argv[])
+{
+    if (LLVMFuzzerInitialize)
+        LLVMFuzzerInitialize(&argc, &argv);
+
+    for (int i = 1; i < argc; i++)
+    {
+        FILE *file = fopen(argv[i], "rb");
+        if (file == NULL)
+        {
+            fprintf(stderr, "Error: Cannot open %s\n", argv[i]);
+            return 1;
+        }
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        unsigned char *data = (unsigned char *)malloc(size > 0 ? size : 1);
+        size_t got = fread(data, 1, size, file);
+        fclose(file);
+
+        LLVMFuzzerTestOneInput(data, got);
+        free(data);
+        fprintf(stderr, "ok %s\n", argv[i]);
+    }
+    return 0;
+}
@@ -1,6 +1,26 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define CNACK_MMAP 1 /* token cache files are mapped */
+#endif
+#ifdef _WIN32
+#include <direct.h>
+#endif
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
 
 /* ========== TOKEN DEFINITIONS ========== */
 
@@ -115,10 +135,18 @@ typedef struct
     const char *lexeme_start; /* Start of lexeme in source */
     int lexeme_length;        /* Length of the lexeme */
     int line;                 /* Line of the code the lexeme is found */
+    int source_offset;        /* Offset of the scanned text in source (also for error tokens) */
+    int source_length;        /* Length of the scanned text in source */
+    int column;               /* Column of the first byte, from 1 (--columns only, else 0) */
 } Token;
 
+/* Lexeme of every error token; token lists store only its type and source span */
+#define INVALID_TOKEN_MESSAGE "Invalid token"
+
 /* ========== GLOBAL VARIABLES ========== */
 
+/* Per-analysis state is thread-local so batch workers (--jobs) can lex files side by side */
+
 /* Scanner state */
 typedef struct
 {
@@ -128,7 +156,7 @@ typedef struct
     int line_number;          /* Current line number */
 } Scanner;
 
-Scanner scanner;
+_Thread_local Scanner scanner;
 
 /* Keywords mapping structure */
 typedef struct
@@ -171,6 +199,120 @@ KeywordMapping keywords[] = {
     {"auto_ref", TOKEN_RW_AUTO_REF}};
 int keywordCount = 30;
 
+/* One block of an arena; allocations are carved from data[] front to back */
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *next; /* Older, smaller blocks */
+    size_t size;             /* Usable bytes in data[] */
+    size_t used;             /* Bytes handed out so far */
+    _Alignas(16) char data[];
+} ArenaBlock;
+
+/* Bump-pointer arena - everything allocated for one analysis is freed at once */
+typedef struct
+{
+    ArenaBlock *head; /* Block currently allocated from */
+} Arena;
+
+/*
+ * Token list - all tokens of one analysis, kept so lexing and printing can be timed separately.
+ * Stored as one array per field, 13 bytes per token instead of sizeof(Token), so a pass over
+ * the list only reads the fields it needs (counting types touches one byte per token).
+ * tokenAt() rebuilds a whole Token.
+ */
+typedef struct
+{
+    uint8_t *types;     /* TokenType of each token */
+    uint32_t *offsets;  /* Source offset of the scanned text */
+    uint32_t *lengths;  /* Length of the scanned text */
+    uint32_t *lines;    /* Line of the token */
+    const char *source; /* Source the offsets refer to */
+    uint32_t *line_starts; /* Offset of every line (--columns); lines[] is not filled then */
+    int line_count;
+    int count;          /* Number of tokens stored */
+    int capacity;       /* Allocated slots */
+    Arena *arena;       /* Allocate inside this arena, or with malloc when NULL */
+} TokenList;
+
+/* Instrumentation collected when --stats is given */
+typedef struct
+{
+    int enabled;                        /* Collect and report statistics */
+    int json;                           /* Report as JSON instead of text */
+    size_t input_bytes;                 /* Bytes read from stdin */
+    double read_time;                   /* Seconds spent reading input */
+    double lex_time;                    /* Seconds spent scanning tokens */
+    double format_time;                 /* Seconds spent printing the token table */
+    long tokens_by_type[TOKEN_EOF + 1]; /* Tokens produced per token type */
+    long keyword_probes;                /* Keyword table entries compared */
+    long output_bytes;                  /* Bytes written to stdout */
+    long reused_tokens;                 /* Tokens kept from the previous stream (--incremental) */
+    long cache_hits;                    /* Sources whose tokens were loaded from --cache-dir */
+} Stats;
+
+_Thread_local Stats stats;
+
+/* --columns: the scanner only tracks offsets, lines and columns come from a line index.
+   Per thread, so in-process callers can choose per analysis; worker threads copy it. */
+_Thread_local int lazy_lines = 0;
+
+/* --semantic-tokens: print highlighting data instead of the token table */
+_Thread_local int semantic_tokens = 0;
+
+/* ========== ARENA ALLOCATOR ========== */
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGN 16
+
+/* Allocate from the arena; returns NULL when memory runs out */
+void *arenaAlloc(Arena *arena, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    ArenaBlock *block = arena->head;
+    if (block == NULL || block->size - block->used < size)
+    {
+        /* Blocks double so a large analysis needs only a few of them */
+        size_t blockSize = block ? block->size * 2 : ARENA_BLOCK_SIZE;
+        if (blockSize < size)
+            blockSize = size;
+        block = (ArenaBlock *)malloc(sizeof(ArenaBlock) + blockSize);
+        if (block == NULL)
+            return NULL;
+        block->next = arena->head;
+        block->size = blockSize;
+        block->used = 0;
+        arena->head = block;
+    }
+    void *p = block->data + block->used;
+    block->used += size;
+    return p;
+}
+
+/* Forget every allocation but keep the largest block, so reuse costs no malloc */
+void arenaReset(Arena *arena)
+{
+    ArenaBlock *keep = arena->head;
+    if (keep == NULL)
+        return;
+    ArenaBlock *block = keep->next;
+    while (block != NULL)
+    {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    keep->next = NULL;
+    keep->used = 0;
+}
+
+/* Free all blocks */
+void arenaRelease(Arena *arena)
+{
+    arenaReset(arena);
+    free(arena->head);
+    arena->head = NULL;
+}
+
 /* ========== CHARACTER UTILITY FUNCTIONS ========== */
 
 int isLetter(char c)
@@ -289,6 +431,9 @@ Token createToken(TokenType type)
     tok.lexeme_start = scanner.token_start;
     tok.lexeme_length = (int)(scanner.scan_ptr - scanner.token_start);
     tok.line = scanner.line_number;
+    tok.source_offset = (int)(scanner.token_start - scanner.source_start);
+    tok.source_length = (int)(scanner.scan_ptr - scanner.token_start);
+    tok.column = 0;
     return tok;
 }
 
@@ -300,6 +445,9 @@ Token createErrorToken(const char *message)
     tok.lexeme_start = message;
     tok.lexeme_length = (int)strlen(message);
     tok.line = scanner.line_number;
+    tok.source_offset = (int)(scanner.token_start - scanner.source_start);
+    tok.source_length = (int)(scanner.scan_ptr - scanner.token_start);
+    tok.column = 0;
     return tok;
 }
 
@@ -315,7 +463,7 @@ Token checkOperatorBoundary(TokenType operatorType)
         {
             consumeChar();
         }
-        return createErrorToken("Invalid token");
+        return createErrorToken(INVALID_TOKEN_MESSAGE);
     }
     /* Operator is properly separated, return valid token */
     return createToken(operatorType);
@@ -327,6 +475,7 @@ TokenType getKeywordType(const char *str, int length)
 {
     for (int i = 0; i < keywordCount; i++)
     {
+        stats.keyword_probes++;
         if (strlen(keywords[i].keyword) == length &&
             memcmp(str, keywords[i].keyword, length) == 0)
         {
@@ -519,6 +668,70 @@ const char *getTokenTypeName(TokenType type)
     }
 }
 
+/* ========== OUTPUT FUNCTIONS ========== */
+
+/* Current time in seconds, used for the --stats phase timings */
+double nowSeconds()
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Growable output buffer, used to frame each file's output in batch mode */
+typedef struct
+{
+    char *data;
+    size_t length;
+    size_t capacity;
+} OutputBuffer;
+
+/* Where emit() writes: stdout when NULL */
+_Thread_local OutputBuffer *emitTarget = NULL;
+
+/* Append formatted text to an output buffer; returns the length or -1 */
+int bufferPrintf(OutputBuffer *out, const char *format, va_list args)
+{
+    va_list again;
+    va_copy(again, args);
+
+    /* Format straight into the spare capacity; only a line that does not fit is formatted twice */
+    size_t spare = out->capacity - out->length;
+    int needed = vsnprintf(out->data ? out->data + out->length : NULL, spare, format, args);
+    if (needed >= 0 && (size_t)needed >= spare)
+    {
+        size_t capacity = (out->length + needed + 1) * 2;
+        char *data = (char *)realloc(out->data, capacity);
+        if (data == NULL)
+            needed = -1;
+        else
+        {
+            out->data = data;
+            out->capacity = capacity;
+            vsnprintf(out->data + out->length, needed + 1, format, again);
+        }
+    }
+    if (needed >= 0)
+        out->length += needed;
+    va_end(again);
+    return needed;
+}
+
+/* printf to stdout (or the batch output buffer), counting the bytes written */
+int emit(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int written = emitTarget ? bufferPrintf(emitTarget, format, args) : vprintf(format, args);
+    va_end(args);
+    if (written > 0)
+        stats.output_bytes += written;
+    return written;
+}
+
+/* Scratch memory for one printed token; reset after every line */
+_Thread_local Arena scratch;
+
 /* Print token to both stdout and file */
 void printTokenToFile(Token t, FILE *file)
 {
@@ -528,7 +741,7 @@ void printTokenToFile(Token t, FILE *file)
     if (t.type == TOKEN_MULTI_COMMENT || t.type == TOKEN_STRING)
     {
         /* Allocate buffer for cleaned lexeme */
-        char *cleaned = (char *)malloc(t.lexeme_length + 1);
+        char *cleaned = (char *)arenaAlloc(&scratch, t.lexeme_length + 1);
         if (cleaned)
         {
             /* Copy lexeme and replace newlines/tabs with spaces */
@@ -543,15 +756,21 @@ void printTokenToFile(Token t, FILE *file)
             cleaned[t.lexeme_length] = '\0';
 
             /* Print with cleaned lexeme */
-            printf("%-6d | %-20s | %s\n", t.line, tokenTypeName, cleaned);
+            if (t.column > 0)
+                emit("%-6d | %-6d | %-20s | %s\n", t.line, t.column, tokenTypeName, cleaned);
+            else
+                emit("%-6d | %-20s | %s\n", t.line, tokenTypeName, cleaned);
 
-            free(cleaned);
+            arenaReset(&scratch);
         }
     }
     else
     {
         /* Normal printing for other tokens */
-        printf("%-6d | %-20s | %.*s\n", t.line, tokenTypeName, t.lexeme_length, t.lexeme_start);
+        if (t.column > 0)
+            emit("%-6d | %-6d | %-20s | %.*s\n", t.line, t.column, tokenTypeName, t.lexeme_length, t.lexeme_start);
+        else
+            emit("%-6d | %-20s | %.*s\n", t.line, tokenTypeName, t.lexeme_length, t.lexeme_start);
     }
 }
 
@@ -568,6 +787,57 @@ void resetScanner()
     scanner.line_number = 1;
 }
 
+/* ========== LINE INDEX ========== */
+
+/*
+ * With --columns the scanner does not count lines. The offsets of all line starts are
+ * collected once per source with memchr (vectorized in libc), and a token's line and column
+ * are found by binary search when it is printed.
+ */
+
+/* Record where every line of list->source starts; returns 0 if memory runs out */
+int buildLineIndex(TokenList *list)
+{
+    const char *source = list->source;
+    size_t length = strlen(source);
+    int count = 1;
+    for (const char *p = source; (p = memchr(p, '\n', source + length - p)) != NULL; p++)
+        count++;
+
+    size_t bytes = (size_t)count * sizeof(uint32_t);
+    uint32_t *starts = list->arena ? (uint32_t *)arenaAlloc(list->arena, bytes) : (uint32_t *)malloc(bytes);
+    if (starts == NULL)
+        return 0;
+    starts[0] = 0;
+    int n = 1;
+    for (const char *p = source; (p = memchr(p, '\n', source + length - p)) != NULL; p++)
+        starts[n++] = (uint32_t)(p - source + 1);
+    list->line_starts = starts;
+    list->line_count = count;
+    return 1;
+}
+
+/* Line (from 1) that contains offset: the number of line starts at or before it */
+uint32_t lineAt(const TokenList *list, uint32_t offset)
+{
+    int low = 0, high = list->line_count;
+    while (low < high)
+    {
+        int mid = (low + high) / 2;
+        if (list->line_starts[mid] <= offset)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return (uint32_t)low;
+}
+
+/* Line of token i. The scanner reports the line a token ends on (strings and comments may span lines) */
+uint32_t tokenLine(const TokenList *list, int i)
+{
+    return list->line_starts ? lineAt(list, list->offsets[i] + list->lengths[i]) : list->lines[i];
+}
+
 /* ========== LEXICAL ANALYZER ========== */
 
 /* Skip all whitespace and track line numbers */
@@ -582,7 +852,8 @@ void skipWhitespaceAndNewlines()
         }
         else if (c == '\n')
         {
-            scanner.line_number++;
+            if (!lazy_lines)
+                scanner.line_number++;
             consumeChar();
         }
         else
@@ -611,7 +882,7 @@ Token scanIdentifier()
         currentChar() == '*')
     {
         consumeChar(); /* consume the * */
-        return createErrorToken("Invalid token");
+        return createErrorToken(INVALID_TOKEN_MESSAGE);
     }
 
     /* ERROR: Check if identifier is immediately followed by an operator without space*/
@@ -623,7 +894,7 @@ Token scanIdentifier()
         {
             consumeChar();
         }
-        return createErrorToken("Invalid token");
+        return createErrorToken(INVALID_TOKEN_MESSAGE);
     }
 
     return createToken(type);
@@ -658,7 +929,7 @@ Token scanNumber()
         {
             consumeChar();
         }
-        return createErrorToken("Invalid token");
+        return createErrorToken(INVALID_TOKEN_MESSAGE);
     }
 
     /* ERROR: Check if an operator immediately follows the number without space*/
@@ -670,7 +941,7 @@ Token scanNumber()
         {
             consumeChar();
         }
-        return createErrorToken("Invalid token");
+        return createErrorToken(INVALID_TOKEN_MESSAGE);
     }
 
     return createToken(isFloat ? TOKEN_NUMBER_FLOAT : TOKEN_NUMBER_INT);
@@ -679,6 +950,12 @@ Token scanNumber()
 /* Scan string literal */
 Token scanString(char quote)
 {
+    if (lazy_lines)
+    {
+        /* No lines to count: jump to the closing quote (or the end) */
+        const char stop[2] = {quote, '\0'};
+        scanner.scan_ptr += strcspn(scanner.scan_ptr, stop);
+    }
     while (currentChar() != quote && !reachedEnd())
     {
         if (currentChar() == '\n')
@@ -688,7 +965,7 @@ Token scanString(char quote)
 
     if (reachedEnd())
     {
-        return createErrorToken("Invalid token");
+        return createErrorToken(INVALID_TOKEN_MESSAGE);
     }
 
     consumeChar(); /* closing quote */
@@ -710,6 +987,12 @@ Token scanMultiLineComment()
 {
     while (!reachedEnd())
     {
+        if (lazy_lines)
+        {
+            scanner.scan_ptr += strcspn(scanner.scan_ptr, "*");
+            if (reachedEnd())
+                break;
+        }
         if (currentChar() == '*' && nextChar() == '/')
         {
             consumeChar(); /* consume * */
@@ -722,7 +1005,7 @@ Token scanMultiLineComment()
         }
         consumeChar();
     }
-    return createErrorToken("Invalid token");
+    return createErrorToken(INVALID_TOKEN_MESSAGE);
 }
 
 /* Main token scanner */
@@ -768,14 +1051,14 @@ Token getNextToken()
         {
             /* Check for invalid +++, ++= */
             if (currentChar() == '+' || currentChar() == '=')
-                return createErrorToken("Invalid token");
+                return createErrorToken(INVALID_TOKEN_MESSAGE);
             return createToken(TOKEN_INCREMENT_OP);
         }
         if (matchNext('='))
         {
             /* Check for invalid += followed by = */
             if (currentChar() == '=')
-                return createErrorToken("Invalid token");
+                return createErrorToken(INVALID_TOKEN_MESSAGE);
             return createToken(TOKEN_ADD_ASSIGN_OP);
         }
         return checkOperatorBoundary(TOKEN_ADD_OP);
@@ -785,21 +1068,21 @@ Token getNextToken()
         {
             /* Check for invalid ---, --= */
             if (currentChar() == '-' || currentChar() == '=')
-                return createErrorToken("Invalid token");
+                return createErrorToken(INVALID_TOKEN_MESSAGE);
             return createToken(TOKEN_DECREMENT_OP);
         }
         if (matchNext('='))
         {
             /* Check for invalid -= followed by = */
             if (currentChar() == '=')
-                return createErrorToken("Invalid token");
+                return createErrorToken(INVALID_TOKEN_MESSAGE);
             return createToken(TOKEN_SUB_ASSIGN_OP);
         }
         if (matchNext('>'))
         {
             /* Check for invalid -> followed by operator chars */
             if (isOperator(currentChar()))
-                return createErrorToken("Invalid token");
+                return createErrorToken(INVALID_TOKEN_MESSAGE);
             return createToken(TOKEN_ARROW_OP);
         }
         return checkOperatorBoundary(TOKEN_SUB_OP);
@@ -811,7 +1094,7 @@ Token getNextToken()
             consumeChar(); /* consume the | */
             /* Check for invalid *| followed by operator chars */
             if (isOperator(currentChar()))
-                return createErrorToken("Invalid token");
+                return createErrorToken(INVALID_TOKEN_MESSAGE);
             return createToken(TOKEN_QUANTUM_POINTER_OP);
         }
         /* Check for *= (multiply assign) */
@@ -820,12 +1103,12 @@ Token getNextToken()
             consumeChar(); /* consume the = */
             /* Check for invalid *= followed by = */
             if (currentChar() == '=')
-                return createErrorToken("Invalid token");
+                return createErrorToken(INVALID_TOKEN_MESSAGE);
             return createToken(TOKEN_MULT_ASSIGN_OP);
         }
         /* Check for invalid ** (not defined in CNACK) */
         if (currentChar() == '*')
-            return createErrorToken("Invalid token");
+            return createErrorToken(INVALID_TOKEN_MESSAGE);
 
         /* Check if it's likely a pointer: * NOT followed by whitespace and followed by identifier */
         if (!isWhitespace(currentChar()) && (isLetter(currentChar()) || currentChar() == '_' || currentChar() == '*'))
@@ -840,7 +1123,7 @@ Token getNextToken()
             {
                 consumeChar();
             }
-            return createErrorToken("Invalid token");
+            return createErrorToken(INVALID_TOKEN_MESSAGE);
         }
         /* Otherwise it's multiplication */
         return createToken(TOKEN_MULT_OP);
@@ -850,7 +1133,7 @@ Token getNextToken()
         {
             /* Check for invalid /= followed by = */
             if (currentChar() == '=')
-                return createErrorToken("Invalid token");
+                return createErrorToken(INVALID_TOKEN_MESSAGE);
             return createToken(TOKEN_DIV_ASSIGN_OP);
         }
         else if (matchNext('/'))
@@ -868,7 +1151,7 @@ Token getNextToken()
         {
             /* Check for invalid %= followed by = */
             if (currentChar() == '=')
-                return createErrorToken("Invalid token");
+                return createErrorToken(INVALID_TOKEN_MESSAGE);
             return createToken(TOKEN_MOD_ASSIGN_OP);
         }
         return checkOperatorBoundary(TOKEN_MOD_OP);
@@ -878,7 +1161,7 @@ Token getNextToken()
         {
             /* Check for invalid === */
             if (currentChar() == '=')
-                return createErrorToken("Invalid token");
+                return createErrorToken(INVALID_TOKEN_MESSAGE);
             return createToken(TOKEN_EQUAL_TO_OP);
         }
         return checkOperatorBoundary(TOKEN_ASSIGN_OP);
@@ -888,12 +1171,12 @@ Token getNextToken()
         {
             /* Check for invalid <== */
             if (currentChar() == '=')
-                return createErrorToken("Invalid token");
+                return createErrorToken(INVALID_TOKEN_MESSAGE);
             return createToken(TOKEN_LESS_EQUAL_OP);
         }
         /* Check for invalid << or <<= (bit shift not defined in CNACK) */
         if (currentChar() == '<')
-            return createErrorToken("Invalid token");
+            return createErrorToken(INVALID_TOKEN_MESSAGE);
         return checkOperatorBoundary(TOKEN_LESS_OP);
 
     case '>':
@@ -901,12 +1184,12 @@ Token getNextToken()
         {
             /* Check for invalid >== */
             if (currentChar() == '=')
-                return createErrorToken("Invalid token");
+                return createErrorToken(INVALID_TOKEN_MESSAGE);
             return createToken(TOKEN_GREATER_EQUAL_OP);
         }
         /* Check for invalid >> or >>= (bit shift not defined in CNACK) */
         if (currentChar() == '>')
-            return createErrorToken("Invalid token");
+            return createErrorToken(INVALID_TOKEN_MESSAGE);
         return checkOperatorBoundary(TOKEN_GREATER_OP);
 
     case '!':
@@ -914,7 +1197,7 @@ Token getNextToken()
         {
             /* Check for invalid !== */
             if (currentChar() == '=')
-                return createErrorToken("Invalid token");
+                return createErrorToken(INVALID_TOKEN_MESSAGE);
             return createToken(TOKEN_NOT_EQUAL_TO_OP);
         }
         return checkOperatorBoundary(TOKEN_LOGICAL_NOT_OP);
@@ -924,12 +1207,12 @@ Token getNextToken()
         {
             /* Check for invalid &&& or &&= */
             if (currentChar() == '&' || currentChar() == '=')
-                return createErrorToken("Invalid token");
+                return createErrorToken(INVALID_TOKEN_MESSAGE);
             return createToken(TOKEN_LOGICAL_AND_OP);
         }
         /* Check for invalid &= (bitwise AND assignment not defined) */
         if (currentChar() == '=')
-            return createErrorToken("Invalid token");
+            return createErrorToken(INVALID_TOKEN_MESSAGE);
         return checkOperatorBoundary(TOKEN_ADDRESS_OF_OP);
 
     case '|':
@@ -937,16 +1220,16 @@ Token getNextToken()
         {
             /* Check for invalid ||| or ||= */
             if (currentChar() == '|' || currentChar() == '=')
-                return createErrorToken("Invalid token");
+                return createErrorToken(INVALID_TOKEN_MESSAGE);
             return createToken(TOKEN_LOGICAL_OR_OP);
         }
         /* Single | is not valid in CNACK (not a bitwise OR operator) */
-        return createErrorToken("Invalid token");
+        return createErrorToken(INVALID_TOKEN_MESSAGE);
 
     case '^':
         /* Check for invalid ^= (XOR assignment not defined) */
         if (currentChar() == '=')
-            return createErrorToken("Invalid token");
+            return createErrorToken(INVALID_TOKEN_MESSAGE);
         return checkOperatorBoundary(TOKEN_EXPO_OP);
 
     /* Separators */
@@ -977,92 +1260,1986 @@ Token getNextToken()
 
     /* Unknown character */
     default:
-        return createErrorToken("Invalid token");
+        return createErrorToken(INVALID_TOKEN_MESSAGE);
+    }
+}
+
+/* Free a token list's arrays (arena lists are freed with their arena) */
+void freeTokens(TokenList *list)
+{
+    if (list->arena == NULL)
+    {
+        free(list->offsets);
+        free(list->line_starts);
+    }
+    list->line_starts = NULL;
+    list->line_count = 0;
+    list->types = NULL;
+    list->offsets = list->lengths = list->lines = NULL;
+    list->count = list->capacity = 0;
+}
+
+/* Make room for capacity tokens; the four arrays share one allocation */
+int reserveTokens(TokenList *list, int capacity)
+{
+    size_t bytes = (size_t)capacity * (3 * sizeof(uint32_t) + sizeof(uint8_t));
+    char *block = list->arena ? (char *)arenaAlloc(list->arena, bytes) : (char *)malloc(bytes);
+    if (block == NULL)
+        return 0;
+    uint32_t *offsets = (uint32_t *)block;
+    uint32_t *lengths = offsets + capacity;
+    uint32_t *lines = lengths + capacity;
+    uint8_t *types = (uint8_t *)(lines + capacity);
+
+    int count = list->count;
+    if (count > 0)
+    {
+        memcpy(offsets, list->offsets, (size_t)count * sizeof(uint32_t));
+        memcpy(lengths, list->lengths, (size_t)count * sizeof(uint32_t));
+        memcpy(lines, list->lines, (size_t)count * sizeof(uint32_t));
+        memcpy(types, list->types, (size_t)count);
+    }
+    if (list->arena == NULL)
+        free(list->offsets);
+    list->offsets = offsets;
+    list->lengths = lengths;
+    list->lines = lines;
+    list->types = types;
+    list->count = count;
+    list->capacity = capacity;
+    return 1;
+}
+
+/* Append a token to the list, growing it geometrically */
+int addToken(TokenList *list, Token token)
+{
+    if (list->count == list->capacity && !reserveTokens(list, list->capacity ? list->capacity * 2 : 1024))
+        return 0;
+    int i = list->count++;
+    list->types[i] = (uint8_t)token.type;
+    list->offsets[i] = (uint32_t)token.source_offset;
+    list->lengths[i] = (uint32_t)token.source_length;
+    list->lines[i] = (uint32_t)token.line;
+    return 1;
+}
+
+/* Rebuild token i of a list that was lexed from list->source */
+Token tokenAt(const TokenList *list, int i)
+{
+    Token tok;
+    tok.type = (TokenType)list->types[i];
+    tok.source_offset = (int)list->offsets[i];
+    tok.source_length = (int)list->lengths[i];
+    tok.line = (int)tokenLine(list, i);
+    tok.column = 0;
+    if (list->line_starts)
+    {
+        /* Most tokens start on the line they end on; only multi-line ones need a second search */
+        uint32_t start = list->line_starts[tok.line - 1];
+        if (start > list->offsets[i])
+            start = list->line_starts[lineAt(list, list->offsets[i]) - 1];
+        tok.column = (int)(list->offsets[i] - start) + 1;
     }
+    tok.lexeme_start = tok.type == TOKEN_ERROR ? INVALID_TOKEN_MESSAGE : list->source + tok.source_offset;
+    tok.lexeme_length = tok.type == TOKEN_ERROR ? (int)strlen(INVALID_TOKEN_MESSAGE) : tok.source_length;
+    return tok;
 }
 
-/* Analyze code from string */
-void analyzeCode(const char *code)
+/* Scan the whole source into a token list (including EOF) */
+int tokenizeCode(const char *code, TokenList *list)
 {
     Token token;
 
     /* Initialize scanner */
     initScanner(code);
+    list->source = code;
 
-    /* Print header to stdout */
-    printf("================================================\n");
-    printf("     LEXICAL ANALYSIS RESULTS\n");
-    printf("================================================\n");
-    printf("LINE   | TOKEN TYPE           | LEXEME\n");
-    printf("-------|----------------------|----------------------------------\n");
-
-    /* Process all tokens including EOF */
     do
     {
         token = getNextToken();
-        printTokenToFile(token, NULL);
+        stats.tokens_by_type[token.type]++;
+        if (!addToken(list, token))
+            return 0;
     } while (token.type != TOKEN_EOF);
 
-    /* Print footer to stdout */
-    printf("================================================\n");
-    printf("     END OF ANALYSIS\n");
-    printf("================================================\n");
+    return !lazy_lines || buildLineIndex(list);
 }
 
-/* ========== MAIN PROGRAM ========== */
+/* columns: the list has a line index (--columns), so every row has a COL cell */
+void printTableHeader(int columns)
+{
+    emit("================================================\n");
+    emit("     LEXICAL ANALYSIS RESULTS\n");
+    emit("================================================\n");
+    if (columns)
+    {
+        emit("LINE   | COL    | TOKEN TYPE           | LEXEME\n");
+        emit("-------|--------|----------------------|----------------------------------\n");
+    }
+    else
+    {
+        emit("LINE   | TOKEN TYPE           | LEXEME\n");
+        emit("-------|----------------------|----------------------------------\n");
+    }
+}
 
-int main()
+void printTableFooter()
 {
-    char *input = NULL;
-    size_t buffer_size = 0;
-    size_t total_size = 0;
-    size_t chunk_size = 100000;
+    emit("================================================\n");
+    emit("     END OF ANALYSIS\n");
+    emit("================================================\n");
+}
 
-    /* Allocate initial buffer */
-    input = (char *)malloc(chunk_size);
-    if (input == NULL)
+/* Print the token table for a scanned source */
+void printTokenTable(const TokenList *list)
+{
+    printTableHeader(list->line_starts != NULL);
+
+    /* Process all tokens including EOF */
+    for (int i = 0; i < list->count; i++)
     {
-        fprintf(stderr, "Error: Memory allocation failed\n");
-        return 1;
+        printTokenToFile(tokenAt(list, i), NULL);
     }
 
-    /* Read all input from stdin */
-    size_t bytes_read;
-    while ((bytes_read = fread(input + total_size, 1, chunk_size, stdin)) > 0)
+    printTableFooter();
+}
+
+/* ========== TOKEN STREAM (INCREMENTAL MODE) ========== */
+
+/*
+ * --emit-tokens prints one "offset length TYPE line" record per token instead of the table.
+ * --incremental=FILE --edit=OFFSET,REMOVED,INSERTED takes such a stream for the previous
+ * source, the new source on stdin and the edit between them, and prints only what changed:
+ *
+ *   #CNACK-DELTA first removed inserted offset_shift line_shift
+ *   <inserted token records>
+ *
+ * Old tokens [first, first + removed) are replaced by the records, and every old token after
+ * them moves by offset_shift bytes and line_shift lines.
+ */
+
+/* Tokens look at most this many bytes past their end (e.g. "1." needs the digit after the dot) */
+#define TOKEN_LOOKAHEAD 2
+
+/* Print tokens [from, to) of a list as records with source spans */
+void printTokenRecords(const TokenList *list, int from, int to)
+{
+    for (int i = from; i < to; i++)
     {
-        total_size += bytes_read;
+        emit("%u %u %s %u\n", list->offsets[i], list->lengths[i],
+             getTokenTypeName((TokenType)list->types[i]), tokenLine(list, i));
+    }
+}
+
+void printTokenStream(const TokenList *list, size_t source_bytes)
+{
+    emit("#CNACK-TOKENS %zu %d\n", source_bytes, list->count);
+    printTokenRecords(list, 0, list->count);
+}
+
+/* Map a printed token type name back to its TokenType, or -1 if unknown */
+int tokenTypeFromName(const char *name)
+{
+    for (int i = 0; i <= TOKEN_EOF; i++)
+    {
+        if (strcmp(getTokenTypeName((TokenType)i), name) == 0)
+            return i;
+    }
+    return -1;
+}
 
-        /* If buffer is full, expand it */
-        if (total_size + chunk_size > buffer_size + chunk_size)
+/* Read a stream written by --emit-tokens; returns the source size it describes, or -1 */
+long readTokenStream(const char *path, TokenList *list)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error: Cannot open token stream '%s'\n", path);
+        return -1;
+    }
+
+    long source_bytes = -1;
+    int count = 0;
+    if (fscanf(file, "#CNACK-TOKENS %ld %d", &source_bytes, &count) != 2 || source_bytes < 0)
+    {
+        fprintf(stderr, "Error: '%s' is not a token stream\n", path);
+        fclose(file);
+        return -1;
+    }
+
+    char name[64];
+    Token tok = {TOKEN_EOF, NULL, 0, 0, 0, 0, 0};
+    for (int i = 0; i < count; i++)
+    {
+        int type;
+        if (fscanf(file, "%d %d %63s %d", &tok.source_offset, &tok.source_length, name, &tok.line) != 4 ||
+            (type = tokenTypeFromName(name)) < 0 || !addToken(list, tok))
         {
-            buffer_size = total_size + chunk_size;
-            char *new_input = (char *)realloc(input, buffer_size);
-            if (new_input == NULL)
+            fprintf(stderr, "Error: Malformed token record %d in '%s'\n", i + 1, path);
+            fclose(file);
+            return -1;
+        }
+        list->types[list->count - 1] = (uint8_t)type;
+    }
+    fclose(file);
+
+    if (count == 0 || list->types[count - 1] != TOKEN_EOF)
+    {
+        fprintf(stderr, "Error: Token stream '%s' does not end with EOF\n", path);
+        return -1;
+    }
+    return source_bytes;
+}
+
+/* Relex only the part of the new source an edit can affect and print the token delta */
+int relexIncremental(const char *code, size_t code_bytes, const TokenList *old, long old_bytes,
+                     int offset, int removed, int inserted)
+{
+    if (offset < 0 || removed < 0 || inserted < 0 || (long)offset + removed > old_bytes ||
+        (size_t)(old_bytes - removed + inserted) != code_bytes)
+    {
+        fprintf(stderr, "Error: Edit does not match the previous source (%ld bytes) and the input (%zu bytes)\n",
+                old_bytes, code_bytes);
+        return 0;
+    }
+
+    /* Restart after the last old token that ends far enough before the edit to be unaffected */
+    int low = 0, high = old->count - 1;
+    while (low < high)
+    {
+        int mid = (low + high) / 2;
+        if ((long)old->offsets[mid] + old->lengths[mid] + TOKEN_LOOKAHEAD <= offset)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    int first = low;
+
+    initScanner(code);
+    if (first > 0)
+    {
+        scanner.scan_ptr = code + old->offsets[first - 1] + old->lengths[first - 1];
+        scanner.line_number = (int)old->lines[first - 1];
+    }
+
+    /*
+     * Scanning from a token start only depends on the bytes after it, so once a new token
+     * starts where a shifted old token behind the edit started, the rest of the stream is
+     * the old one moved by the edit. The EOF tokens always line up, so this terminates.
+     */
+    int shift = inserted - removed;
+    int sync = first;
+    int line_shift = 0;
+    TokenList fresh = {0};
+
+    double start = nowSeconds();
+    for (;;)
+    {
+        Token token = getNextToken();
+        if (token.source_offset >= offset + inserted)
+        {
+            int old_offset = token.source_offset - shift;
+            while (sync < old->count && (int)old->offsets[sync] < old_offset)
+                sync++;
+            if (sync < old->count && (int)old->offsets[sync] == old_offset)
             {
-                fprintf(stderr, "Error: Memory reallocation failed\n");
-                free(input);
-                return 1;
+                line_shift = token.line - (int)old->lines[sync];
+                break;
             }
-            input = new_input;
+        }
+        stats.tokens_by_type[token.type]++;
+        if (!addToken(&fresh, token))
+        {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            freeTokens(&fresh);
+            return 0;
         }
     }
+    stats.lex_time = nowSeconds() - start;
+    stats.reused_tokens = old->count - (sync - first);
 
-    /* Null-terminate the string */
-    input[total_size] = '\0';
+    start = nowSeconds();
+    emit("#CNACK-DELTA %d %d %d %d %d\n", first, sync - first, fresh.count, shift, line_shift);
+    printTokenRecords(&fresh, 0, fresh.count);
+    fflush(stdout);
+    stats.format_time = nowSeconds() - start;
 
-    /* Check if we got any input */
-    if (total_size == 0)
+    freeTokens(&fresh);
+    return 1;
+}
+
+/* ========== SEMANTIC TOKENS ========== */
+
+/*
+ * --semantic-tokens prints what an editor needs to colour the source, in the shape of LSP
+ * semantic tokens: a header with the token count and the class names, then one line per token
+ *
+ *   #CNACK-SEMANTIC count keyword type builtin variable number string comment operator punctuation error
+ *   delta_line delta_column length class
+ *
+ * Lines and columns count from 0. The column is relative to the previous token when both are
+ * on the same line. Columns and lengths are in UTF-16 code units, so a JavaScript client can
+ * slice its string with them. A token over several lines (a block comment) gets one entry per line.
+ */
+
+enum { CLASS_KEYWORD, CLASS_TYPE, CLASS_BUILTIN, CLASS_VARIABLE, CLASS_NUMBER, CLASS_STRING,
+       CLASS_COMMENT, CLASS_OPERATOR, CLASS_PUNCTUATION, CLASS_ERROR };
+
+#define SEMANTIC_LEGEND "keyword type builtin variable number string comment operator punctuation error"
+
+int semanticClass(TokenType type)
+{
+    if (type <= TOKEN_R_BRACKET)
+        return CLASS_PUNCTUATION;
+    if (type <= TOKEN_QUANTUM_POINTER_OP)
+        return CLASS_OPERATOR;
+    if (type == TOKEN_IDENTIFIER)
+        return CLASS_VARIABLE;
+    if (type == TOKEN_NUMBER_INT || type == TOKEN_NUMBER_FLOAT)
+        return CLASS_NUMBER;
+    if (type == TOKEN_STRING)
+        return CLASS_STRING;
+    if (type <= TOKEN_TYPE_STRING)
+        return CLASS_TYPE;
+    if (type == TOKEN_RW_AUTO_REF)
+        return CLASS_BUILTIN;
+    if (type <= TOKEN_RW_OTHERWISE)
+        return CLASS_KEYWORD;
+    if (type <= TOKEN_MULTI_COMMENT)
+        return CLASS_COMMENT;
+    return CLASS_ERROR;
+}
+
+/* UTF-16 units of the character at p: 2 for a 4-byte sequence, else 1. Bytes that are not
+   UTF-8 count as one unit each, as a decoder turns each into U+FFFD. Sets *bytes. */
+int utf16Units(const unsigned char *p, const unsigned char *end, int *bytes)
+{
+    int n = p[0] < 0x80 ? 1 : (p[0] & 0xE0) == 0xC0 && p[0] >= 0xC2 ? 2 : (p[0] & 0xF0) == 0xE0 ? 3 : (p[0] & 0xF8) == 0xF0 && p[0] <= 0xF4 ? 4 : 0;
+    if (n > end - p)
+        n = 0;
+    for (int i = 1; i < n; i++)
     {
-        printf("Error: No input provided\n");
-        free(input);
-        return 1;
+        if ((p[i] & 0xC0) != 0x80)
+            n = 0;
     }
+    *bytes = n ? n : 1;
+    return n == 4 ? 2 : 1;
+}
 
-    /* Analyze the input code */
-    analyzeCode(input);
+void printSemanticTokens(const TokenList *list, size_t source_bytes)
+{
+    const unsigned char *source = (const unsigned char *)list->source, *end = source + source_bytes;
+    const unsigned char *at = source;
+    uint32_t line = 0, column = 0, last_line = 0, last_column = 0;
+    int count = 0;
 
-    /* Clean up */
-    free(input);
+    /* Count the entries first, so the header can lead */
+    for (int pass = 0; pass < 2; pass++)
+    {
+        if (pass == 1)
+        {
+            emit("#CNACK-SEMANTIC %d %s\n", count, SEMANTIC_LEGEND);
+            at = source;
+            line = column = last_line = last_column = 0;
+        }
+        for (int i = 0; i < list->count; i++)
+        {
+            if (list->types[i] == TOKEN_EOF)
+                continue;
+            const unsigned char *start = source + list->offsets[i], *stop = start + list->lengths[i];
+            int type = semanticClass((TokenType)list->types[i]);
+            while (start < stop)
+            {
+                int bytes;
+                while (at < start)
+                {
+                    if (*at == '\n')
+                    {
+                        line++;
+                        column = 0;
+                        at++;
+                    }
+                    else
+                    {
+                        column += utf16Units(at, end, &bytes);
+                        at += bytes;
+                    }
+                }
+                uint32_t length = 0;
+                while (at < stop && *at != '\n')
+                {
+                    length += utf16Units(at, end, &bytes);
+                    at += bytes;
+                }
+                if (length > 0 && pass == 0)
+                    count++;
+                else if (length > 0)
+                {
+                    emit("%u %u %u %d\n", line - last_line, line == last_line ? column - last_column : column, length, type);
+                    last_line = line;
+                    last_column = column;
+                }
+                column += length;
+                start = at < stop ? at + 1 : stop; /* the next piece starts after the newline */
+            }
+        }
+    }
+}
+
+/* ========== PARALLEL LEXING ========== */
+
+/*
+ * With --jobs=N one large source is split at newlines into up to N chunks of at least
+ * --chunk-bytes, and the chunks are lexed concurrently, each as if it started outside any
+ * comment or string. That guess is wrong when a chunk starts inside a multi-line comment or
+ * string, so the calling thread checks every chunk by lexing on from the end of the tokens
+ * accepted so far: the scanner keeps no state between tokens, so as soon as a token lexed
+ * from the true position starts where a chunk token starts, the rest of that chunk is exact.
+ * A wrong guess only costs relexing the tokens up to that point, and a chunk start never has
+ * to be classified up front.
+ *
+ * Chunks count their newlines, so chunk line numbers become absolute with a prefix sum while
+ * the accepted tokens are copied into the result in parallel. The token table is then
+ * formatted in ranges on the same number of threads and written in order.
+ */
+#define DEFAULT_CHUNK_BYTES (1024 * 1024)
+#define FORMAT_RANGE_TOKENS 65536
+
+int lex_jobs = 1;                         /* Threads for one source (--jobs) */
+size_t chunk_bytes = DEFAULT_CHUNK_BYTES; /* Smallest chunk worth a thread (--chunk-bytes) */
+
+typedef struct
+{
+    const char *source;
+    size_t start;       /* First byte, just after a newline */
+    size_t end;         /* One past the last byte */
+    TokenList tokens;   /* Tokens starting in [start, end), lines counted from 1 at start */
+    long newlines;      /* Newlines in [start, end) */
+    long keyword_probes;
+    int ok;
+    TokenList relexed;  /* Tokens lexed while checking, which come before the accepted ones */
+    Arena arena;        /* Holds both token lists */
+    int lazy_lines;     /* The calling thread's --columns mode */
+    int accepted;       /* First token of the chunk that is part of the result */
+    long line_base;     /* Newlines before start */
+    TokenList *result;  /* Where the relexed and accepted tokens go, from index out */
+    int out;
+} LexChunk;
+
+/* Run fn on every chunk: chunk 0 on this thread, the rest on their own threads if they start */
+void runChunks(void *(*fn)(void *), LexChunk *chunks, int count)
+{
+    pthread_t *threads = (pthread_t *)calloc(count, sizeof(pthread_t));
+    int *started = (int *)calloc(count, sizeof(int));
+    for (int k = 1; threads != NULL && started != NULL && k < count; k++)
+        started[k] = pthread_create(&threads[k], NULL, fn, &chunks[k]) == 0;
+    fn(&chunks[0]);
+    for (int k = 1; k < count; k++)
+    {
+        if (started != NULL && started[k])
+            pthread_join(threads[k], NULL);
+        else
+            fn(&chunks[k]);
+    }
+    free(threads);
+    free(started);
+}
+
+void *lexChunk(void *arg)
+{
+    LexChunk *chunk = (LexChunk *)arg;
+    const char *stop = chunk->source + chunk->end;
+    for (const char *p = chunk->source + chunk->start; (p = memchr(p, '\n', stop - p)) != NULL; p++)
+        chunk->newlines++;
+
+    /* Probes are handed to the calling thread, which may be this one */
+    long probes = stats.keyword_probes;
+    lazy_lines = chunk->lazy_lines;
+    initScanner(chunk->source);
+    scanner.scan_ptr = chunk->source + chunk->start;
+    chunk->ok = 1;
+    for (;;)
+    {
+        Token token = getNextToken();
+        if (token.type != TOKEN_EOF && (size_t)token.source_offset >= chunk->end)
+            break;
+        if (!addToken(&chunk->tokens, token))
+        {
+            chunk->ok = 0;
+            break;
+        }
+        if (token.type == TOKEN_EOF)
+            break;
+    }
+    chunk->keyword_probes = stats.keyword_probes - probes;
+    stats.keyword_probes = probes;
+    return NULL;
+}
+
+/*
+ * Decide which tokens of each chunk are exact. chunks[count] is an empty chunk that only
+ * collects tokens relexed after the last one. Returns the number of tokens in the result.
+ */
+long checkChunks(const char *code, LexChunk *chunks, int count)
+{
+    for (int k = 0; k <= count; k++)
+        chunks[k].accepted = chunks[k].tokens.count;
+
+    Token last;
+    int have_last = 0;
+    int k = 0;
+    int next = 0;
+    for (;;)
+    {
+        /* Lex one token from where the result so far ends */
+        initScanner(code);
+        if (have_last)
+        {
+            if (last.type == TOKEN_EOF)
+                break;
+            scanner.scan_ptr = code + last.source_offset + last.source_length;
+            scanner.line_number = last.line;
+        }
+        Token token = getNextToken();
+
+        /* Find the first chunk token that does not start before it */
+        while (k < count && (next >= chunks[k].tokens.count ||
+                             (int)chunks[k].tokens.offsets[next] < token.source_offset))
+        {
+            if (next >= chunks[k].tokens.count)
+            {
+                k++;
+                next = 0;
+            }
+            else
+                next++;
+        }
+
+        if (k < count && (int)chunks[k].tokens.offsets[next] == token.source_offset)
+        {
+            /* Same start, same state from here on: take the rest of the chunk */
+            chunks[k].accepted = next;
+            last = tokenAt(&chunks[k].tokens, chunks[k].tokens.count - 1);
+            last.line += (int)chunks[k].line_base;
+            k++;
+            next = 0;
+        }
+        else
+        {
+            if (!addToken(&chunks[k].relexed, token))
+                return -1;
+            last = token;
+        }
+        have_last = 1;
+    }
+
+    long total = 0;
+    for (int i = 0; i <= count; i++)
+        total += chunks[i].relexed.count + (chunks[i].tokens.count - chunks[i].accepted);
+    return total;
+}
+
+/* Copy a chunk's relexed and accepted tokens into the result, making lines absolute */
+/* Copy tokens [first, first + count) of one list to index at of another */
+void copyTokens(TokenList *to, int at, const TokenList *from, int first, int count)
+{
+    if (count <= 0)
+        return;
+    memcpy(to->types + at, from->types + first, (size_t)count);
+    memcpy(to->offsets + at, from->offsets + first, (size_t)count * sizeof(uint32_t));
+    memcpy(to->lengths + at, from->lengths + first, (size_t)count * sizeof(uint32_t));
+    memcpy(to->lines + at, from->lines + first, (size_t)count * sizeof(uint32_t));
+}
+
+void *copyChunk(void *arg)
+{
+    LexChunk *chunk = (LexChunk *)arg;
+    int out = chunk->out;
+    copyTokens(chunk->result, out, &chunk->relexed, 0, chunk->relexed.count);
+    out += chunk->relexed.count;
+
+    int accepted = chunk->tokens.count - chunk->accepted;
+    copyTokens(chunk->result, out, &chunk->tokens, chunk->accepted, accepted);
+    uint32_t *lines = chunk->result->lines + out;
+    for (int i = 0; i < accepted; i++)
+        lines[i] += (uint32_t)chunk->line_base;
+    return NULL;
+}
 
-    return 0;
-}
\ No newline at end of file
+/* Lex one source on up to lex_jobs threads; the token list is identical to tokenizeCode's */
+int tokenizeParallel(const char *code, TokenList *list)
+{
+    size_t length = strlen(code);
+    int count = lex_jobs;
+    if (chunk_bytes > 0 && length / chunk_bytes < (size_t)count)
+        count = (int)(length / chunk_bytes);
+    if (count < 2)
+        return tokenizeCode(code, list);
+
+    LexChunk *chunks = (LexChunk *)calloc(count + 1, sizeof(LexChunk));
+    if (chunks == NULL)
+        return tokenizeCode(code, list);
+    for (int k = 0; k <= count; k++)
+    {
+        chunks[k].tokens.arena = chunks[k].relexed.arena = &chunks[k].arena;
+        chunks[k].tokens.source = chunks[k].relexed.source = code;
+    }
+
+    /* Split at the first newline after each even share of the input */
+    int used = 0;
+    for (size_t start = 0; used < count && start < length; used++)
+    {
+        size_t end = length * (used + 1) / count;
+        const char *newline = end > start && end < length ? memchr(code + end, '\n', length - end) : NULL;
+        end = used == count - 1 || newline == NULL ? length : (size_t)(newline - code) + 1;
+        chunks[used].source = code;
+        chunks[used].start = start;
+        chunks[used].end = end;
+        chunks[used].lazy_lines = lazy_lines;
+        start = end;
+    }
+    runChunks(lexChunk, chunks, used);
+
+    int ok = 1;
+    long lines = 0;
+    for (int k = 0; k < used; k++)
+    {
+        ok = ok && chunks[k].ok;
+        chunks[k].line_base = lines;
+        lines += chunks[k].newlines;
+        stats.keyword_probes += chunks[k].keyword_probes;
+    }
+
+    long total = ok ? checkChunks(code, chunks, used) : -1;
+    TokenList result = {0};
+    result.source = code;
+    result.arena = list->arena;
+    ok = total > 0 && reserveTokens(&result, (int)total);
+    if (ok)
+    {
+        int out = 0;
+        for (int k = 0; k <= used; k++)
+        {
+            chunks[k].result = &result;
+            chunks[k].out = out;
+            out += chunks[k].relexed.count + (chunks[k].tokens.count - chunks[k].accepted);
+        }
+        runChunks(copyChunk, chunks, used + 1);
+
+        freeTokens(list);
+        *list = result;
+        list->count = (int)total;
+        for (int i = 0; i < list->count; i++)
+            stats.tokens_by_type[list->types[i]]++;
+        ok = !lazy_lines || buildLineIndex(list);
+    }
+
+    for (int k = 0; k <= count; k++)
+        arenaRelease(&chunks[k].arena);
+    free(chunks);
+    return ok;
+}
+
+/* Token ranges formatted by worker threads and written in order by the calling thread */
+typedef struct
+{
+    const TokenList *list;
+    int records;
+    int ranges;
+    int window;          /* Ranges formatted ahead of the writer at most */
+    int next;            /* Next range to format */
+    int written;         /* Ranges written so far */
+    OutputBuffer *out;   /* One per range */
+    int *done;
+    long output_bytes;   /* Counted by the workers */
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} FormatJob;
+
+void *formatRanges(void *arg)
+{
+    FormatJob *job = (FormatJob *)arg;
+    long bytes = stats.output_bytes;
+    pthread_mutex_lock(&job->lock);
+    for (;;)
+    {
+        while (job->next < job->ranges && job->next >= job->written + job->window)
+            pthread_cond_wait(&job->changed, &job->lock);
+        if (job->next >= job->ranges)
+            break;
+        int range = job->next++;
+        pthread_mutex_unlock(&job->lock);
+
+        int from = range * FORMAT_RANGE_TOKENS;
+        int to = from + FORMAT_RANGE_TOKENS < job->list->count ? from + FORMAT_RANGE_TOKENS : job->list->count;
+        emitTarget = &job->out[range];
+        if (job->records)
+            printTokenRecords(job->list, from, to);
+        else
+        {
+            for (int i = from; i < to; i++)
+                printTokenToFile(tokenAt(job->list, i), NULL);
+        }
+        emitTarget = NULL;
+
+        pthread_mutex_lock(&job->lock);
+        job->done[range] = 1;
+        pthread_cond_broadcast(&job->changed);
+    }
+    job->output_bytes += stats.output_bytes - bytes;
+    pthread_mutex_unlock(&job->lock);
+    arenaRelease(&scratch);
+    return NULL;
+}
+
+/* printTokenTable / printTokenStream on up to lex_jobs threads, same output */
+void printParallel(const TokenList *list, int records, size_t source_bytes)
+{
+    int workers = lex_jobs < 2 ? 0 : lex_jobs;
+    FormatJob job;
+    job.list = list;
+    job.records = records;
+    job.ranges = (list->count + FORMAT_RANGE_TOKENS - 1) / FORMAT_RANGE_TOKENS;
+    job.window = 2 * workers;
+    job.next = job.written = 0;
+    job.output_bytes = 0;
+    job.out = (OutputBuffer *)calloc(job.ranges, sizeof(OutputBuffer));
+    job.done = (int *)calloc(job.ranges, sizeof(int));
+    pthread_t *threads = (pthread_t *)malloc(workers * sizeof(pthread_t));
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.changed, NULL);
+
+    int started = 0;
+    if (job.ranges > 1 && job.out != NULL && job.done != NULL && threads != NULL)
+    {
+        while (started < workers && pthread_create(&threads[started], NULL, formatRanges, &job) == 0)
+            started++;
+    }
+    if (started == 0)
+    {
+        if (records)
+            printTokenStream(list, source_bytes);
+        else
+            printTokenTable(list);
+    }
+    else if (records)
+        emit("#CNACK-TOKENS %zu %d\n", source_bytes, list->count);
+    else
+        printTableHeader(list->line_starts != NULL);
+
+    for (int range = 0; started > 0 && range < job.ranges; range++)
+    {
+        pthread_mutex_lock(&job.lock);
+        while (!job.done[range])
+            pthread_cond_wait(&job.changed, &job.lock);
+        pthread_mutex_unlock(&job.lock);
+
+        fwrite(job.out[range].data, 1, job.out[range].length, stdout);
+        free(job.out[range].data);
+
+        pthread_mutex_lock(&job.lock);
+        job.written++;
+        pthread_cond_broadcast(&job.changed);
+        pthread_mutex_unlock(&job.lock);
+    }
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    stats.output_bytes += job.output_bytes;
+
+    if (started > 0 && !records)
+        printTableFooter();
+
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.changed);
+    free(job.out);
+    free(job.done);
+    free(threads);
+}
+
+/* ========== TOKEN CACHE (--cache-dir) ========== */
+
+/*
+ * --cache-dir=DIR keeps the token list of every source lexed, in DIR/<hash>.tok:
+ *
+ *   TokenCacheHeader | offsets[count] | lengths[count] | lines[count] (uint32) | types[count] (uint8)
+ *
+ * The name is the FNV-1a hash of the source; the header repeats it with the source size and a
+ * format version, so a collision or a file from another build is a miss. A hit maps the file
+ * and the token list points straight into the mapping: nothing is lexed or copied. Files are
+ * written under a temporary name and renamed, so readers never see half a file. When DIR grows
+ * past --cache-max-bytes, the least recently used files (by mtime, touched on a hit) are deleted.
+ */
+#define TOKEN_CACHE_MAGIC "CNACKTOK"
+#define TOKEN_CACHE_VERSION (1u << 8 | TOKEN_EOF) /* a new token type changes the version too */
+#define DEFAULT_CACHE_MAX_BYTES (256L * 1024 * 1024)
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint64_t source_bytes;
+    uint64_t source_hash;
+} TokenCacheHeader;
+
+const char *cache_dir = NULL;                    /* --cache-dir, NULL = no cache */
+long cache_max_bytes = DEFAULT_CACHE_MAX_BYTES; /* --cache-max-bytes */
+
+/* A mapped cache file, or a copy in memory without mmap; the token list of a hit points into it */
+typedef struct
+{
+    void *data;
+    size_t size;
+} CacheMapping;
+
+/* The file system calls whose form differs between platforms */
+long long modifiedNs(const struct stat *info)
+{
+#if defined(__APPLE__)
+    return info->st_mtimespec.tv_sec * 1000000000LL + info->st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    return info->st_mtime * 1000000000LL;
+#else
+    return info->st_mtim.tv_sec * 1000000000LL + info->st_mtim.tv_nsec;
+#endif
+}
+
+int makeDirectory(const char *path)
+{
+#ifdef _WIN32
+    return _mkdir(path);
+#else
+    return mkdir(path, 0777);
+#endif
+}
+
+void *readCacheFile(int fd, size_t size)
+{
+#ifdef CNACK_MMAP
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    return data == MAP_FAILED ? NULL : data;
+#else
+    char *data = (char *)malloc(size);
+    for (size_t got = 0; data != NULL && got < size;)
+    {
+        ssize_t n = read(fd, data + got, size - got);
+        if (n <= 0)
+        {
+            free(data);
+            return NULL;
+        }
+        got += (size_t)n;
+    }
+    return data;
+#endif
+}
+
+void unmapCacheFile(void *data, size_t size)
+{
+#ifdef CNACK_MMAP
+    munmap(data, size);
+#else
+    (void)size;
+    free(data);
+#endif
+}
+
+uint64_t hashSource(const char *code, size_t length)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)code[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void cacheFilePath(char *path, size_t size, uint64_t hash)
+{
+    snprintf(path, size, "%s/%016llx.tok", cache_dir, (unsigned long long)hash);
+}
+
+/* Map the cached tokens of code into list; returns 0 on a miss */
+int loadCachedTokens(const char *code, size_t length, uint64_t hash, TokenList *list, CacheMapping *mapping)
+{
+    char path[4096];
+    cacheFilePath(path, sizeof(path), hash);
+    int fd = open(path, O_RDONLY | O_BINARY);
+    if (fd < 0)
+        return 0;
+    struct stat info;
+    void *data = fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(TokenCacheHeader)
+                     ? readCacheFile(fd, (size_t)info.st_size)
+                     : NULL;
+    close(fd);
+    if (data == NULL)
+        return 0;
+
+    /* Everything is checked before use: the file may be from another build or cut short */
+    const TokenCacheHeader *header = (const TokenCacheHeader *)data;
+    size_t count = header->count;
+    int ok = memcmp(header->magic, TOKEN_CACHE_MAGIC, 8) == 0 && header->version == TOKEN_CACHE_VERSION &&
+             header->source_bytes == length && header->source_hash == hash && count > 0 &&
+             (size_t)info.st_size == sizeof(TokenCacheHeader) + count * (3 * sizeof(uint32_t) + 1);
+    const uint32_t *offsets = (const uint32_t *)(header + 1);
+    const uint32_t *lengths = offsets + count;
+    const uint8_t *types = (const uint8_t *)(lengths + 2 * count);
+    for (size_t i = 0; ok && i < count; i++)
+        ok = types[i] <= TOKEN_EOF && (uint64_t)offsets[i] + lengths[i] <= length;
+    if (!ok || types[count - 1] != TOKEN_EOF)
+    {
+        unmapCacheFile(data, (size_t)info.st_size);
+        return 0;
+    }
+
+    freeTokens(list);
+    list->source = code;
+    list->offsets = (uint32_t *)offsets;
+    list->lengths = (uint32_t *)lengths;
+    list->lines = (uint32_t *)(lengths + count);
+    list->types = (uint8_t *)types;
+    list->count = list->capacity = (int)count;
+    for (size_t i = 0; i < count; i++)
+        stats.tokens_by_type[types[i]]++;
+    mapping->data = data;
+    mapping->size = (size_t)info.st_size;
+    utimes(path, NULL); /* mark as recently used */
+    stats.cache_hits++;
+    return 1;
+}
+
+void releaseMapping(CacheMapping *mapping)
+{
+    if (mapping->data != NULL)
+        unmapCacheFile(mapping->data, mapping->size);
+    mapping->data = NULL;
+}
+
+typedef struct
+{
+    char name[64];
+    off_t size;
+    long long used; /* mtime in nanoseconds */
+} CacheEntry;
+
+int compareCacheEntries(const void *a, const void *b)
+{
+    long long x = ((const CacheEntry *)a)->used, y = ((const CacheEntry *)b)->used;
+    return (x > y) - (x < y);
+}
+
+/* Delete the least recently used files until DIR fits in cache_max_bytes */
+void evictCache()
+{
+    DIR *dir = opendir(cache_dir);
+    if (dir == NULL)
+        return;
+    CacheEntry *entries = NULL;
+    int count = 0, capacity = 0;
+    long long total = 0;
+    char path[4096];
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        size_t name_length = strlen(entry->d_name);
+        struct stat info;
+        if (name_length < 4 || name_length >= sizeof(entries->name) || strcmp(entry->d_name + name_length - 4, ".tok") != 0)
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, entry->d_name);
+        if (stat(path, &info) != 0)
+            continue;
+        if (count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64;
+            CacheEntry *grown = (CacheEntry *)realloc(entries, (size_t)capacity * sizeof(CacheEntry));
+            if (grown == NULL)
+                break;
+            entries = grown;
+        }
+        memcpy(entries[count].name, entry->d_name, name_length + 1);
+        entries[count].size = info.st_size;
+        entries[count].used = modifiedNs(&info);
+        total += info.st_size;
+        count++;
+    }
+    closedir(dir);
+
+    if (total > cache_max_bytes)
+    {
+        qsort(entries, count, sizeof(CacheEntry), compareCacheEntries);
+        for (int i = 0; i < count && total > cache_max_bytes; i++)
+        {
+            snprintf(path, sizeof(path), "%s/%s", cache_dir, entries[i].name);
+            if (unlink(path) == 0)
+                total -= entries[i].size;
+        }
+    }
+    free(entries);
+}
+
+/* Write the token list of a source to the cache; failures only cost the next run a lex */
+void storeCachedTokens(const TokenList *list, size_t length, uint64_t hash)
+{
+    char path[4096], temporary[4200];
+    makeDirectory(cache_dir);
+    cacheFilePath(path, sizeof(path), hash);
+    snprintf(temporary, sizeof(temporary), "%s.%ld.%lx.tmp", path, (long)getpid(), (unsigned long)pthread_self());
+    FILE *file = fopen(temporary, "wb");
+    if (file == NULL)
+        return;
+
+    TokenCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TOKEN_CACHE_MAGIC, 8);
+    header.version = TOKEN_CACHE_VERSION;
+    header.count = (uint32_t)list->count;
+    header.source_bytes = length;
+    header.source_hash = hash;
+    size_t count = (size_t)list->count;
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(list->offsets, sizeof(uint32_t), count, file) == count &&
+             fwrite(list->lengths, sizeof(uint32_t), count, file) == count;
+    /* --columns leaves lines[] empty; the line index gives the same numbers */
+    for (size_t i = 0; ok && i < count; i++)
+    {
+        uint32_t line = tokenLine(list, (int)i);
+        ok = fwrite(&line, sizeof(line), 1, file) == 1;
+    }
+    ok = ok && fwrite(list->types, 1, count, file) == count;
+    if (fclose(file) != 0)
+        ok = 0;
+    if (ok && rename(temporary, path) == 0)
+        evictCache();
+    else
+        remove(temporary);
+}
+
+/* tokenizeParallel (or tokenizeCode for one thread) through --cache-dir when it is set */
+int tokenizeCached(const char *code, TokenList *list, CacheMapping *mapping, int parallel)
+{
+    mapping->data = NULL;
+    if (cache_dir == NULL)
+        return parallel ? tokenizeParallel(code, list) : tokenizeCode(code, list);
+
+    size_t length = strlen(code);
+    uint64_t hash = hashSource(code, length);
+    if (loadCachedTokens(code, length, hash, list, mapping))
+        return !lazy_lines || buildLineIndex(list);
+    if (!(parallel ? tokenizeParallel(code, list) : tokenizeCode(code, list)))
+        return 0;
+    storeCachedTokens(list, length, hash);
+    return 1;
+}
+
+/* ========== ANALYSIS ========== */
+
+/* Analyze code from string, printing the token table or (with records set) the token stream */
+int analyzeCode(const char *code, int records)
+{
+    Arena arena = {NULL};
+    TokenList list = {0};
+    CacheMapping mapping;
+    list.arena = &arena;
+
+    double start = nowSeconds();
+    if (!tokenizeCached(code, &list, &mapping, 1))
+    {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        releaseMapping(&mapping);
+        arenaRelease(&arena);
+        return 0;
+    }
+    stats.lex_time = nowSeconds() - start;
+
+    start = nowSeconds();
+    if (semantic_tokens)
+        printSemanticTokens(&list, strlen(code));
+    else
+        printParallel(&list, records, strlen(code));
+    fflush(stdout);
+    stats.format_time = nowSeconds() - start;
+
+    releaseMapping(&mapping);
+    arenaRelease(&arena);
+    return 1;
+}
+
+/* ========== INPUT FUNCTIONS ========== */
+
+/* Read a whole stream into a NUL-terminated buffer; returns NULL if memory runs out */
+char *readStream(FILE *stream, size_t *size)
+{
+    size_t chunk_size = 100000;
+    size_t buffer_size = chunk_size;
+    size_t total_size = 0;
+    char *input = (char *)malloc(buffer_size);
+    if (input == NULL)
+        return NULL;
+
+    size_t bytes_read;
+    while ((bytes_read = fread(input + total_size, 1, chunk_size, stream)) > 0)
+    {
+        total_size += bytes_read;
+
+        /* Keep room for the next chunk plus the terminator, growing geometrically */
+        if (total_size + chunk_size + 1 > buffer_size)
+        {
+            buffer_size = (total_size + chunk_size + 1) * 2;
+            char *new_input = (char *)realloc(input, buffer_size);
+            if (new_input == NULL)
+            {
+                free(input);
+                return NULL;
+            }
+            input = new_input;
+        }
+    }
+
+    /* Null-terminate the string */
+    input[total_size] = '\0';
+    *size = total_size;
+    return input;
+}
+
+/* ========== STREAMING MODE ========== */
+
+/*
+ * --stream prints the token table while stdin is still being read, in memory bounded by the
+ * longest token. Input is read in blocks into one buffer. A token is only printed once at
+ * least TOKEN_LOOKAHEAD bytes after it have arrived, because those bytes can still change it.
+ * A token that runs into the end of the buffered input may be incomplete: a comment or string
+ * can continue in the next block. Such a token is dropped, the unread tail is moved to the
+ * front of the buffer, and the token is scanned again after the next read. The scanner needs
+ * contiguous text, so the buffer is compacted rather than wrapped like a ring buffer. It only
+ * grows when a single token is longer than it.
+ */
+#define DEFAULT_STREAM_BLOCK (64 * 1024)
+
+size_t stream_block = DEFAULT_STREAM_BLOCK; /* Bytes per read (--stream-block) */
+
+typedef struct
+{
+    char *data;
+    size_t length;     /* Bytes buffered, NUL-terminated */
+    size_t capacity;
+    size_t bytes_read; /* Bytes read from the input so far */
+    int eof;           /* No more input (end of stream, read error or a NUL byte) */
+} StreamBuffer;
+
+/* Read the next block of input behind the buffered bytes; returns 0 if memory runs out */
+int refillStream(StreamBuffer *in, int fd)
+{
+    size_t needed = in->length + stream_block + TOKEN_LOOKAHEAD + 1;
+    if (needed > in->capacity)
+    {
+        size_t capacity = in->capacity ? in->capacity * 2 : 2 * stream_block;
+        if (capacity < needed)
+            capacity = needed;
+        char *data = (char *)realloc(in->data, capacity);
+        if (data == NULL)
+            return 0;
+        in->data = data;
+        in->capacity = capacity;
+    }
+
+    ssize_t n;
+    do
+        n = read(fd, in->data + in->length, stream_block);
+    while (n < 0 && errno == EINTR);
+    if (n <= 0)
+        in->eof = 1;
+    else
+    {
+        in->bytes_read += (size_t)n;
+
+        /* The whole-input lexer stops at the first NUL byte, and so does the stream */
+        char *nul = (char *)memchr(in->data + in->length, '\0', (size_t)n);
+        if (nul != NULL)
+        {
+            n = nul - (in->data + in->length);
+            in->eof = 1;
+        }
+        in->length += (size_t)n;
+    }
+
+    /* The scanner peeks past the terminator; keep those bytes defined */
+    memset(in->data + in->length, 0, TOKEN_LOOKAHEAD + 1);
+    return 1;
+}
+
+/* Print the token table of everything read from fd; returns 0 on error */
+int analyzeStream(int fd)
+{
+    StreamBuffer in = {NULL, 0, 0, 0, 0};
+    double start = nowSeconds();
+    if (!refillStream(&in, fd))
+    {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+    stats.read_time += nowSeconds() - start;
+    if (in.bytes_read == 0)
+    {
+        printf("Error: No input provided\n");
+        free(in.data);
+        return 0;
+    }
+
+    /* Lexing and printing alternate token by token, so both are timed as lexing */
+    start = nowSeconds();
+    printTableHeader(0);
+    initScanner(in.data);
+    for (;;)
+    {
+        const char *resume = scanner.scan_ptr;
+        int line = scanner.line_number;
+        Token token = getNextToken();
+
+        if (!in.eof && (token.type == TOKEN_EOF || scanner.scan_ptr + TOKEN_LOOKAHEAD >= in.data + in.length))
+        {
+            /* Keep the unread tail, let the consumer see what is printed so far, then read on */
+            size_t keep = (size_t)(in.data + in.length - resume);
+            memmove(in.data, resume, keep);
+            in.length = keep;
+            fflush(stdout);
+            stats.lex_time += nowSeconds() - start;
+
+            start = nowSeconds();
+            int ok = refillStream(&in, fd);
+            stats.read_time += nowSeconds() - start;
+            start = nowSeconds();
+            if (!ok)
+            {
+                fprintf(stderr, "Error: Memory allocation failed\n");
+                free(in.data);
+                return 0;
+            }
+            initScanner(in.data);
+            scanner.line_number = line;
+            continue;
+        }
+
+        stats.tokens_by_type[token.type]++;
+        printTokenToFile(token, NULL);
+        if (token.type == TOKEN_EOF)
+            break;
+    }
+    printTableFooter();
+    fflush(stdout);
+    stats.lex_time += nowSeconds() - start;
+    stats.input_bytes = in.bytes_read;
+
+    free(in.data);
+    return 1;
+}
+
+/* ========== BATCH MODE ========== */
+
+/*
+ * "lexer [options] FILE..." (or --files-from=LIST) analyzes many files in one process.
+ * Each result is framed as "#### FILE <index> <status> <bytes> <path>" followed by exactly
+ * <bytes> bytes of the usual output; status is 0 when the file was analyzed and 2 when it
+ * could not be read. Reading, lexing and formatting run as a three-stage pipeline, so the
+ * next files are read and lexed while the previous one is being printed.
+ */
+#define PIPELINE_DEPTH 4
+
+typedef struct
+{
+    int index;
+    const char *path;
+    char *source;         /* NUL-terminated contents, NULL if the file could not be read */
+    size_t size;          /* Bytes read */
+    TokenList tokens;     /* Filled by the lexing stage */
+    Arena arena;          /* Holds the tokens until the file is formatted */
+    CacheMapping mapping; /* Or the cache file they were loaded from (--cache-dir) */
+    int status;           /* 0 = analyzed, 2 = unreadable or out of memory */
+    OutputBuffer out;     /* Formatted result (--jobs) */
+    int done;             /* Set once out is complete (--jobs) */
+} BatchJob;
+
+/* Bounded queue handing jobs from one pipeline stage to the next */
+typedef struct
+{
+    BatchJob *slots[PIPELINE_DEPTH];
+    int head;
+    int count;
+    int closed;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} JobQueue;
+
+typedef struct
+{
+    const char **paths;
+    int count;
+    int records;  /* --emit-tokens instead of the table */
+    JobQueue read_queue;  /* reader -> lexer */
+    JobQueue lexed_queue; /* lexer -> formatter */
+    int failures;
+    Stats reader_stats;    /* Statistics of the helper threads, added after they are joined */
+    Stats formatter_stats;
+} Batch;
+
+/* Statistics are per thread; add those a helper thread left behind to this thread's */
+void addStats(const Stats *from)
+{
+    stats.input_bytes += from->input_bytes;
+    stats.read_time += from->read_time;
+    stats.lex_time += from->lex_time;
+    stats.format_time += from->format_time;
+    for (int i = 0; i <= TOKEN_EOF; i++)
+        stats.tokens_by_type[i] += from->tokens_by_type[i];
+    stats.keyword_probes += from->keyword_probes;
+    stats.output_bytes += from->output_bytes;
+    stats.reused_tokens += from->reused_tokens;
+    stats.cache_hits += from->cache_hits;
+}
+
+void queueInit(JobQueue *queue)
+{
+    queue->head = queue->count = queue->closed = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->changed, NULL);
+}
+
+void queueDestroy(JobQueue *queue)
+{
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->changed);
+}
+
+void queuePush(JobQueue *queue, BatchJob *job)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == PIPELINE_DEPTH)
+        pthread_cond_wait(&queue->changed, &queue->lock);
+    queue->slots[(queue->head + queue->count) % PIPELINE_DEPTH] = job;
+    queue->count++;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/* Take the next job, or NULL once the queue is closed and drained */
+BatchJob *queuePop(JobQueue *queue)
+{
+    BatchJob *job = NULL;
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0 && !queue->closed)
+        pthread_cond_wait(&queue->changed, &queue->lock);
+    if (queue->count > 0)
+    {
+        job = queue->slots[queue->head];
+        queue->head = (queue->head + 1) % PIPELINE_DEPTH;
+        queue->count--;
+        pthread_cond_broadcast(&queue->changed);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return job;
+}
+
+void queueClose(JobQueue *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = 1;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/* Stage 1: read the files in order */
+void *batchReader(void *arg)
+{
+    Batch *batch = (Batch *)arg;
+    for (int i = 0; i < batch->count; i++)
+    {
+        BatchJob *job = (BatchJob *)calloc(1, sizeof(BatchJob));
+        if (job == NULL)
+            break;
+        job->index = i;
+        job->path = batch->paths[i];
+        job->tokens.arena = &job->arena;
+
+        double start = nowSeconds();
+        FILE *file = fopen(job->path, "rb");
+        if (file != NULL)
+        {
+            job->source = readStream(file, &job->size);
+            fclose(file);
+        }
+        stats.read_time += nowSeconds() - start;
+        stats.input_bytes += job->size;
+        queuePush(&batch->read_queue, job);
+    }
+    queueClose(&batch->read_queue);
+    batch->reader_stats = stats;
+    return NULL;
+}
+
+/* Stage 3: format each token list and write it out with its frame header */
+void *batchFormatter(void *arg)
+{
+    Batch *batch = (Batch *)arg;
+    BatchJob *job;
+    while ((job = queuePop(&batch->lexed_queue)) != NULL)
+    {
+        OutputBuffer out = {NULL, 0, 0};
+        double start = nowSeconds();
+
+        emitTarget = &out;
+        if (job->status != 0)
+            emit("Error: Cannot read '%s'\n", job->path);
+        else if (batch->records)
+            printTokenStream(&job->tokens, strlen(job->source));
+        else
+            printTokenTable(&job->tokens);
+        emitTarget = NULL;
+
+        printf("#### FILE %d %d %zu %s\n", job->index, job->status, out.length, job->path);
+        fwrite(out.data, 1, out.length, stdout);
+        stats.format_time += nowSeconds() - start;
+
+        if (job->status != 0)
+            batch->failures++;
+        free(out.data);
+        releaseMapping(&job->mapping);
+        arenaRelease(&job->arena);
+        free(job->source);
+        free(job);
+    }
+    fflush(stdout);
+    arenaRelease(&scratch);
+    batch->formatter_stats = stats;
+    return NULL;
+}
+
+/* Analyze every file; stage 2 (lexing) runs on the calling thread. Returns 1 if all were read */
+int analyzeFiles(const char **paths, int count, int records)
+{
+    Batch batch;
+    batch.paths = paths;
+    batch.count = count;
+    batch.records = records;
+    batch.failures = 0;
+    queueInit(&batch.read_queue);
+    queueInit(&batch.lexed_queue);
+
+    pthread_t reader, formatter;
+    if (pthread_create(&reader, NULL, batchReader, &batch) != 0)
+    {
+        fprintf(stderr, "Error: Cannot start reader thread\n");
+        return 0;
+    }
+    if (pthread_create(&formatter, NULL, batchFormatter, &batch) != 0)
+    {
+        fprintf(stderr, "Error: Cannot start formatter thread\n");
+        pthread_join(reader, NULL);
+        return 0;
+    }
+
+    BatchJob *job;
+    while ((job = queuePop(&batch.read_queue)) != NULL)
+    {
+        double start = nowSeconds();
+        if (job->source == NULL || !tokenizeCached(job->source, &job->tokens, &job->mapping, 0))
+            job->status = 2;
+        stats.lex_time += nowSeconds() - start;
+        queuePush(&batch.lexed_queue, job);
+    }
+    queueClose(&batch.lexed_queue);
+
+    pthread_join(reader, NULL);
+    pthread_join(formatter, NULL);
+    addStats(&batch.reader_stats);
+    addStats(&batch.formatter_stats);
+    queueDestroy(&batch.read_queue);
+    queueDestroy(&batch.lexed_queue);
+    return batch.failures == 0;
+}
+
+/* ========== PARALLEL BATCH MODE ========== */
+
+/*
+ * With --jobs=N (N > 1) the files are spread over N worker threads. They are sorted
+ * largest-first and dealt round-robin into one deque per worker; a worker takes the
+ * largest file left at the front of its own deque and, once that is empty, steals the
+ * smallest from the back of another worker's. Each worker reads, lexes and formats
+ * whole files with its own scanner, statistics and output buffer (all thread-local),
+ * while the calling thread prints the finished files in input order.
+ */
+
+/* Files of one worker, largest first; the owner takes from head, thieves from tail */
+typedef struct
+{
+    int *items; /* Indexes into the job array */
+    int head;
+    int tail;
+    pthread_mutex_t lock;
+} WorkDeque;
+
+typedef struct
+{
+    BatchJob *jobs; /* One per file, in input order */
+    int count;
+    int records;
+    int lazy_lines; /* --columns, copied into every worker */
+    int workers;
+    WorkDeque *deques;
+    pthread_mutex_t done_lock;
+    pthread_cond_t done_changed;
+} WorkPool;
+
+typedef struct
+{
+    WorkPool *pool;
+    int self;
+    Stats stats; /* The worker's statistics, added after it is joined */
+} Worker;
+
+typedef struct
+{
+    int index;
+    long long size;
+} SizedFile;
+
+/* Number of online processors, used when --jobs=0 */
+int cpuCount()
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#else
+    return 1;
+#endif
+}
+
+/* Largest first; equal sizes keep input order so the schedule is reproducible */
+int compareSizeDescending(const void *a, const void *b)
+{
+    const SizedFile *x = (const SizedFile *)a;
+    const SizedFile *y = (const SizedFile *)b;
+    if (x->size != y->size)
+        return x->size < y->size ? 1 : -1;
+    return x->index - y->index;
+}
+
+/* Next job for a worker, or -1 when every deque is empty (no work is ever added) */
+int takeJob(WorkPool *pool, int self)
+{
+    int job = -1;
+    WorkDeque *own = &pool->deques[self];
+    pthread_mutex_lock(&own->lock);
+    if (own->head < own->tail)
+        job = own->items[own->head++];
+    pthread_mutex_unlock(&own->lock);
+
+    for (int k = 1; job < 0 && k < pool->workers; k++)
+    {
+        WorkDeque *victim = &pool->deques[(self + k) % pool->workers];
+        pthread_mutex_lock(&victim->lock);
+        if (victim->head < victim->tail)
+            job = victim->items[--victim->tail];
+        pthread_mutex_unlock(&victim->lock);
+    }
+    return job;
+}
+
+void *poolWorker(void *arg)
+{
+    Worker *worker = (Worker *)arg;
+    WorkPool *pool = worker->pool;
+    Arena arena = {NULL}; /* Reset for every file, so a worker's memory stays flat */
+    int index;
+    while ((index = takeJob(pool, worker->self)) >= 0)
+    {
+        BatchJob *job = &pool->jobs[index];
+        job->tokens.arena = &arena;
+
+        double start = nowSeconds();
+        FILE *file = fopen(job->path, "rb");
+        if (file != NULL)
+        {
+            job->source = readStream(file, &job->size);
+            fclose(file);
+        }
+        stats.read_time += nowSeconds() - start;
+        stats.input_bytes += job->size;
+
+        start = nowSeconds();
+        if (job->source == NULL || !tokenizeCached(job->source, &job->tokens, &job->mapping, 0))
+            job->status = 2;
+        stats.lex_time += nowSeconds() - start;
+
+        start = nowSeconds();
+        emitTarget = &job->out;
+        if (job->status != 0)
+            emit("Error: Cannot read '%s'\n", job->path);
+        else if (pool->records)
+            printTokenStream(&job->tokens, strlen(job->source));
+        else
+            printTokenTable(&job->tokens);
+        emitTarget = NULL;
+        stats.format_time += nowSeconds() - start;
+
+        releaseMapping(&job->mapping);
+        arenaReset(&arena);
+        free(job->source);
+        job->source = NULL;
+
+        pthread_mutex_lock(&pool->done_lock);
+        job->done = 1;
+        pthread_cond_broadcast(&pool->done_changed);
+        pthread_mutex_unlock(&pool->done_lock);
+    }
+    arenaRelease(&arena);
+    arenaRelease(&scratch);
+    worker->stats = stats;
+    return NULL;
+}
+
+/* Analyze every file on `workers` threads; returns 1 if all were read */
+int analyzeFilesParallel(const char **paths, int count, int records, int workers)
+{
+    WorkPool pool;
+    pool.count = count;
+    pool.records = records;
+    pool.lazy_lines = lazy_lines;
+    pool.workers = workers < count ? workers : count;
+    pool.jobs = (BatchJob *)calloc(count, sizeof(BatchJob));
+    pool.deques = (WorkDeque *)calloc(pool.workers, sizeof(WorkDeque));
+    SizedFile *order = (SizedFile *)malloc(count * sizeof(SizedFile));
+    int per_worker = (count + pool.workers - 1) / pool.workers;
+    int *slots = (int *)malloc(pool.workers * per_worker * sizeof(int));
+    Worker *contexts = (Worker *)malloc(pool.workers * sizeof(Worker));
+    pthread_t *threads = (pthread_t *)malloc(pool.workers * sizeof(pthread_t));
+    if (pool.jobs == NULL || pool.deques == NULL || order == NULL || slots == NULL || contexts == NULL || threads == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        free(pool.jobs);
+        free(pool.deques);
+        free(order);
+        free(slots);
+        free(contexts);
+        free(threads);
+        return 0;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        struct stat info;
+        pool.jobs[i].index = i;
+        pool.jobs[i].path = paths[i];
+        order[i].index = i;
+        order[i].size = stat(paths[i], &info) == 0 ? (long long)info.st_size : 0;
+    }
+    qsort(order, count, sizeof(SizedFile), compareSizeDescending);
+
+    for (int w = 0; w < pool.workers; w++)
+    {
+        pool.deques[w].items = slots + w * per_worker;
+        pthread_mutex_init(&pool.deques[w].lock, NULL);
+    }
+    for (int k = 0; k < count; k++)
+    {
+        WorkDeque *deque = &pool.deques[k % pool.workers];
+        deque->items[deque->tail++] = order[k].index;
+    }
+    pthread_mutex_init(&pool.done_lock, NULL);
+    pthread_cond_init(&pool.done_changed, NULL);
+
+    int started = 0;
+    for (; started < pool.workers; started++)
+    {
+        contexts[started].pool = &pool;
+        contexts[started].self = started;
+        if (pthread_create(&threads[started], NULL, poolWorker, &contexts[started]) != 0)
+            break;
+    }
+    /* Deques of workers that could not be started are emptied by stealing */
+    int failures = 0;
+    if (started == 0)
+    {
+        fprintf(stderr, "Error: Cannot start worker threads\n");
+        failures = count;
+    }
+
+    /* Print in input order as soon as each file is finished */
+    for (int i = 0; started > 0 && i < count; i++)
+    {
+        BatchJob *job = &pool.jobs[i];
+        pthread_mutex_lock(&pool.done_lock);
+        while (!job->done)
+            pthread_cond_wait(&pool.done_changed, &pool.done_lock);
+        pthread_mutex_unlock(&pool.done_lock);
+
+        double start = nowSeconds();
+        printf("#### FILE %d %d %zu %s\n", job->index, job->status, job->out.length, job->path);
+        fwrite(job->out.data, 1, job->out.length, stdout);
+        stats.format_time += nowSeconds() - start;
+        if (job->status != 0)
+            failures++;
+        free(job->out.data);
+    }
+    fflush(stdout);
+
+    for (int w = 0; w < started; w++)
+    {
+        pthread_join(threads[w], NULL);
+        addStats(&contexts[w].stats);
+    }
+    for (int w = 0; w < pool.workers; w++)
+        pthread_mutex_destroy(&pool.deques[w].lock);
+    pthread_mutex_destroy(&pool.done_lock);
+    pthread_cond_destroy(&pool.done_changed);
+    free(pool.jobs);
+    free(pool.deques);
+    free(order);
+    free(slots);
+    free(contexts);
+    free(threads);
+    return failures == 0;
+}
+
+/* Read a --files-from list: one path per line, blank lines ignored */
+int readFileList(const char *list_path, char **list_text, const char ***paths, int *count)
+{
+    FILE *file = strcmp(list_path, "-") == 0 ? stdin : fopen(list_path, "rb");
+    size_t size = 0;
+    if (file == NULL)
+        return 0;
+    *list_text = readStream(file, &size);
+    if (file != stdin)
+        fclose(file);
+    if (*list_text == NULL)
+        return 0;
+
+    for (char *line = strtok(*list_text, "\r\n"); line != NULL; line = strtok(NULL, "\r\n"))
+    {
+        const char **grown = (const char **)realloc(*paths, (*count + 1) * sizeof(char *));
+        if (grown == NULL)
+            return 0;
+        *paths = grown;
+        (*paths)[(*count)++] = line;
+    }
+    return 1;
+}
+
+/* ========== STATISTICS ========== */
+
+/* Report --stats results on stderr, as text or as a single JSON line */
+void printStats()
+{
+    long total_tokens = 0;
+    for (int i = 0; i <= TOKEN_EOF; i++)
+        total_tokens += stats.tokens_by_type[i];
+
+    if (stats.json)
+    {
+        fprintf(stderr, "{\"tool\":\"lexer\",\"input_bytes\":%zu,", stats.input_bytes);
+        fprintf(stderr, "\"time_ms\":{\"read\":%.3f,\"lex\":%.3f,\"format\":%.3f},",
+                stats.read_time * 1000, stats.lex_time * 1000, stats.format_time * 1000);
+        fprintf(stderr, "\"tokens\":%ld,\"tokens_by_type\":{", total_tokens);
+        int first = 1;
+        for (int i = 0; i <= TOKEN_EOF; i++)
+        {
+            if (stats.tokens_by_type[i] == 0)
+                continue;
+            fprintf(stderr, "%s\"%s\":%ld", first ? "" : ",", getTokenTypeName((TokenType)i), stats.tokens_by_type[i]);
+            first = 0;
+        }
+        fprintf(stderr, "},\"keyword_probes\":%ld,\"reused_tokens\":%ld,\"cache_hits\":%ld,\"output_bytes\":%ld}\n",
+                stats.keyword_probes, stats.reused_tokens, stats.cache_hits, stats.output_bytes);
+        return;
+    }
+
+    fprintf(stderr, "=== LEXER STATS ===\n");
+    fprintf(stderr, "input bytes     : %zu\n", stats.input_bytes);
+    fprintf(stderr, "read time       : %.3f ms\n", stats.read_time * 1000);
+    fprintf(stderr, "lex time        : %.3f ms\n", stats.lex_time * 1000);
+    fprintf(stderr, "format time     : %.3f ms\n", stats.format_time * 1000);
+    fprintf(stderr, "tokens          : %ld\n", total_tokens);
+    for (int i = 0; i <= TOKEN_EOF; i++)
+    {
+        if (stats.tokens_by_type[i] > 0)
+            fprintf(stderr, "  %-20s: %ld\n", getTokenTypeName((TokenType)i), stats.tokens_by_type[i]);
+    }
+    fprintf(stderr, "keyword probes  : %ld\n", stats.keyword_probes);
+    fprintf(stderr, "reused tokens   : %ld\n", stats.reused_tokens);
+    if (cache_dir != NULL)
+        fprintf(stderr, "cache hits      : %ld\n", stats.cache_hits);
+    fprintf(stderr, "output bytes    : %ld\n", stats.output_bytes);
+}
+
+/* ========== MAIN PROGRAM ========== */
+
+#ifndef CNACK_NO_MAIN
+int main(int argc, char *argv[])
+{
+    char *input = NULL;
+    size_t total_size = 0;
+    int records = 0;
+    const char *previous_stream = NULL;
+    int edit[3] = {-1, -1, -1};
+    const char **paths = NULL; /* Batch mode input files */
+    int path_count = 0;
+    char *file_list = NULL;
+    int jobs = 0; /* Batch worker threads, 0 = one per processor */
+    int stream = 0;
+
+    /* Parse command line options */
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--stats") == 0)
+            stats.enabled = 1;
+        else if (strcmp(argv[i], "--stats=json") == 0)
+            stats.enabled = stats.json = 1;
+        else if (strcmp(argv[i], "--emit-tokens") == 0)
+            records = 1;
+        else if (strcmp(argv[i], "--columns") == 0)
+            lazy_lines = 1;
+        else if (strcmp(argv[i], "--semantic-tokens") == 0)
+            semantic_tokens = 1;
+        else if (strncmp(argv[i], "--cache-dir=", 12) == 0)
+            cache_dir = argv[i] + 12;
+        else if (strncmp(argv[i], "--cache-max-bytes=", 18) == 0)
+            cache_max_bytes = atol(argv[i] + 18);
+        else if (strcmp(argv[i], "--stream") == 0)
+            stream = 1;
+        else if (strncmp(argv[i], "--stream-block=", 15) == 0)
+        {
+            long block = atol(argv[i] + 15);
+            stream_block = block > 0 ? (size_t)block : DEFAULT_STREAM_BLOCK;
+        }
+        else if (strncmp(argv[i], "--incremental=", 14) == 0)
+            previous_stream = argv[i] + 14;
+        else if (strncmp(argv[i], "--edit=", 7) == 0)
+        {
+            if (sscanf(argv[i] + 7, "%d,%d,%d", &edit[0], &edit[1], &edit[2]) != 3)
+            {
+                fprintf(stderr, "Error: --edit expects OFFSET,REMOVED,INSERTED\n");
+                return 1;
+            }
+        }
+        else if (strncmp(argv[i], "--jobs=", 7) == 0)
+            jobs = atoi(argv[i] + 7);
+        else if (strncmp(argv[i], "--chunk-bytes=", 14) == 0)
+            chunk_bytes = (size_t)atol(argv[i] + 14);
+        else if (strncmp(argv[i], "--files-from=", 13) == 0)
+        {
+            if (!readFileList(argv[i] + 13, &file_list, &paths, &path_count))
+            {
+                fprintf(stderr, "Error: Cannot read file list '%s'\n", argv[i] + 13);
+                return 1;
+            }
+        }
+        else if (strncmp(argv[i], "--", 2) != 0)
+        {
+            const char **grown = (const char **)realloc(paths, (path_count + 1) * sizeof(char *));
+            if (grown == NULL)
+            {
+                fprintf(stderr, "Error: Memory allocation failed\n");
+                return 1;
+            }
+            paths = grown;
+            paths[path_count++] = argv[i];
+        }
+        else
+        {
+            fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+    if (previous_stream != NULL && edit[0] < 0)
+    {
+        fprintf(stderr, "Error: --incremental needs --edit=OFFSET,REMOVED,INSERTED\n");
+        return 1;
+    }
+    if (previous_stream != NULL && lazy_lines)
+    {
+        fprintf(stderr, "Error: --columns does not work with --incremental\n");
+        return 1;
+    }
+    if (stream && (records || lazy_lines || previous_stream != NULL || path_count > 0 || file_list != NULL))
+    {
+        fprintf(stderr, "Error: --stream prints the token table of stdin only\n");
+        return 1;
+    }
+    if (semantic_tokens && (records || lazy_lines || stream || previous_stream != NULL || path_count > 0 || file_list != NULL))
+    {
+        fprintf(stderr, "Error: --semantic-tokens works on stdin only, without other output options\n");
+        return 1;
+    }
+
+    /* Batch mode: analyze the given files instead of stdin */
+    if (path_count > 0 || file_list != NULL)
+    {
+        if (previous_stream != NULL)
+        {
+            fprintf(stderr, "Error: --incremental works on stdin only\n");
+            return 1;
+        }
+        if (jobs <= 0)
+            jobs = cpuCount();
+        int ok = jobs > 1 && path_count > 1 ? analyzeFilesParallel(paths, path_count, records, jobs)
+                                            : analyzeFiles(paths, path_count, records);
+        if (stats.enabled)
+            printStats();
+        free(paths);
+        free(file_list);
+        return ok ? 0 : 1;
+    }
+
+    /* Streaming mode: print tokens while stdin is still being read */
+    if (stream)
+    {
+        int ok = analyzeStream(STDIN_FILENO);
+        if (stats.enabled)
+            printStats();
+        return ok ? 0 : 1;
+    }
+
+    double read_start = nowSeconds();
+
+    /* Read all input from stdin */
+    input = readStream(stdin, &total_size);
+    if (input == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 1;
+    }
+    stats.input_bytes = total_size;
+    stats.read_time = nowSeconds() - read_start;
+
+    /* Check if we got any input */
+    if (total_size == 0)
+    {
+        printf("Error: No input provided\n");
+        free(input);
+        return 1;
+    }
+
+    /* Analyze the input code, or only the edited part of it */
+    int ok;
+    if (previous_stream != NULL)
+    {
+        TokenList old = {0};
+        long old_bytes = readTokenStream(previous_stream, &old);
+        ok = old_bytes >= 0 &&
+             relexIncremental(input, strlen(input), &old, old_bytes, edit[0], edit[1], edit[2]);
+        freeTokens(&old);
+    }
+    else
+    {
+        lex_jobs = jobs > 0 ? jobs : cpuCount();
+        ok = analyzeCode(input, records);
+    }
+
+    if (stats.enabled)
+        printStats();
+
+    /* Clean up */
+    free(input);
+
+    return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,830 @@
+/* ========== CNACK LANGUAGE SERVER ========== */
+/* Language Server Protocol over stdio, built with `npm run build` (build/lsp). An editor starts
+   it as `lsp [--max-steps=N] [--timeout-ms=N] [--no-jit]`; the options are the parser's.
+
+     textDocument/didOpen, didChange (incremental), didClose
+     textDocument/publishDiagnostics   every diagnostic of a parse and run, with its code
+     textDocument/semanticTokens/full  from the parser's own scanner
+     textDocument/definition           where the type checker first gave a variable its type
+
+   Open documents live in memory and are edited in place, so a change costs one parse of the
+   document and no process start. Positions are in UTF-16 code units, as LSP requires. */
+
+#define CNACK_NO_MAIN
+#include "../parser.c"
+
+#include <strings.h>
+
+/* ========== JSON VALUES ========== */
+
+typedef enum { JSON_NULL, JSON_FALSE, JSON_TRUE, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT } JsonKind;
+
+typedef struct JsonValue
+{
+    JsonKind kind;
+    const char *key;  /* member name inside an object */
+    const char *text; /* decoded string, or the source text of a number */
+    size_t length;
+    double number;
+    struct JsonValue *child, *next;
+} JsonValue;
+
+typedef struct
+{
+    const char *at, *end;
+    int depth;
+} JsonReader;
+
+#define JSON_MAX_DEPTH 64
+
+static Arena messageArena; /* the current message's values, freed when the next one arrives */
+
+/* Length of the valid UTF-8 sequence at p, or 0 */
+static size_t utf8Length(const unsigned char *p, size_t left)
+{
+    size_t n = p[0] < 0x80 ? 1 : (p[0] & 0xE0) == 0xC0 && p[0] >= 0xC2 ? 2 : (p[0] & 0xF0) == 0xE0 ? 3 : (p[0] & 0xF8) == 0xF0 && p[0] <= 0xF4 ? 4 : 0;
+    if (n == 0 || n > left)
+        return 0;
+    for (size_t i = 1; i < n; i++)
+        if ((p[i] & 0xC0) != 0x80)
+            return 0;
+    return n;
+}
+
+static size_t utf8Encode(char *out, unsigned code)
+{
+    if (code < 0x80) { out[0] = (char)code; return 1; }
+    if (code < 0x800) { out[0] = (char)(0xC0 | code >> 6); out[1] = (char)(0x80 | (code & 0x3F)); return 2; }
+    if (code < 0x10000) { out[0] = (char)(0xE0 | code >> 12); out[1] = (char)(0x80 | (code >> 6 & 0x3F)); out[2] = (char)(0x80 | (code & 0x3F)); return 3; }
+    out[0] = (char)(0xF0 | code >> 18); out[1] = (char)(0x80 | (code >> 12 & 0x3F)); out[2] = (char)(0x80 | (code >> 6 & 0x3F)); out[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+/* Four hex digits at p, or -1 */
+static long hex4(const char *p, const char *end)
+{
+    if (end - p < 4)
+        return -1;
+    long value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        char c = p[i];
+        int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (digit < 0)
+            return -1;
+        value = value * 16 + digit;
+    }
+    return value;
+}
+
+/* The string starting at the opening quote, decoded into the arena; escapes never make it longer */
+static const char *readString(JsonReader *r, size_t *length)
+{
+    const char *close = ++r->at;
+    while (close < r->end && *close != '"')
+        close += *close == '\\' ? 2 : 1;
+    if (close >= r->end)
+        return NULL;
+
+    char *out = (char *)arenaAlloc(&messageArena, (size_t)(close - r->at) + 1);
+    size_t n = 0;
+    while (r->at < close)
+    {
+        char c = *r->at++;
+        if (c != '\\')
+        {
+            out[n++] = c;
+            continue;
+        }
+        switch (c = *r->at++)
+        {
+        case 'n': out[n++] = '\n'; break;
+        case 't': out[n++] = '\t'; break;
+        case 'r': out[n++] = '\r'; break;
+        case 'b': out[n++] = '\b'; break;
+        case 'f': out[n++] = '\f'; break;
+        case '"': case '\\': case '/': out[n++] = c; break;
+        case 'u':
+        {
+            long code = hex4(r->at, close);
+            if (code < 0)
+                return NULL;
+            r->at += 4;
+            if (code >= 0xD800 && code < 0xDC00 && close - r->at >= 6 && r->at[0] == '\\' && r->at[1] == 'u')
+            {
+                long low = hex4(r->at + 2, close);
+                if (low >= 0xDC00 && low < 0xE000)
+                {
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    r->at += 6;
+                }
+            }
+            n += utf8Encode(out + n, (unsigned)code);
+            break;
+        }
+        default: return NULL;
+        }
+    }
+    r->at = close + 1;
+    out[n] = '\0';
+    *length = n;
+    return out;
+}
+
+static void skipSpace(JsonReader *r)
+{
+    while (r->at < r->end && (*r->at == ' ' || *r->at == '\t' || *r->at == '\n' || *r->at == '\r'))
+        r->at++;
+}
+
+static int readWord(JsonReader *r, const char *word)
+{
+    size_t n = strlen(word);
+    if ((size_t)(r->end - r->at) < n || memcmp(r->at, word, n) != 0)
+        return 0;
+    r->at += n;
+    return 1;
+}
+
+/* One value; NULL if the text is not JSON. The body is NUL-terminated, so strtod stops in it. */
+static JsonValue *readValue(JsonReader *r)
+{
+    skipSpace(r);
+    if (r->at >= r->end || r->depth >= JSON_MAX_DEPTH)
+        return NULL;
+    JsonValue *v = (JsonValue *)arenaAlloc(&messageArena, sizeof(JsonValue));
+    memset(v, 0, sizeof(*v));
+
+    char c = *r->at;
+    if (c == '{' || c == '[')
+    {
+        char close = c == '{' ? '}' : ']';
+        v->kind = c == '{' ? JSON_OBJECT : JSON_ARRAY;
+        r->at++;
+        skipSpace(r);
+        if (r->at < r->end && *r->at == close)
+        {
+            r->at++;
+            return v;
+        }
+        r->depth++;
+        for (JsonValue **tail = &v->child;;)
+        {
+            const char *key = NULL;
+            size_t keyLength;
+            if (v->kind == JSON_OBJECT)
+            {
+                skipSpace(r);
+                if (r->at >= r->end || *r->at != '"' || (key = readString(r, &keyLength)) == NULL)
+                    return NULL;
+                skipSpace(r);
+                if (r->at >= r->end || *r->at++ != ':')
+                    return NULL;
+            }
+            JsonValue *item = readValue(r);
+            if (item == NULL)
+                return NULL;
+            item->key = key;
+            *tail = item;
+            tail = &item->next;
+            skipSpace(r);
+            if (r->at < r->end && *r->at == ',')
+                r->at++;
+            else if (r->at < r->end && *r->at == close)
+            {
+                r->at++;
+                break;
+            }
+            else
+                return NULL;
+        }
+        r->depth--;
+    }
+    else if (c == '"')
+    {
+        v->kind = JSON_STRING;
+        if ((v->text = readString(r, &v->length)) == NULL)
+            return NULL;
+    }
+    else if (readWord(r, "true"))
+        v->kind = JSON_TRUE;
+    else if (readWord(r, "false"))
+        v->kind = JSON_FALSE;
+    else if (readWord(r, "null"))
+        v->kind = JSON_NULL;
+    else
+    {
+        char *end;
+        v->number = strtod(r->at, &end);
+        if (end == r->at || end > r->end)
+            return NULL;
+        v->kind = JSON_NUMBER;
+        v->text = r->at;
+        v->length = (size_t)(end - r->at);
+        r->at = end;
+    }
+    return v;
+}
+
+static JsonValue *jsonGet(const JsonValue *object, const char *key)
+{
+    if (object == NULL || object->kind != JSON_OBJECT)
+        return NULL;
+    for (JsonValue *member = object->child; member; member = member->next)
+        if (strcmp(member->key, key) == 0)
+            return member;
+    return NULL;
+}
+
+static const char *jsonText(const JsonValue *v) { return v && v->kind == JSON_STRING ? v->text : NULL; }
+static long jsonLong(const JsonValue *v, long fallback) { return v && v->kind == JSON_NUMBER ? (long)v->number : fallback; }
+
+/* ========== JSON OUTPUT ========== */
+
+static void put(OutputBuffer *out, const char *text) { appendOutput(out, text, strlen(text)); }
+
+static void putf(OutputBuffer *out, const char *format, ...)
+{
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (len > 0)
+        appendOutput(out, text, (size_t)len < sizeof(text) ? (size_t)len : sizeof(text) - 1);
+}
+
+/* A JSON string; bytes that are not UTF-8 become U+FFFD so the message stays valid */
+static void putString(OutputBuffer *out, const char *text, size_t length)
+{
+    const unsigned char *p = (const unsigned char *)text, *end = p + length;
+    put(out, "\"");
+    while (p < end)
+    {
+        size_t n = utf8Length(p, (size_t)(end - p));
+        if (n == 0)
+        {
+            put(out, "\xEF\xBF\xBD");
+            p++;
+        }
+        else if (*p == '"' || *p == '\\')
+        {
+            appendOutput(out, "\\", 1);
+            appendOutput(out, (const char *)p++, 1);
+        }
+        else if (*p < 0x20)
+            putf(out, "\\u%04x", *p++);
+        else
+        {
+            appendOutput(out, (const char *)p, n);
+            p += n;
+        }
+    }
+    put(out, "\"");
+}
+
+/* A request id is echoed as it came: a number or a string */
+static void putId(OutputBuffer *out, const JsonValue *id)
+{
+    if (id && id->kind == JSON_NUMBER)
+        appendOutput(out, id->text, id->length);
+    else if (id && id->kind == JSON_STRING)
+        putString(out, id->text, id->length);
+    else
+        put(out, "null");
+}
+
+static void sendMessage(const OutputBuffer *body)
+{
+    printf("Content-Length: %zu\r\n\r\n", body->length);
+    fwrite(body->data, 1, body->length, stdout);
+    fflush(stdout);
+}
+
+static void sendResult(const JsonValue *id, const char *result, size_t length)
+{
+    OutputBuffer out = {0};
+    put(&out, "{\"jsonrpc\":\"2.0\",\"id\":");
+    putId(&out, id);
+    put(&out, ",\"result\":");
+    appendOutput(&out, result, length);
+    put(&out, "}");
+    sendMessage(&out);
+    free(out.data);
+}
+
+static void sendError(const JsonValue *id, int code, const char *message)
+{
+    OutputBuffer out = {0};
+    put(&out, "{\"jsonrpc\":\"2.0\",\"id\":");
+    putId(&out, id);
+    putf(&out, ",\"error\":{\"code\":%d,\"message\":", code);
+    putString(&out, message, strlen(message));
+    put(&out, "}}");
+    sendMessage(&out);
+    free(out.data);
+}
+
+/* ========== DOCUMENTS ========== */
+
+typedef struct Document
+{
+    char *uri;
+    char *text; /* NUL-terminated */
+    size_t length, capacity;
+    struct Document *next;
+} Document;
+
+static Document *documents = NULL;
+
+/* A byte offset and its LSP position; moved forward through a document */
+typedef struct
+{
+    size_t offset;
+    long line, character;
+} Cursor;
+
+static Document *findDocument(const char *uri)
+{
+    for (Document *doc = documents; doc; doc = doc->next)
+        if (uri && strcmp(doc->uri, uri) == 0)
+            return doc;
+    return NULL;
+}
+
+/* Replace bytes [start, end) with text */
+static int spliceDocument(Document *doc, size_t start, size_t end, const char *text, size_t length)
+{
+    size_t newLength = doc->length - (end - start) + length;
+    if (newLength + 1 > doc->capacity)
+    {
+        size_t cap = (newLength + 1) * 2;
+        char *grown = (char *)realloc(doc->text, cap);
+        if (grown == NULL)
+            return 0;
+        doc->text = grown;
+        doc->capacity = cap;
+    }
+    memmove(doc->text + start + length, doc->text + end, doc->length - end + 1);
+    memcpy(doc->text + start, text, length);
+    doc->length = newLength;
+    return 1;
+}
+
+static Document *openDocument(const char *uri, const char *text, size_t length)
+{
+    Document *doc = findDocument(uri);
+    if (doc == NULL)
+    {
+        doc = (Document *)calloc(1, sizeof(Document));
+        if (doc == NULL || (doc->uri = strdup(uri)) == NULL || (doc->text = (char *)calloc(1, 1)) == NULL)
+        {
+            if (doc)
+                free(doc->uri);
+            free(doc);
+            return NULL;
+        }
+        doc->capacity = 1;
+        doc->next = documents;
+        documents = doc;
+    }
+    return spliceDocument(doc, 0, doc->length, text, length) ? doc : NULL;
+}
+
+static void closeDocument(const char *uri)
+{
+    for (Document **link = &documents; *link; link = &(*link)->next)
+        if (strcmp((*link)->uri, uri) == 0)
+        {
+            Document *doc = *link;
+            *link = doc->next;
+            free(doc->uri);
+            free(doc->text);
+            free(doc);
+            return;
+        }
+}
+
+/* Move the cursor forward to a byte offset; a character outside the BMP is two UTF-16 units */
+static void moveTo(const Document *doc, Cursor *at, size_t offset)
+{
+    while (at->offset < offset && at->offset < doc->length)
+    {
+        if (doc->text[at->offset] == '\n')
+        {
+            at->line++;
+            at->character = 0;
+            at->offset++;
+            continue;
+        }
+        size_t n = utf8Length((const unsigned char *)doc->text + at->offset, doc->length - at->offset);
+        at->character += n == 4 ? 2 : 1;
+        at->offset += n ? n : 1;
+    }
+}
+
+static long utf16Units(const char *text, size_t length)
+{
+    long units = 0;
+    for (size_t i = 0; i < length;)
+    {
+        size_t n = utf8Length((const unsigned char *)text + i, length - i);
+        units += n == 4 ? 2 : 1;
+        i += n ? n : 1;
+    }
+    return units;
+}
+
+/* Byte offset of an LSP position; a character past the end of its line means the line end */
+static size_t offsetAt(const Document *doc, long line, long character)
+{
+    size_t at = 0;
+    while (line > 0 && at < doc->length)
+        if (doc->text[at++] == '\n')
+            line--;
+    while (character > 0 && at < doc->length && doc->text[at] != '\n')
+    {
+        size_t n = utf8Length((const unsigned char *)doc->text + at, doc->length - at);
+        character -= n == 4 ? 2 : 1;
+        at += n ? n : 1;
+    }
+    return at;
+}
+
+static void putPosition(OutputBuffer *out, const Document *doc, size_t offset)
+{
+    Cursor at = {0, 0, 0};
+    moveTo(doc, &at, offset);
+    putf(out, "{\"line\":%ld,\"character\":%ld}", at.line, at.character);
+}
+
+static void putRange(OutputBuffer *out, const Document *doc, size_t start, size_t end)
+{
+    put(out, "{\"start\":");
+    putPosition(out, doc, start);
+    put(out, ",\"end\":");
+    putPosition(out, doc, end);
+    put(out, "}");
+}
+
+/* Apply one contentChanges entry: a range edit, or the whole text when there is no range */
+static int applyChange(Document *doc, const JsonValue *change)
+{
+    const JsonValue *text = jsonGet(change, "text"), *range = jsonGet(change, "range");
+    if (text == NULL || text->kind != JSON_STRING)
+        return 0;
+    if (range == NULL)
+        return spliceDocument(doc, 0, doc->length, text->text, text->length);
+
+    const JsonValue *start = jsonGet(range, "start"), *end = jsonGet(range, "end");
+    size_t from = offsetAt(doc, jsonLong(jsonGet(start, "line"), 0), jsonLong(jsonGet(start, "character"), 0));
+    size_t to = offsetAt(doc, jsonLong(jsonGet(end, "line"), 0), jsonLong(jsonGet(end, "character"), 0));
+    if (to < from)
+        to = from;
+    return spliceDocument(doc, from, to, text->text, text->length);
+}
+
+/* ========== DIAGNOSTICS ========== */
+
+/* Byte range a diagnostic covers: the lexeme it points at if that is on its line, else the
+   line without its indentation */
+static void diagnosticRange(const Document *doc, const Diagnostic *d, size_t *start, size_t *end)
+{
+    size_t lineStart = offsetAt(doc, d->line > 0 ? d->line - 1 : 0, 0), lineEnd = lineStart;
+    while (lineEnd < doc->length && doc->text[lineEnd] != '\n')
+        lineEnd++;
+
+    if (d->start >= 0 && (size_t)d->start >= lineStart && (size_t)(d->start + d->length) <= lineEnd && d->length > 0)
+    {
+        *start = (size_t)d->start;
+        *end = (size_t)(d->start + d->length);
+        return;
+    }
+
+    while (lineStart < lineEnd && isspace((unsigned char)doc->text[lineStart]))
+        lineStart++;
+    while (lineEnd > lineStart && isspace((unsigned char)doc->text[lineEnd - 1]))
+        lineEnd--;
+    *start = lineStart;
+    *end = lineEnd;
+}
+
+/* Parse and run the document as the parser binary would, and publish its reports */
+static void publishDiagnostics(Document *doc)
+{
+    BatchJob job;
+    memset(&job, 0, sizeof(job));
+    job.path = doc->uri;
+    job.source = doc->text;
+    job.size = doc->length;
+    parseJob(&job);
+
+    OutputBuffer out = {0};
+    put(&out, "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":");
+    putString(&out, doc->uri, strlen(doc->uri));
+    put(&out, ",\"diagnostics\":[");
+    for (int i = 0; i < diagnostics.count; i++)
+    {
+        const Diagnostic *d = &diagnostics.items[i];
+        size_t from, to;
+        diagnosticRange(doc, d, &from, &to);
+        put(&out, i ? ",{\"range\":" : "{\"range\":");
+        putRange(&out, doc, from, to);
+        put(&out, ",\"severity\":1,\"source\":\"cnack\",\"code\":");
+        putString(&out, diagnosticInfo[d->code].code, strlen(diagnosticInfo[d->code].code));
+        put(&out, ",\"message\":");
+        putString(&out, diagnostics.text.data + d->message, (size_t)d->messageLen);
+        put(&out, "}");
+    }
+    put(&out, "]}}");
+    sendMessage(&out);
+    free(out.data);
+    free(job.out.data);
+}
+
+static void clearDiagnostics(const char *uri)
+{
+    OutputBuffer out = {0};
+    put(&out, "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":");
+    putString(&out, uri, strlen(uri));
+    put(&out, ",\"diagnostics\":[]}}");
+    sendMessage(&out);
+    free(out.data);
+}
+
+/* ========== SEMANTIC TOKENS ========== */
+
+static const char *semanticLegend = "[\"keyword\",\"type\",\"function\",\"variable\",\"number\",\"string\",\"comment\",\"operator\"]";
+enum { SEMANTIC_NONE = -1, SEMANTIC_KEYWORD, SEMANTIC_TYPE, SEMANTIC_FUNCTION, SEMANTIC_VARIABLE, SEMANTIC_NUMBER, SEMANTIC_STRING, SEMANTIC_COMMENT, SEMANTIC_OPERATOR };
+
+/* previous: the token before, comments skipped, so the name after 'fn' is a function */
+static int semanticType(Token token, TokenType previous)
+{
+    if (token.type >= TOKEN_TYPE_INT && token.type <= TOKEN_TYPE_STRING)
+        return SEMANTIC_TYPE;
+    if (token.type >= TOKEN_KW_CONST && token.type <= TOKEN_RW_AUTO_REF)
+        return SEMANTIC_KEYWORD;
+    if (token.type >= TOKEN_ADD_OP && token.type <= TOKEN_QUANTUM_POINTER_OP)
+        return SEMANTIC_OPERATOR;
+    switch (token.type)
+    {
+    case TOKEN_IDENTIFIER: return previous == TOKEN_KW_FN ? SEMANTIC_FUNCTION : isType(token) ? SEMANTIC_TYPE : SEMANTIC_VARIABLE;
+    case TOKEN_NUMBER_INT: case TOKEN_NUMBER_FLOAT: return SEMANTIC_NUMBER;
+    case TOKEN_STRING: return SEMANTIC_STRING;
+    case TOKEN_SINGLE_COMMENT: case TOKEN_MULTI_COMMENT: return SEMANTIC_COMMENT;
+    default: return SEMANTIC_NONE;
+    }
+}
+
+/* {"data":[...]}: five numbers per token, relative to the previous one. A token over several
+   lines (a block comment) is sent once per line, as clients need not accept multi-line tokens. */
+static void semanticTokens(OutputBuffer *out, const Document *doc)
+{
+    Cursor at = {0, 0, 0};
+    long lastLine = 0, lastCharacter = 0;
+    int count = 0;
+    TokenType previous = TOKEN_EOF;
+
+    put(out, "{\"data\":[");
+    initScanner(doc->text);
+    for (Token token = getNextToken(); token.type != TOKEN_EOF; token = getNextToken())
+    {
+        if (token.type == TOKEN_ERROR)
+            continue; /* its lexeme is the error message, not source text */
+        int type = semanticType(token, previous);
+        if (token.type != TOKEN_SINGLE_COMMENT && token.type != TOKEN_MULTI_COMMENT)
+            previous = token.type;
+        if (type == SEMANTIC_NONE)
+            continue;
+
+        size_t start = (size_t)(token.lexeme_start - doc->text), end = start + (size_t)token.lexeme_length;
+        while (start < end)
+        {
+            size_t lineEnd = start;
+            while (lineEnd < end && doc->text[lineEnd] != '\n')
+                lineEnd++;
+            moveTo(doc, &at, start);
+            long length = utf16Units(doc->text + start, lineEnd - start);
+            if (length > 0)
+            {
+                putf(out, "%s%ld,%ld,%ld,%d,0", count++ ? "," : "", at.line - lastLine,
+                     at.line == lastLine ? at.character - lastCharacter : at.character, length, type);
+                lastLine = at.line;
+                lastCharacter = at.character;
+            }
+            start = lineEnd + 1;
+        }
+    }
+    put(out, "]}");
+}
+
+/* ========== GO TO DEFINITION ========== */
+
+/* A Location, or null when the position is not on a variable the type checker knows */
+static void definition(OutputBuffer *out, const Document *doc, size_t offset)
+{
+    Token name;
+    int found = 0;
+    initScanner(doc->text);
+    for (Token token = getNextToken(); token.type != TOKEN_EOF && !found; token = getNextToken())
+    {
+        if (token.type == TOKEN_ERROR)
+            continue;
+        size_t start = (size_t)(token.lexeme_start - doc->text);
+        if (start > offset)
+            break;
+        if (token.type == TOKEN_IDENTIFIER && offset <= start + (size_t)token.lexeme_length)
+        {
+            name = token;
+            found = 1;
+        }
+    }
+    if (!found)
+    {
+        put(out, "null");
+        return;
+    }
+
+    /* The checker's [Type Error] lines go to a scratch buffer; the table stays until the next reset */
+    OutputBuffer scratch = {0};
+    emitTarget = &scratch;
+    resetParserState();
+    checkTypes(doc->text);
+    emitTarget = NULL;
+    free(scratch.data);
+
+    char text[MAX_VAR_LEN];
+    copyLexeme(text, sizeof(text), name);
+    TypedName *typed = typedName(text);
+    if (typed == NULL)
+    {
+        put(out, "null");
+        return;
+    }
+    size_t start = (size_t)(typed->definition.lexeme_start - doc->text);
+    put(out, "{\"uri\":");
+    putString(out, doc->uri, strlen(doc->uri));
+    put(out, ",\"range\":");
+    putRange(out, doc, start, start + (size_t)typed->definition.lexeme_length);
+    put(out, "}");
+}
+
+/* ========== MESSAGES ========== */
+
+static int shutdownRequested = 0;
+
+/* The body of the next "Content-Length: N" framed message, NUL-terminated; NULL at the end */
+static char *readMessage(size_t *length)
+{
+    char header[1024];
+    size_t contentLength = 0;
+    int haveLength = 0;
+    while (fgets(header, sizeof(header), stdin))
+    {
+        if (strcmp(header, "\r\n") == 0 || strcmp(header, "\n") == 0)
+        {
+            if (haveLength)
+                break;
+            continue;
+        }
+        if (strncasecmp(header, "Content-Length:", 15) == 0)
+        {
+            contentLength = strtoul(header + 15, NULL, 10);
+            haveLength = 1;
+        }
+    }
+    if (!haveLength || feof(stdin))
+        return NULL;
+
+    char *body = (char *)malloc(contentLength + 1);
+    if (body == NULL || fread(body, 1, contentLength, stdin) != contentLength)
+    {
+        free(body);
+        return NULL;
+    }
+    body[contentLength] = '\0';
+    *length = contentLength;
+    return body;
+}
+
+static void initialize(const JsonValue *id)
+{
+    OutputBuffer out = {0};
+    put(&out, "{\"capabilities\":{\"positionEncoding\":\"utf-16\",\"textDocumentSync\":{\"openClose\":true,\"change\":2},"
+              "\"definitionProvider\":true,\"semanticTokensProvider\":{\"legend\":{\"tokenTypes\":");
+    put(&out, semanticLegend);
+    put(&out, ",\"tokenModifiers\":[]},\"full\":true}},\"serverInfo\":{\"name\":\"cnack-lsp\",\"version\":\"1.0.0\"}}");
+    sendResult(id, out.data, out.length);
+    free(out.data);
+}
+
+/* Handle one message; returns 0 after "exit" */
+static int handleMessage(const char *body, size_t length)
+{
+    arenaReset(&messageArena);
+    JsonReader reader = {body, body + length, 0};
+    JsonValue *message = readValue(&reader);
+    if (message == NULL || message->kind != JSON_OBJECT)
+    {
+        sendError(NULL, -32700, "Parse error");
+        return 1;
+    }
+    const char *method = jsonText(jsonGet(message, "method"));
+    const JsonValue *id = jsonGet(message, "id"), *params = jsonGet(message, "params");
+    const JsonValue *textDocument = jsonGet(params, "textDocument");
+    const char *uri = jsonText(jsonGet(textDocument, "uri"));
+    if (method == NULL)
+        return 1; /* a response to a request of ours; none are sent */
+
+    if (strcmp(method, "initialize") == 0)
+        initialize(id);
+    else if (strcmp(method, "shutdown") == 0)
+    {
+        shutdownRequested = 1;
+        sendResult(id, "null", 4);
+    }
+    else if (strcmp(method, "exit") == 0)
+        return 0;
+    else if (strcmp(method, "textDocument/didOpen") == 0)
+    {
+        const JsonValue *text = jsonGet(textDocument, "text");
+        Document *doc = uri && text && text->kind == JSON_STRING ? openDocument(uri, text->text, text->length) : NULL;
+        if (doc)
+            publishDiagnostics(doc);
+    }
+    else if (strcmp(method, "textDocument/didChange") == 0)
+    {
+        Document *doc = findDocument(uri);
+        const JsonValue *changes = jsonGet(params, "contentChanges");
+        if (doc && changes && changes->kind == JSON_ARRAY)
+        {
+            for (const JsonValue *change = changes->child; change; change = change->next)
+                applyChange(doc, change);
+            publishDiagnostics(doc);
+        }
+    }
+    else if (strcmp(method, "textDocument/didClose") == 0)
+    {
+        if (findDocument(uri))
+        {
+            closeDocument(uri);
+            clearDiagnostics(uri);
+        }
+    }
+    else if (strcmp(method, "textDocument/semanticTokens/full") == 0 || strcmp(method, "textDocument/definition") == 0)
+    {
+        Document *doc = findDocument(uri);
+        if (doc == NULL)
+        {
+            sendError(id, -32602, "Unknown document");
+            return 1;
+        }
+        OutputBuffer out = {0};
+        if (method[13] == 's')
+            semanticTokens(&out, doc);
+        else
+        {
+            const JsonValue *position = jsonGet(params, "position");
+            definition(&out, doc, offsetAt(doc, jsonLong(jsonGet(position, "line"), 0), jsonLong(jsonGet(position, "character"), 0)));
+        }
+        sendResult(id, out.data, out.length);
+        free(out.data);
+    }
+    else if (id != NULL)
+        sendError(id, -32601, "Method not found");
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--max-steps=", 12) == 0)
+        {
+            if (!parseCount(argv[i] + 12, 0, LONG_MAX, &maxSteps))
+                return optionError("--max-steps", "a step count (0 = unlimited)");
+        }
+        else if (strncmp(argv[i], "--timeout-ms=", 13) == 0)
+        {
+            if (!parseCount(argv[i] + 13, 0, LONG_MAX, &timeoutMs))
+                return optionError("--timeout-ms", "milliseconds (0 = unlimited)");
+        }
+        else if (strcmp(argv[i], "--no-jit") == 0)
+            useJit = 0;
+        else
+        {
+            fprintf(stderr, "Usage: lsp [--max-steps=N] [--timeout-ms=N] [--no-jit]\n");
+            return 1;
+        }
+    }
+
+    size_t length;
+    char *body;
+    int running = 1;
+    while (running && (body = readMessage(&length)) != NULL)
+    {
+        running = handleMessage(body, length);
+        free(body);
+    }
+    return shutdownRequested ? 0 : 1;
+}
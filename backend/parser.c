@@ -3,6 +3,29 @@
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define CNACK_MMAP 1 /* cache files are mapped, section 4 */
+#endif
+#if defined(CNACK_MMAP) && defined(__x86_64__) && defined(__linux__)
+#define CNACK_JIT 1 /* loop JIT, section 7 */
+#endif
+#ifdef _WIN32
+#include <direct.h>
+#endif
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
 
 /* ========================================================================= */
 /* 1. LEXER DEFINITIONS & LOGIC                                              */
@@ -31,9 +54,11 @@ typedef enum {
 
 typedef struct {
     TokenType type;
-    const char *lexeme_start;
+    const char *lexeme_start; /* TOKEN_ERROR: the error message */
     int lexeme_length;
     int line;
+    const char *error_start; /* TOKEN_ERROR: the source text scanned for it */
+    int error_length;
 } Token;
 
 typedef struct {
@@ -43,7 +68,8 @@ typedef struct {
     int line_number;
 } Scanner;
 
-Scanner scanner;
+/* Everything one parse changes is thread-local, so batch workers (--jobs) parse files side by side */
+_Thread_local Scanner scanner;
 
 typedef struct {
     const char *keyword;
@@ -65,6 +91,40 @@ KeywordMapping keywords[] = {
 };
 int keywordCount = 30;
 
+/* Instrumentation collected when --stats is given */
+typedef struct {
+    int enabled, json;
+    size_t input_bytes;
+    double read_time, lex_time, parse_time, exec_time, format_time;
+    long tokens_by_type[TOKEN_EOF + 1];
+    long keyword_probes, symbol_lookups, relexed_tokens, output_bytes;
+    int cached_units, reused_units; /* --cache: units in the cache file and units replayed from it */
+    const char *high_water;   /* Furthest source position lexed so far */
+    int exec_depth;           /* Nesting of loop re-executions being timed */
+    double exec_start;
+} Stats;
+
+_Thread_local Stats stats;
+
+const char *tokenTypeNames[] = {
+    "COMMA", "SEMICOLON", "COLON", "L_PAREN", "R_PAREN", "L_BRACE", "R_BRACE", "L_BRACKET", "R_BRACKET",
+    "ADD_OP", "SUB_OP", "MULT_OP", "DIV_OP", "MOD_OP", "EXPO_OP",
+    "ASSIGN_OP", "ADD_ASSIGN_OP", "SUB_ASSIGN_OP", "MULT_ASSIGN_OP", "DIV_ASSIGN_OP", "MOD_ASSIGN_OP",
+    "ADDRESS_OF_OP", "INCREMENT_OP", "DECREMENT_OP",
+    "EQUAL_TO_OP", "NOT_EQUAL_TO_OP", "GREATER_OP", "GREATER_EQUAL_OP", "LESS_OP", "LESS_EQUAL_OP",
+    "LOGICAL_NOT_OP", "LOGICAL_AND_OP", "LOGICAL_OR_OP",
+    "POINTER_OP", "ARROW_OP", "QUANTUM_POINTER_OP",
+    "IDENTIFIER", "NUMBER_INT", "NUMBER_FLOAT", "STRING",
+    "TYPE_INT", "TYPE_FLOAT", "TYPE_CHAR", "TYPE_BOOL", "TYPE_STRING",
+    "KW_CONST", "KW_IF", "KW_ELSE", "KW_ELIF", "KW_SWITCH", "KW_CASE", "KW_DEFAULT",
+    "KW_ASSIGN", "KW_FOR", "KW_WHILE", "KW_DO", "KW_BREAK", "KW_CONTINUE",
+    "KW_ASK", "KW_DISPLAY", "KW_TRUE", "KW_FALSE", "KW_FN", "KW_STRUCT",
+    "RW_EXECUTE", "RW_EXIT", "RW_FETCH", "RW_WHEN", "RW_OTHERWISE", "RW_AUTO_REF",
+    "SINGLE_COMMENT", "MULTI_COMMENT", "ERROR", "EOF"
+};
+
+double nowSeconds() { struct timespec ts; timespec_get(&ts, TIME_UTC); return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9; }
+
 int isLetter(char c) { return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'); }
 int isDigit(char c) { return c >= '0' && c <= '9'; }
 int isWhitespace(char c) { return (c == ' ' || c == '\t' || c == '\n' || c == '\r'); }
@@ -85,19 +145,17 @@ Token createToken(TokenType type) {
     tok.lexeme_length = (int)(scanner.scan_ptr - scanner.token_start); tok.line = scanner.line_number;
     return tok;
 }
-Token createErrorToken(const char *message) {
-    Token tok; tok.type = TOKEN_ERROR; tok.lexeme_start = message;
-    tok.lexeme_length = (int)strlen(message); tok.line = scanner.line_number;
-    return tok;
-}
 Token createErrorTokenOnLine(const char *message, int line) {
     Token tok; tok.type = TOKEN_ERROR; tok.lexeme_start = message;
     tok.lexeme_length = (int)strlen(message); tok.line = line;
+    tok.error_start = scanner.token_start; tok.error_length = (int)(scanner.scan_ptr - scanner.token_start);
     return tok;
 }
+Token createErrorToken(const char *message) { return createErrorTokenOnLine(message, scanner.line_number); }
 
 TokenType getKeywordType(const char *str, int length) {
     for (int i = 0; i < keywordCount; i++) {
+        stats.keyword_probes++;
         if (strlen(keywords[i].keyword) == length && memcmp(str, keywords[i].keyword, length) == 0) return keywords[i].token_type;
     }
     return TOKEN_IDENTIFIER;
@@ -197,6 +255,17 @@ Token getNextToken() {
     }
 }
 
+/* Token fetch used by the parser: counts tokens and re-lexing caused by loop rewinds */
+Token fetchToken() {
+    if (!stats.enabled) return getNextToken();
+    double start = nowSeconds();
+    Token t = getNextToken();
+    if (stats.exec_depth == 0) stats.lex_time += nowSeconds() - start; /* re-lexing counts as execution */
+    stats.tokens_by_type[t.type]++;
+    if (scanner.scan_ptr > stats.high_water) stats.high_water = scanner.scan_ptr; else if (t.type != TOKEN_EOF) stats.relexed_tokens++;
+    return t;
+}
+
 /* ========================================================================= */
 /* 2. SYMBOL TABLE                                                           */
 /* ========================================================================= */
@@ -213,8 +282,9 @@ typedef struct {
     char qpaTargets[256];
 } Symbol;
 
-Symbol symbolTable[MAX_SYMBOLS];
-int symbolCount = 0;
+_Thread_local Symbol symbolTable[MAX_SYMBOLS];
+_Thread_local int symbolCount = 0;
+_Thread_local unsigned char symbolDirty[MAX_SYMBOLS]; /* Written since the last parse-cache unit boundary */
 
 void setSymbol(const char* name, const char* val) {
     if (strlen(name) >= MAX_VAR_LEN) return; 
@@ -222,6 +292,7 @@ void setSymbol(const char* name, const char* val) {
         if (strcmp(symbolTable[i].name, name) == 0) {
             strncpy(symbolTable[i].value, val, MAX_VAL_LEN - 1);
             symbolTable[i].value[MAX_VAL_LEN - 1] = '\0';
+            symbolDirty[i] = 1;
             return;
         }
     }
@@ -231,7 +302,7 @@ void setSymbol(const char* name, const char* val) {
         strncpy(symbolTable[symbolCount].value, val, MAX_VAL_LEN - 1);
         symbolTable[symbolCount].value[MAX_VAL_LEN - 1] = '\0';
         symbolTable[symbolCount].isQPA = 0;
-        symbolCount++;
+        symbolDirty[symbolCount++] = 1;
     }
 }
 
@@ -240,11 +311,12 @@ void setQPA(const char* name, const char* targets) {
         strncpy(symbolTable[symbolCount].name, name, MAX_VAR_LEN - 1);
         strncpy(symbolTable[symbolCount].qpaTargets, targets, 255);
         symbolTable[symbolCount].isQPA = 1;
-        symbolCount++;
+        symbolDirty[symbolCount++] = 1;
     }
 }
 
 Symbol* getSymbol(const char* name) {
+    stats.symbol_lookups++;
     for (int i = 0; i < symbolCount; i++) {
         if (strcmp(symbolTable[i].name, name) == 0) {
             return &symbolTable[i];
@@ -253,8 +325,116 @@ Symbol* getSymbol(const char* name) {
     return NULL;
 }
 
-char mockOutput[8192];
-int mockPos = 0;
+/* Static type of a variable, worked out by the type checker (section 8) before the program runs */
+typedef enum { TYPE_UNKNOWN, TYPE_NUMBER, TYPE_TEXT, TYPE_ARRAY, TYPE_STRUCT, TYPE_QPA } ValueType;
+ValueType typeOf(const char *name); void checkTypes(const char *input); void typeReset();
+
+_Thread_local char mockOutput[8192];
+_Thread_local int mockPos = 0;
+
+/* Growable output buffer: a parse-cache unit's reports, or one batch file's output */
+typedef struct { char *data; size_t length, capacity; } OutputBuffer;
+
+int reserveOutput(OutputBuffer *out, size_t len) {
+    if (out->length + len > out->capacity) {
+        size_t cap = (out->length + len) * 2 + 256; char *grown = (char *)realloc(out->data, cap);
+        if (!grown) return 0;
+        out->data = grown; out->capacity = cap;
+    }
+    return 1;
+}
+
+int appendOutput(OutputBuffer *out, const char *text, size_t len) {
+    if (!reserveOutput(out, len)) return 0;
+    memcpy(out->data + out->length, text, len); out->length += len;
+    return 1;
+}
+
+/* vprintf onto the end of a buffer; returns the length written, or -1 if memory runs out */
+int appendFormatV(OutputBuffer *out, const char *format, va_list args) {
+    va_list again; va_copy(again, args);
+    int len = vsnprintf(NULL, 0, format, args);
+    if (len < 0 || !reserveOutput(out, (size_t)len + 1)) { va_end(again); return -1; }
+    vsnprintf(out->data + out->length, (size_t)len + 1, format, again); va_end(again);
+    out->length += len; return len;
+}
+
+int appendFormat(OutputBuffer *out, const char *format, ...) {
+    va_list args; va_start(args, format); int len = appendFormatV(out, format, args); va_end(args);
+    return len;
+}
+
+/*
+ * Bump-pointer arena for everything that lives at most as long as one parse: declaration
+ * scratch buffers, generated C lines and the parse-cache units. resetParserState() empties it
+ * but keeps its largest block, so a batch worker parsing many files does not grow or call
+ * malloc again once warm. Short-lived buffers are returned with arenaMark()/arenaRewind().
+ */
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGN 16
+
+typedef struct ArenaBlock { struct ArenaBlock *next; size_t size, used; _Alignas(16) char data[]; } ArenaBlock;
+typedef struct { ArenaBlock *head; } Arena;
+typedef struct { ArenaBlock *block; size_t used; } ArenaMark;
+
+_Thread_local Arena parseArena;
+
+/* Never returns NULL: running out of memory mid-parse has no recovery path */
+void *arenaAlloc(Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    ArenaBlock *block = arena->head;
+    if (!block || block->size - block->used < size) {
+        size_t blockSize = block ? block->size * 2 : ARENA_BLOCK_SIZE;
+        if (blockSize < size) blockSize = size;
+        block = (ArenaBlock *)malloc(sizeof(ArenaBlock) + blockSize);
+        if (!block) { fprintf(stderr, "Error: Memory allocation failed\n"); exit(1); }
+        block->next = arena->head; block->size = blockSize; block->used = 0; arena->head = block;
+    }
+    void *p = block->data + block->used; block->used += size;
+    return p;
+}
+
+ArenaMark arenaMark(Arena *arena) { ArenaMark m = { arena->head, arena->head ? arena->head->used : 0 }; return m; }
+
+/* Free everything allocated since the mark */
+void arenaRewind(Arena *arena, ArenaMark mark) {
+    while (arena->head != mark.block) { ArenaBlock *next = arena->head->next; free(arena->head); arena->head = next; }
+    if (arena->head) arena->head->used = mark.used;
+}
+
+/* Keep only the largest (newest) block, emptied */
+void arenaReset(Arena *arena) {
+    if (!arena->head) return;
+    for (ArenaBlock *b = arena->head->next, *next; b; b = next) { next = b->next; free(b); }
+    arena->head->next = NULL; arena->head->used = 0;
+}
+
+void arenaRelease(Arena *arena) { arenaReset(arena); free(arena->head); arena->head = NULL; }
+
+/* Reports of the current parse-cache unit, kept while --cache is recording (see report()) */
+_Thread_local int recordingUnits = 0;
+_Thread_local OutputBuffer unitReports;
+
+/* Where emit() writes: stdout when NULL (batch mode collects each file's output first) */
+_Thread_local OutputBuffer *emitTarget = NULL;
+
+void writeOutput(const char *text, size_t len) {
+    if (emitTarget) appendOutput(emitTarget, text, len); else fwrite(text, 1, len, stdout);
+    stats.output_bytes += len;
+}
+
+/* printf to stdout, counting the bytes written */
+int emit(const char *format, ...) {
+    va_list args; va_start(args, format);
+    int written = emitTarget ? appendFormatV(emitTarget, format, args) : vprintf(format, args);
+    va_end(args);
+    if (written > 0) stats.output_bytes += written;
+    return written;
+}
+
+/* Loop re-executions are timed as execution; only the outermost loop is measured */
+void beginExecution() { if (stats.enabled && stats.exec_depth++ == 0) stats.exec_start = nowSeconds(); }
+void endExecution() { if (stats.enabled && --stats.exec_depth == 0) stats.exec_time += nowSeconds() - stats.exec_start; }
 
 void appendMockOutput(const char *text) {
     if (mockPos + strlen(text) < 8190) {
@@ -263,6 +443,21 @@ void appendMockOutput(const char *text) {
     }
 }
 
+/* Copy a token's lexeme into a fixed-size buffer, truncating instead of overflowing */
+void copyLexeme(char *dst, size_t size, Token t) {
+    size_t len = t.lexeme_length > 0 ? (size_t)t.lexeme_length : 0;
+    if (len >= size) len = size - 1;
+    memcpy(dst, t.lexeme_start, len); dst[len] = '\0';
+}
+
+/* Append at most len bytes of src to a fixed-size buffer */
+void appendBounded(char *dst, size_t size, const char *src, int len) {
+    size_t used = strlen(dst);
+    if (len < 0 || used + 1 >= size) return;
+    if ((size_t)len > size - used - 1) len = (int)(size - used - 1);
+    memcpy(dst + used, src, len); dst[used + len] = '\0';
+}
+
 void appendNewline() {
     if (mockPos < 8190 && mockPos > 0 && mockOutput[mockPos-1] != '\n') {
         mockOutput[mockPos++] = '\n';
@@ -274,13 +469,187 @@ void appendNewline() {
 /* 3. PARSER                                                                 */
 /* ========================================================================= */
 
-Token currentToken;
-Token previousToken; // NEW: Track previous token for line number accuracy
-Token lookaheadToken;
-int panicMode = 0; 
-int success = 1;
+_Thread_local Token currentToken;
+_Thread_local Token previousToken; // NEW: Track previous token for line number accuracy
+_Thread_local Token lookaheadToken;
+_Thread_local int panicMode = 0; 
+_Thread_local int success = 1;
+
+_Thread_local int hasString = 0, hasCAB = 0, hasAutoRef = 0, hasQPA = 0;
+
+/*
+ * Diagnostics are collected while a program is checked and printed once, by printSummary().
+ * Each one has a code, the line it is reported on and, when known, the source bytes it points
+ * at. A second report with the same code on the same line is dropped, and only the first
+ * --max-diagnostics=N are kept (the rest are counted); the step and time limit reports are
+ * always kept, as callers look for them. --diagnostics=json prints them as JSON.
+ */
+typedef enum {
+    DIAG_UNTERMINATED_STRING, DIAG_INVALID_OPERATOR, DIAG_INVALID_TOKEN,
+    DIAG_SYNTAX, DIAG_UNEXPECTED_TOKEN, DIAG_EXPECTED_TOKEN, DIAG_MISUSED_SYNTAX, DIAG_BEFORE_PROGRAM, DIAG_AFTER_PROGRAM,
+    DIAG_TYPE_CONFLICT, DIAG_NOT_A_NUMBER, DIAG_NOT_AN_ARRAY, DIAG_NOT_A_STRUCT, DIAG_NOT_A_STRING, DIAG_TYPE_AS_VALUE,
+    DIAG_STEP_LIMIT, DIAG_TIME_LIMIT, DIAG_UNSUPPORTED, DIAG_CODE_COUNT
+} DiagnosticCode;
+
+const struct { const char *code, *kind, *severity; } diagnosticInfo[DIAG_CODE_COUNT] = {
+    {"E001", "Syntax Error", "error"}, {"E002", "Syntax Error", "error"}, {"E003", "Syntax Error", "error"},
+    {"E101", "Syntax Error", "error"}, {"E102", "Syntax Error", "error"}, {"E103", "Syntax Error", "error"},
+    {"E104", "Syntax Error", "error"}, {"E105", "Syntax Error", "error"}, {"E106", "Syntax Error", "error"},
+    {"E201", "Type Error", "error"}, {"E202", "Type Error", "error"}, {"E203", "Type Error", "error"},
+    {"E204", "Type Error", "error"}, {"E205", "Type Error", "error"}, {"E206", "Type Error", "error"},
+    {"E301", "Runtime Error", "error"}, {"E302", "Runtime Error", "error"}, {"E401", "Error", "error"}
+};
+
+typedef struct {
+    DiagnosticCode code; int line;
+    int start, length;       /* Source bytes it points at; start is -1 when unknown */
+    int message, messageLen; /* Offset into diagnostics.text */
+} Diagnostic;
+
+typedef struct {
+    Diagnostic *items; int count, capacity;
+    OutputBuffer text;    /* Messages of all items */
+    int omitted;          /* Reports past --max-diagnostics */
+    int bannerAt;         /* Items reported before ">>> STARTING PARSER", -1 until program() gets there */
+    unsigned long long *seen; int seenCount, seenCapacity; /* (code, line) pairs reported, open addressing */
+    const char *source; size_t sourceLen;
+} DiagnosticList;
+
+#define DEFAULT_MAX_DIAGNOSTICS 100
+int maxDiagnostics = DEFAULT_MAX_DIAGNOSTICS; /* 0 = unlimited */
+int diagnosticsJson = 0;                      /* --diagnostics=json */
+_Thread_local DiagnosticList diagnostics;
+
+/* A report as the parse cache stores it: this header, then messageLen bytes; code -1 marks the banner */
+typedef struct { int code, line, start, length, messageLen; } PackedReport;
+
+void resetDiagnostics(const char *source) {
+    free(diagnostics.items); free(diagnostics.text.data); free(diagnostics.seen);
+    memset(&diagnostics, 0, sizeof(diagnostics)); diagnostics.bannerAt = -1;
+    diagnostics.source = source; diagnostics.sourceLen = source ? strlen(source) : 0;
+}
+
+int seenSlot(unsigned long long key, int capacity) { return (int)((key * 0x9E3779B97F4A7C15ULL) >> 40) & (capacity - 1); }
+
+/* Remember (code, line); returns 1 if it was reported before */
+int seenDiagnostic(DiagnosticCode code, int line) {
+    if (2 * (diagnostics.seenCount + 1) > diagnostics.seenCapacity) {
+        int cap = diagnostics.seenCapacity ? diagnostics.seenCapacity * 2 : 64;
+        unsigned long long *grown = (unsigned long long *)calloc(cap, sizeof(unsigned long long));
+        if (!grown) return 0;
+        for (int i = 0; i < diagnostics.seenCapacity; i++) {
+            unsigned long long key = diagnostics.seen[i]; if (!key) continue;
+            int at = seenSlot(key, cap);
+            while (grown[at]) at = (at + 1) & (cap - 1);
+            grown[at] = key;
+        }
+        free(diagnostics.seen); diagnostics.seen = grown; diagnostics.seenCapacity = cap;
+    }
+    unsigned long long key = (unsigned long long)(code + 1) << 32 | (unsigned int)line;
+    int at = seenSlot(key, diagnostics.seenCapacity);
+    while (diagnostics.seen[at]) {
+        if (diagnostics.seen[at] == key) return 1;
+        at = (at + 1) & (diagnostics.seenCapacity - 1);
+    }
+    diagnostics.seen[at] = key; diagnostics.seenCount++;
+    return 0;
+}
+
+void addDiagnostic(DiagnosticCode code, int line, int start, int length, const char *message, int messageLen) {
+    if (seenDiagnostic(code, line)) return;
+    int limitReport = code == DIAG_STEP_LIMIT || code == DIAG_TIME_LIMIT;
+    if (maxDiagnostics > 0 && diagnostics.count >= maxDiagnostics && !limitReport) { diagnostics.omitted++; return; }
+    if (diagnostics.count == diagnostics.capacity) {
+        int cap = diagnostics.capacity ? diagnostics.capacity * 2 : 16;
+        Diagnostic *grown = (Diagnostic *)realloc(diagnostics.items, cap * sizeof(Diagnostic));
+        if (!grown) { diagnostics.omitted++; return; }
+        diagnostics.items = grown; diagnostics.capacity = cap;
+    }
+    Diagnostic d = { code, line, start, length, (int)diagnostics.text.length, messageLen };
+    if (!appendOutput(&diagnostics.text, message, messageLen)) { diagnostics.omitted++; return; }
+    diagnostics.items[diagnostics.count++] = d;
+}
+
+void recordReport(int code, int line, int start, int length, const char *message, int messageLen) {
+    PackedReport r = { code, line, start, length, messageLen };
+    if (!appendOutput(&unitReports, (const char *)&r, sizeof(r)) || !appendOutput(&unitReports, message, messageLen)) recordingUnits = 0;
+}
+
+/* Report an error at token `at` on `line`; every report fails the parse */
+void report(DiagnosticCode code, Token at, int line, const char *format, ...) {
+    OutputBuffer message = {0};
+    va_list args; va_start(args, format); int len = appendFormatV(&message, format, args); va_end(args);
+    int start = -1, length = 0;
+    if (at.type == TOKEN_ERROR) { at.lexeme_start = at.error_start; at.lexeme_length = at.error_length; } /* its lexeme is the message */
+    if (at.lexeme_start && at.lexeme_start >= diagnostics.source && at.lexeme_start + at.lexeme_length <= diagnostics.source + diagnostics.sourceLen) {
+        start = (int)(at.lexeme_start - diagnostics.source); length = at.lexeme_length;
+    }
+    if (len >= 0) {
+        if (recordingUnits) recordReport(code, line, start, length, message.data, len);
+        addDiagnostic(code, line, start, length, message.data, len);
+    }
+    free(message.data);
+    success = 0;
+}
+
+/* The ">>> STARTING PARSER" line goes after everything reported so far */
+void startProgramReport() {
+    diagnostics.bannerAt = diagnostics.count;
+    if (recordingUnits) recordReport(-1, 0, -1, 0, "", 0);
+}
+
+/* Check (apply = 0) or re-report packed reports of a cached unit; returns 0 if the data is malformed */
+int replayReports(const char *data, int len, int apply) {
+    const char *end = data + len;
+    while (data < end) {
+        PackedReport r;
+        if ((size_t)(end - data) < sizeof(r)) return 0;
+        memcpy(&r, data, sizeof(r)); data += sizeof(r);
+        if (r.code < -1 || r.code >= DIAG_CODE_COUNT || r.messageLen < 0 || r.messageLen > end - data) return 0;
+        if (apply && r.code < 0) diagnostics.bannerAt = diagnostics.count;
+        else if (apply) addDiagnostic((DiagnosticCode)r.code, r.line, r.start, r.length, data, r.messageLen);
+        data += r.messageLen;
+    }
+    return 1;
+}
+
+void appendJsonString(OutputBuffer *out, const char *text, int len) {
+    appendOutput(out, "\"", 1);
+    for (int i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '"' || c == '\\') { char escaped[2] = { '\\', (char)c }; appendOutput(out, escaped, 2); }
+        else if (c == '\n') appendOutput(out, "\\n", 2);
+        else if (c < 0x20) appendFormat(out, "\\u%04x", c);
+        else appendOutput(out, (const char *)&c, 1);
+    }
+    appendOutput(out, "\"", 1);
+}
+
+/* "[Kind] Line N: message" for items [from, to) */
+void renderDiagnosticLines(OutputBuffer *out, int from, int to) {
+    for (int i = from; i < to; i++) {
+        Diagnostic *d = &diagnostics.items[i];
+        appendFormat(out, "[%s] Line %d: %.*s\n", diagnosticInfo[d->code].kind, d->line, d->messageLen, diagnostics.text.data + d->message);
+    }
+}
+
+void renderOmitted(OutputBuffer *out) {
+    if (diagnostics.omitted > 0) appendFormat(out, "[Note] %d more diagnostics not shown (--max-diagnostics=%d)\n", diagnostics.omitted, maxDiagnostics);
+}
 
-int hasString = 0, hasCAB = 0, hasAutoRef = 0, hasQPA = 0;
+void renderDiagnosticsJson(OutputBuffer *out) {
+    appendOutput(out, "[", 1);
+    for (int i = 0; i < diagnostics.count; i++) {
+        Diagnostic *d = &diagnostics.items[i];
+        appendFormat(out, "%s{\"code\":\"%s\",\"severity\":\"%s\",\"kind\":\"%s\",\"line\":%d,\"range\":", i ? "," : "",
+                     diagnosticInfo[d->code].code, diagnosticInfo[d->code].severity, diagnosticInfo[d->code].kind, d->line);
+        if (d->start >= 0) appendFormat(out, "{\"start\":%d,\"end\":%d}", d->start, d->start + d->length); else appendOutput(out, "null", 4);
+        appendOutput(out, ",\"message\":", 11);
+        appendJsonString(out, diagnostics.text.data + d->message, d->messageLen);
+        appendOutput(out, "}", 1);
+    }
+    appendFormat(out, "],\"omitted\":%d", diagnostics.omitted);
+}
 
 int isLiteral(Token t) {
     return (t.type == TOKEN_NUMBER_INT || t.type == TOKEN_NUMBER_FLOAT || t.type == TOKEN_STRING || t.type == TOKEN_KW_TRUE || t.type == TOKEN_KW_FALSE);
@@ -289,46 +658,42 @@ int isLiteral(Token t) {
 void advance() {
     previousToken = currentToken; // Update previous before moving
     currentToken = lookaheadToken;
-    lookaheadToken = getNextToken();
+    lookaheadToken = fetchToken();
     if (currentToken.type == TOKEN_ERROR) {
         if (strcmp(currentToken.lexeme_start, "Unterminated string") == 0) {
-             printf("[Syntax Error] Line %d: Unterminated string\n", currentToken.line);
+             report(DIAG_UNTERMINATED_STRING, currentToken, currentToken.line, "Unterminated string");
         } else if (strcmp(currentToken.lexeme_start, "Invalid operator '==='") == 0) {
-             printf("[Syntax Error] Line %d: Invalid operator '==='\n", currentToken.line);
+             report(DIAG_INVALID_OPERATOR, currentToken, currentToken.line, "Invalid operator '==='");
         } else {
              if (currentToken.lexeme_length > 1 && isalpha(currentToken.lexeme_start[0])) {
-                 printf("[Syntax Error] Line %d: %.*s\n", currentToken.line, currentToken.lexeme_length, currentToken.lexeme_start);
+                 report(DIAG_INVALID_TOKEN, currentToken, currentToken.line, "%.*s", currentToken.lexeme_length, currentToken.lexeme_start);
             } else {
-                 printf("[Syntax Error] Line %d: Invalid token\n", currentToken.line);
+                 report(DIAG_INVALID_TOKEN, currentToken, currentToken.line, "Invalid token");
             }
         }
-        success = 0; 
         currentToken = lookaheadToken;
-        lookaheadToken = getNextToken();
+        lookaheadToken = fetchToken();
     }
     while (currentToken.type == TOKEN_SINGLE_COMMENT || currentToken.type == TOKEN_MULTI_COMMENT) {
         currentToken = lookaheadToken;
-        lookaheadToken = getNextToken();
+        lookaheadToken = fetchToken();
     }
 }
 
 void customError(const char *msg) {
-    printf("[Syntax Error] Line %d: %s\n", currentToken.line, msg);
-    success = 0;
+    report(DIAG_SYNTAX, currentToken, currentToken.line, "%s", msg);
 }
 
 void softError(const char *msg) {
-    printf("[Syntax Error] Line %d: %s (Found '%.*s')\n", 
-           currentToken.line, msg, currentToken.lexeme_length, currentToken.lexeme_start);
-    success = 0;
+    report(DIAG_MISUSED_SYNTAX, currentToken, currentToken.line, "%s (Found '%.*s')",
+           msg, currentToken.lexeme_length, currentToken.lexeme_start);
 }
 
 void error(const char *msg) {
     if (panicMode) return;
     panicMode = 1;
-    success = 0; 
-    printf("[Syntax Error] Line %d: %s (Found '%.*s')\n", 
-           currentToken.line, msg, currentToken.lexeme_length, currentToken.lexeme_start);
+    report(DIAG_UNEXPECTED_TOKEN, currentToken, currentToken.line, "%s (Found '%.*s')",
+           msg, currentToken.lexeme_length, currentToken.lexeme_start);
 }
 
 void synchronize() {
@@ -353,9 +718,8 @@ void consume(TokenType type, const char *msg) {
         
         if (panicMode) return;
         panicMode = 1;
-        success = 0; 
-        printf("[Syntax Error] Line %d: %s (Found '%.*s')\n", 
-               line, msg, currentToken.lexeme_length, currentToken.lexeme_start);
+        report(DIAG_EXPECTED_TOKEN, currentToken, line, "%s (Found '%.*s')",
+               msg, currentToken.lexeme_length, currentToken.lexeme_start);
     }
 }
 
@@ -375,28 +739,69 @@ void checkConfusion(Token t) {
     }
 }
 
+/* Execution budget: a runaway loop stops with a diagnostic instead of pinning a CPU core */
+#define DEFAULT_MAX_STEPS 5000000L
+#define DEFAULT_TIMEOUT_MS 3000L
+long maxSteps = DEFAULT_MAX_STEPS;   /* statements + loop iterations, 0 = unlimited */
+long timeoutMs = DEFAULT_TIMEOUT_MS; /* wall-clock limit, 0 = unlimited */
+int useJit = 1;                      /* compile hot loops to machine code (section 7), --no-jit */
+_Thread_local long stepCount = 0;
+_Thread_local double deadline = 0;
+_Thread_local int budgetExceeded = 0;
+
+void startBudget() { stepCount = 0; budgetExceeded = 0; deadline = timeoutMs > 0 ? nowSeconds() + timeoutMs / 1000.0 : 0; }
+
+/* Count one execution step; returns 0 (and stops execution) once the budget is spent */
+int takeStep() {
+    if (budgetExceeded) return 0;
+    stepCount++;
+    if (maxSteps > 0 && stepCount > maxSteps) {
+        report(DIAG_STEP_LIMIT, currentToken, currentToken.line, "Execution step limit exceeded (%ld steps)", maxSteps);
+    } else if (deadline > 0 && (stepCount & 1023) == 0 && nowSeconds() > deadline) {
+        report(DIAG_TIME_LIMIT, currentToken, currentToken.line, "Execution time limit exceeded (%ld ms)", timeoutMs);
+    } else {
+        return 1;
+    }
+    budgetExceeded = 1;
+    return 0;
+}
+
+/* Recursion guard: pathologically nested input reports an error instead of exhausting the stack */
+#define MAX_NESTING 256
+_Thread_local int nestingDepth = 0;
+
+int enterNesting() {
+    if (nestingDepth >= MAX_NESTING) { error("Nesting too deep"); return 0; }
+    nestingDepth++; return 1;
+}
+void leaveNesting() { nestingDepth--; }
+
 /* Forward Declarations */
-void statementList(); void statement(); void declaration(); void structDeclaration();
+void statementList(); void statement(); void statementBody(); void declaration(); void structDeclaration();
 void assignmentOrInput(); void displayStatement(); void conditionalAssignmentBlock(); 
-void ifStatement(); void whileLoop(); void doWhileLoop(); void forLoop();
+void ifStatement(); void ifStatementBody(); void conditionalAssignmentBody(); void whileLoop(); void doWhileLoop(); void forLoop();
 void functionDeclaration(); void quantumPointerOperation();    
+void executeBody(); int unitBoundary(int phase);
 float expression(); float logicOr(); float logicAnd(); float equality(); float relational(); float simpleExpression(); float term(); float factor();
 
-void captureValue(char* buffer) {
+/* Loop JIT (section 7): a saved parser position, and a loop compiled to machine code */
+typedef struct { Scanner scanner; Token current, lookahead; } TokenMark;
+typedef struct JitLoop JitLoop;
+#define JIT_HOT_ITERATIONS 32
+JitLoop *jitLoop(TokenMark cond, TokenMark body, const TokenMark *update); float jitIterate(JitLoop **loop, float cond); void jitReset();
+
+void captureValue(char* buffer, size_t size) {
     if (currentToken.type == TOKEN_STRING) {
-        buffer[0] = '"';
         int len = currentToken.lexeme_length - 2;
-        strncpy(buffer + 1, currentToken.lexeme_start + 1, len);
+        if (len > (int)size - 3) len = (int)size - 3;
+        buffer[0] = '"';
+        memcpy(buffer + 1, currentToken.lexeme_start + 1, len);
         buffer[len + 1] = '"';
         buffer[len + 2] = '\0';
         advance();
-    } else if (currentToken.type == TOKEN_TYPE_CHAR || (currentToken.type == TOKEN_STRING && currentToken.lexeme_length == 3)) {
-         strncpy(buffer, currentToken.lexeme_start, currentToken.lexeme_length);
-         buffer[currentToken.lexeme_length] = '\0';
-         advance();
     } else {
         float f = expression();
-        if (floorf(f) == f) sprintf(buffer, "%.0f", f); else sprintf(buffer, "%.1f", f);
+        if (floorf(f) == f) snprintf(buffer, size, "%.0f", f); else snprintf(buffer, size, "%.1f", f);
     }
 }
 
@@ -408,8 +813,9 @@ void getArrayElement(const char* arrayStr, int index, char* outBuf) {
         while (*ptr == ' ' || *ptr == ',') ptr++;
         if (*ptr == ']' || *ptr == '\0') break;
         char temp[64]; int i = 0;
-        while (isdigit(*ptr) || *ptr == '.') { temp[i++] = *ptr++; }
+        while (isdigit(*ptr) || *ptr == '.') { if (i < 63) temp[i++] = *ptr; ptr++; }
         temp[i] = '\0';
+        if (i == 0 && *ptr != ']' && *ptr != '\0') { ptr++; continue; } /* skip unexpected characters */
         if (count == index) { strcpy(outBuf, temp); return; }
         count++;
     }
@@ -424,6 +830,7 @@ void extractStructField(const char* structVal, const char* fieldName, char* outB
             char *end = strchr(start, '"');
             if (end) {
                 int len = end - start;
+                if (len > 127) len = 127; /* outBuf holds 128 bytes */
                 strncpy(outBuf, start, len);
                 outBuf[len] = '\0';
                 return;
@@ -435,7 +842,7 @@ void extractStructField(const char* structVal, const char* fieldName, char* outB
             comma++;
             while(*comma == ' ') comma++;
             int i=0;
-            while(isdigit(comma[i])) { outBuf[i] = comma[i]; i++; }
+            while(isdigit(comma[i]) && i < 127) { outBuf[i] = comma[i]; i++; }
             outBuf[i] = '\0';
             return;
         }
@@ -466,7 +873,7 @@ void parseInterpolation(const char* start, int len) {
                 int sLen = arrow - lookup; 
                 if(sLen > 31) sLen = 31;
                 strncpy(structName, lookup, sLen); structName[sLen] = '\0';
-                strcpy(fieldName, arrow + 2);
+                strncpy(fieldName, arrow + 2, 31); fieldName[31] = '\0';
                 Symbol* sSym = getSymbol(structName);
                 if (sSym) {
                     char fieldVal[128]; extractStructField(sSym->value, fieldName, fieldVal);
@@ -475,7 +882,7 @@ void parseInterpolation(const char* start, int len) {
             }
             if (sym) {
                 char *val = sym->value;
-                if (val[0] == '"' || val[0] == '\'') {
+                if (typeOf(lookup) == TYPE_TEXT) {
                     for(int k=1; k<(int)strlen(val)-1; k++) appendMockOutput((char[]){val[k], '\0'});
                 } else { appendMockOutput(val); }
             } else {
@@ -500,23 +907,31 @@ void skipBlock() {
     }
 }
 
+#define UNIT_TOP 0       /* Before a top-level struct or 'execute' */
+#define UNIT_STATEMENT 1 /* Before a statement directly inside execute() { } */
+
 void program() {
-    while (currentToken.type == TOKEN_KW_STRUCT) { structDeclaration(); if(panicMode) synchronize(); }
+    while (unitBoundary(UNIT_TOP) && currentToken.type == TOKEN_KW_STRUCT) { structDeclaration(); if(panicMode) synchronize(); }
     if (currentToken.type == TOKEN_RW_EXECUTE) {
-        printf(">>> STARTING PARSER FOR CNACK LANGUAGE...\n");
+        startProgramReport();
         consume(TOKEN_RW_EXECUTE, "Expected 'execute'"); if (panicMode) synchronize();
         consume(TOKEN_L_PAREN, "Expected '('"); consume(TOKEN_R_PAREN, "Expected ')'"); consume(TOKEN_L_BRACE, "Expected '{'");
-        statementList();
-        if (currentToken.type == TOKEN_RW_EXIT) {
-            advance(); consume(TOKEN_L_PAREN, "Expected '('"); consume(TOKEN_R_PAREN, "Expected ')'"); consume(TOKEN_SEMICOLON, "Expected ';'");
-        }
-        consume(TOKEN_R_BRACE, "Expected '}'");
+        executeBody();
     } else {
          error("Unexpected token");
          advance();
     }
 }
 
+/* Everything after 'execute() {'; a cached parse resumes here at a top-level statement */
+void executeBody() {
+    statementList();
+    if (currentToken.type == TOKEN_RW_EXIT) {
+        advance(); consume(TOKEN_L_PAREN, "Expected '('"); consume(TOKEN_R_PAREN, "Expected ')'"); consume(TOKEN_SEMICOLON, "Expected ';'");
+    }
+    consume(TOKEN_R_BRACE, "Expected '}'");
+}
+
 void structDeclaration() {
     consume(TOKEN_KW_STRUCT, "Expected 'struct'");
     consume(TOKEN_IDENTIFIER, "Expected struct name");
@@ -528,7 +943,7 @@ void structDeclaration() {
 }
 
 void statementList() {
-    while (currentToken.type != TOKEN_RW_EXIT && currentToken.type != TOKEN_R_BRACE && currentToken.type != TOKEN_EOF) {
+    while ((nestingDepth > 0 || unitBoundary(UNIT_STATEMENT)) && currentToken.type != TOKEN_RW_EXIT && currentToken.type != TOKEN_R_BRACE && currentToken.type != TOKEN_EOF) {
         statement();
         if (panicMode) {
              while (currentToken.type != TOKEN_SEMICOLON && currentToken.type != TOKEN_R_BRACE && currentToken.type != TOKEN_EOF) {
@@ -541,6 +956,12 @@ void statementList() {
 }
 
 void statement() {
+    takeStep();
+    if (!enterNesting()) { advance(); return; }
+    statementBody(); leaveNesting();
+}
+
+void statementBody() {
     if (isType(currentToken)) declaration(); 
     else if (currentToken.type == TOKEN_IDENTIFIER) {
         checkConfusion(currentToken); if (panicMode) { return; }
@@ -567,20 +988,31 @@ void statement() {
     else { error("Unexpected statement start"); advance(); }
 }
 
+/* A string literal, or a copy of a string variable, into a string variable; 0 if the value is neither */
+int storeText(const char *varName) {
+    if (currentToken.type == TOKEN_STRING) { char sBuf[256]; copyLexeme(sBuf, sizeof(sBuf), currentToken); setSymbol(varName, sBuf); advance(); return 1; }
+    if (currentToken.type != TOKEN_IDENTIFIER || (lookaheadToken.type != TOKEN_COMMA && lookaheadToken.type != TOKEN_SEMICOLON)) return 0;
+    char valName[64]; copyLexeme(valName, sizeof(valName), currentToken); Symbol *source = getSymbol(valName);
+    if (!source || typeOf(valName) != TYPE_TEXT) return 0;
+    char copy[MAX_VAL_LEN]; strcpy(copy, source->value); setSymbol(varName, copy); advance();
+    return 1;
+}
+
 void declaration() {
     int declType = -1; 
     if (currentToken.type == TOKEN_TYPE_INT || currentToken.type == TOKEN_TYPE_FLOAT) declType = 1;
     else if (currentToken.type == TOKEN_TYPE_STRING) { declType = 3; hasString = 1; }
+    int textDecl = currentToken.type == TOKEN_TYPE_STRING || currentToken.type == TOKEN_TYPE_CHAR;
 
     advance();
     if (currentToken.type == TOKEN_MULT_OP || currentToken.type == TOKEN_POINTER_OP) advance(); 
     if (currentToken.type == TOKEN_QUANTUM_POINTER_OP) { hasQPA = 1; advance(); }
 
+    ArenaMark mark = arenaMark(&parseArena); /* value buffers live until the declaration ends */
     do {
         char varName[64];
         if (currentToken.type == TOKEN_IDENTIFIER) {
-            strncpy(varName, currentToken.lexeme_start, currentToken.lexeme_length);
-            varName[currentToken.lexeme_length] = '\0';
+            copyLexeme(varName, sizeof(varName), currentToken);
         } else {
              softError("Invalid identifier name (reserved word)");
              advance(); goto finish_decl;
@@ -590,21 +1022,24 @@ void declaration() {
         if (currentToken.type == TOKEN_ASSIGN_OP) {
             advance();
             if (declType == 3 && currentToken.type == TOKEN_IDENTIFIER) {
-                char valName[64]; strncpy(valName, currentToken.lexeme_start, currentToken.lexeme_length); valName[currentToken.lexeme_length] = '\0';
+                char valName[64]; copyLexeme(valName, sizeof(valName), currentToken);
                 if (!getSymbol(valName)) {
                     softError("Missing quotation marks for string literal");
                     advance(); 
                     goto finish_decl;
                 }
             }
+            if (textDecl && storeText(varName)) goto finish_decl;
             if (currentToken.type == TOKEN_L_BRACE && hasQPA) {
-                char targets[256] = ""; advance(); 
+                size_t targetsSize = sizeof(((Symbol *)0)->qpaTargets);
+                char *targets = (char *)arenaAlloc(&parseArena, targetsSize); targets[0] = '\0'; advance();
                 while (currentToken.type != TOKEN_R_BRACE && currentToken.type != TOKEN_EOF) {
                     if (currentToken.type == TOKEN_ADDRESS_OF_OP) advance();
                     if (currentToken.type == TOKEN_IDENTIFIER) {
-                        strncat(targets, currentToken.lexeme_start, currentToken.lexeme_length); strcat(targets, ","); advance();
+                        appendBounded(targets, targetsSize, currentToken.lexeme_start, currentToken.lexeme_length); appendBounded(targets, targetsSize, ",", 1); advance();
                     }
                     if (currentToken.type == TOKEN_COMMA) advance();
+                    else if (currentToken.type != TOKEN_R_BRACE && currentToken.type != TOKEN_IDENTIFIER && currentToken.type != TOKEN_ADDRESS_OF_OP) { softError("Expected quantum pointer target"); advance(); }
                 }
                 consume(TOKEN_R_BRACE, "Expected '}'"); setQPA(varName, targets); goto finish_decl;
             }
@@ -614,24 +1049,24 @@ void declaration() {
                 if (isType(currentToken) || currentToken.type == TOKEN_IDENTIFIER) advance(); 
                 consume(TOKEN_COMMA, ",");
                 if (currentToken.type == TOKEN_L_BRACKET) {
-                     char arrayVal[512] = "[";
+                     char *arrayVal = (char *)arenaAlloc(&parseArena, MAX_VAL_LEN); strcpy(arrayVal, "[");
                      advance();
                      while (currentToken.type != TOKEN_R_BRACKET && currentToken.type != TOKEN_EOF) {
                          if (currentToken.type == TOKEN_NUMBER_INT || currentToken.type == TOKEN_NUMBER_FLOAT) {
-                             strncat(arrayVal, currentToken.lexeme_start, currentToken.lexeme_length); strcat(arrayVal, ","); advance();
+                             appendBounded(arrayVal, MAX_VAL_LEN - 1, currentToken.lexeme_start, currentToken.lexeme_length); appendBounded(arrayVal, MAX_VAL_LEN - 1, ",", 1); advance();
                          } else if (currentToken.type == TOKEN_COMMA) { advance(); } else { advance(); } 
                      }
                      if (arrayVal[strlen(arrayVal)-1] == ',') arrayVal[strlen(arrayVal)-1] = '\0';
                      strcat(arrayVal, "]"); setSymbol(varName, arrayVal); consume(TOKEN_R_BRACKET, "]");
                 } 
                 else if (currentToken.type == TOKEN_L_BRACE) {
-                     char structVal[512] = "{";
+                     char *structVal = (char *)arenaAlloc(&parseArena, MAX_VAL_LEN); strcpy(structVal, "{");
                      advance();
                      while (currentToken.type != TOKEN_R_BRACE && currentToken.type != TOKEN_EOF) {
                          if (currentToken.type == TOKEN_STRING) {
-                              strncat(structVal, "\"", 1); strncat(structVal, currentToken.lexeme_start+1, currentToken.lexeme_length-2); strncat(structVal, "\"", 1);
-                         } else { strncat(structVal, currentToken.lexeme_start, currentToken.lexeme_length); }
-                         strcat(structVal, ","); advance(); if (currentToken.type == TOKEN_COMMA) advance();
+                              appendBounded(structVal, MAX_VAL_LEN - 1, "\"", 1); appendBounded(structVal, MAX_VAL_LEN - 1, currentToken.lexeme_start+1, currentToken.lexeme_length-2); appendBounded(structVal, MAX_VAL_LEN - 1, "\"", 1);
+                         } else { appendBounded(structVal, MAX_VAL_LEN - 1, currentToken.lexeme_start, currentToken.lexeme_length); }
+                         appendBounded(structVal, MAX_VAL_LEN - 1, ",", 1); advance(); if (currentToken.type == TOKEN_COMMA) advance();
                      }
                      if (structVal[strlen(structVal)-1] == ',') structVal[strlen(structVal)-1] = '\0';
                      strcat(structVal, "}"); setSymbol(varName, structVal); consume(TOKEN_R_BRACKET, "}");
@@ -643,9 +1078,9 @@ void declaration() {
             }
             else {
                 if (currentToken.type == TOKEN_STRING) {
-                     char sBuf[256]; strncpy(sBuf, currentToken.lexeme_start, currentToken.lexeme_length); sBuf[currentToken.lexeme_length]='\0'; setSymbol(varName, sBuf); advance();
+                     char sBuf[256]; copyLexeme(sBuf, sizeof(sBuf), currentToken); setSymbol(varName, sBuf); advance();
                 } else {
-                    float result = expression(); char valBuf[32]; if (floorf(result) == result) sprintf(valBuf, "%.0f", result); else sprintf(valBuf, "%.1f", result); setSymbol(varName, valBuf);
+                    float result = expression(); char valBuf[64]; if (floorf(result) == result) snprintf(valBuf, sizeof(valBuf), "%.0f", result); else snprintf(valBuf, sizeof(valBuf), "%.1f", result); setSymbol(varName, valBuf);
                 }
             }
         } 
@@ -660,6 +1095,7 @@ void declaration() {
         finish_decl:
         if (currentToken.type == TOKEN_COMMA) advance(); else break;
     } while (1);
+    arenaRewind(&parseArena, mark);
     consume(TOKEN_SEMICOLON, "Expected ';'");
 }
 
@@ -674,8 +1110,12 @@ void doWhileLoop() {
     consume(TOKEN_R_PAREN, ")"); consume(TOKEN_SEMICOLON, ";");
     
     // Execution loop
+    JitLoop *compiled = NULL; long iterations = 0;
+    beginExecution();
     while (cond) {
-        if (!success) break;
+        if (useJit && ++iterations == JIT_HOT_ITERATIONS) compiled = jitLoop((TokenMark){condStart, condTok, condLook}, (TokenMark){bodyStart, bodyTok, bodyLook}, NULL);
+        if (compiled && !(cond = jitIterate(&compiled, cond))) break;
+        if (!success || !takeStep()) break;
         scanner = bodyStart; currentToken = bodyTok; lookaheadToken = bodyLook;
         statementList(); // re-exec body
         consume(TOKEN_R_BRACE, "}"); 
@@ -684,6 +1124,7 @@ void doWhileLoop() {
         cond = expression();
         consume(TOKEN_R_PAREN, ")"); consume(TOKEN_SEMICOLON, ";");
     }
+    endExecution();
 }
 
 void forLoop() { 
@@ -712,8 +1153,13 @@ void forLoop() {
     Scanner endScanner = scanner; Token endTok = currentToken; Token endLook = lookaheadToken;
 
     // Execution Loop
+    JitLoop *compiled = NULL; long iterations = 0;
+    beginExecution();
     while(cond) {
-        if (!success) break;
+        if (useJit && ++iterations == JIT_HOT_ITERATIONS)
+            compiled = jitLoop((TokenMark){condStart, condTok, condLook}, (TokenMark){bodyStart, bodyTok, bodyLook}, &(TokenMark){updStart, updTok, updLook});
+        if (compiled && !(cond = jitIterate(&compiled, cond))) break;
+        if (!success || !takeStep()) break;
         scanner = bodyStart; currentToken = bodyTok; lookaheadToken = bodyLook;
         statementList(); // execute body
         consume(TOKEN_R_BRACE, "}");
@@ -721,12 +1167,12 @@ void forLoop() {
         scanner = updStart; currentToken = updTok; lookaheadToken = updLook;
         // Parse & Execute Update without consuming trailing semicolon
         if (currentToken.type == TOKEN_IDENTIFIER) {
-            char varName[64]; strncpy(varName, currentToken.lexeme_start, currentToken.lexeme_length); varName[currentToken.lexeme_length] = '\0';
+            char varName[64]; copyLexeme(varName, sizeof(varName), currentToken);
             advance(); 
             if (currentToken.type == TOKEN_INCREMENT_OP || currentToken.type == TOKEN_DECREMENT_OP) {
                 TokenType op = currentToken.type; advance();
                 Symbol* sym = getSymbol(varName);
-                if (sym) { float v = atof(sym->value); if(op==TOKEN_INCREMENT_OP) v++; else v--; char nb[32]; sprintf(nb,"%.0f",v); setSymbol(varName, nb); }
+                if (sym) { float v = atof(sym->value); if(op==TOKEN_INCREMENT_OP) v++; else v--; char nb[64]; snprintf(nb, sizeof(nb), "%.0f",v); setSymbol(varName, nb); }
             } else if (currentToken.type >= TOKEN_ASSIGN_OP && currentToken.type <= TOKEN_MOD_ASSIGN_OP) {
                 TokenType op = currentToken.type; advance();
                 float val = expression();
@@ -738,7 +1184,7 @@ void forLoop() {
                     else if (op == TOKEN_MULT_ASSIGN_OP) cv *= val; 
                     else if (op == TOKEN_DIV_ASSIGN_OP && val!=0) cv /= val;
                     else if (op == TOKEN_ASSIGN_OP) cv = val;
-                    char nb[32]; if (floorf(cv) == cv) sprintf(nb, "%.0f", cv); else sprintf(nb, "%.1f", cv); setSymbol(varName, nb);
+                    char nb[64]; if (floorf(cv) == cv) snprintf(nb, sizeof(nb), "%.0f", cv); else snprintf(nb, sizeof(nb), "%.1f", cv); setSymbol(varName, nb);
                 }
             }
         } else {
@@ -748,6 +1194,7 @@ void forLoop() {
         scanner = condStart; currentToken = condTok; lookaheadToken = condLook;
         cond = expression();
     }
+    endExecution();
     scanner = endScanner; currentToken = endTok; lookaheadToken = endLook;
 }
 
@@ -762,8 +1209,12 @@ void whileLoop() {
     skipBlock(); // Skip body initially
     Scanner endScanner = scanner; Token endTok = currentToken; Token endLook = lookaheadToken;
     
+    JitLoop *compiled = NULL; long iterations = 0;
+    beginExecution();
     while(cond) {
-        if (!success) break;
+        if (useJit && ++iterations == JIT_HOT_ITERATIONS) compiled = jitLoop((TokenMark){condStart, condTok, condLook}, (TokenMark){bodyStart, bodyTok, bodyLook}, NULL);
+        if (compiled && !(cond = jitIterate(&compiled, cond))) break;
+        if (!success || !takeStep()) break;
         scanner = bodyStart; currentToken = bodyTok; lookaheadToken = bodyLook;
         statementList(); 
         consume(TOKEN_R_BRACE, "}");
@@ -771,10 +1222,16 @@ void whileLoop() {
         scanner = condStart; currentToken = condTok; lookaheadToken = condLook;
         cond = expression();
     }
+    endExecution();
     scanner = endScanner; currentToken = endTok; lookaheadToken = endLook;
 }
 
 void ifStatement() {
+    if (!enterNesting()) { advance(); return; }
+    ifStatementBody(); leaveNesting();
+}
+
+void ifStatementBody() {
     consume(TOKEN_KW_IF, "if"); consume(TOKEN_L_PAREN, "("); expression(); consume(TOKEN_R_PAREN, ")");
     if (currentToken.type != TOKEN_L_BRACE) {
         softError("Braces are mandatory"); while(currentToken.type != TOKEN_SEMICOLON && currentToken.type != TOKEN_EOF) advance(); consume(TOKEN_SEMICOLON, ";");
@@ -790,7 +1247,12 @@ void ifStatement() {
     }
 }
 
-void conditionalAssignmentBlock() { 
+void conditionalAssignmentBlock() {
+    if (!enterNesting()) { advance(); return; }
+    conditionalAssignmentBody(); leaveNesting();
+}
+
+void conditionalAssignmentBody() { 
     hasCAB=1; consume(TOKEN_KW_ASSIGN, "assign"); 
     
     consume(TOKEN_L_PAREN, "Expected '('"); 
@@ -798,8 +1260,7 @@ void conditionalAssignmentBlock() {
     char targets[5][64]; int targetCount = 0;
     do {
         if (targetCount < 5 && currentToken.type == TOKEN_IDENTIFIER) {
-            strncpy(targets[targetCount], currentToken.lexeme_start, currentToken.lexeme_length);
-            targets[targetCount][currentToken.lexeme_length] = '\0';
+            copyLexeme(targets[targetCount], sizeof(targets[targetCount]), currentToken);
             targetCount++;
             advance();
         }
@@ -825,14 +1286,14 @@ void conditionalAssignmentBlock() {
             if (currentToken.type == TOKEN_L_PAREN && targetCount > 1) { 
                 advance();
                 for (int i = 0; i < targetCount; i++) {
-                    char valBuf[256]; captureValue(valBuf); setSymbol(targets[i], valBuf);
+                    char valBuf[256]; captureValue(valBuf, sizeof(valBuf)); setSymbol(targets[i], valBuf);
                     if (i < targetCount - 1) consume(TOKEN_COMMA, ",");
                 }
                 consume(TOKEN_R_PAREN, ")");
             } else if (currentToken.type == TOKEN_KW_ASSIGN) {
                  conditionalAssignmentBlock();
             } else {
-                 char valBuf[256]; captureValue(valBuf);
+                 char valBuf[256]; captureValue(valBuf, sizeof(valBuf));
                  if (targetCount > 0) setSymbol(targets[0], valBuf);
             }
         } else {
@@ -860,12 +1321,12 @@ void conditionalAssignmentBlock() {
              if (currentToken.type == TOKEN_L_PAREN && targetCount > 1) { 
                 advance();
                 for (int i = 0; i < targetCount; i++) {
-                    char valBuf[256]; captureValue(valBuf); setSymbol(targets[i], valBuf);
+                    char valBuf[256]; captureValue(valBuf, sizeof(valBuf)); setSymbol(targets[i], valBuf);
                     if (i < targetCount - 1) consume(TOKEN_COMMA, ",");
                 }
                 consume(TOKEN_R_PAREN, ")");
             } else {
-                 char valBuf[256]; captureValue(valBuf);
+                 char valBuf[256]; captureValue(valBuf, sizeof(valBuf));
                  if (targetCount > 0) setSymbol(targets[0], valBuf);
             }
         } else {
@@ -880,7 +1341,7 @@ void conditionalAssignmentBlock() {
 }
 
 void assignmentOrInput() {
-    char varName[64]; strncpy(varName, currentToken.lexeme_start, currentToken.lexeme_length); varName[currentToken.lexeme_length] = '\0';
+    char varName[64]; copyLexeme(varName, sizeof(varName), currentToken);
     
     Token nextTok = lookaheadToken;
     if (nextTok.type >= TOKEN_ADD_OP && nextTok.type <= TOKEN_EXPO_OP) {
@@ -895,11 +1356,12 @@ void assignmentOrInput() {
         TokenType op = currentToken.type; advance();
         if (currentToken.type == TOKEN_KW_ASK) { advance(); consume(TOKEN_L_PAREN, "("); if(currentToken.type==TOKEN_IDENTIFIER) advance(); consume(TOKEN_R_PAREN, ")"); }
         else if (currentToken.type == TOKEN_QUANTUM_POINTER_OP) { softError("Quantum pointer cannot be used as R-value"); advance(); advance(); }
-        else { float val = expression(); Symbol* sym = getSymbol(varName); if (sym) { float cv = atof(sym->value); if (op == TOKEN_ADD_ASSIGN_OP) cv += val; else if (op == TOKEN_SUB_ASSIGN_OP) cv -= val; else if (op == TOKEN_MULT_ASSIGN_OP) cv *= val; else if (op == TOKEN_DIV_ASSIGN_OP && val!=0) cv /= val; else if (op == TOKEN_ASSIGN_OP) cv = val; char nb[32]; sprintf(nb,"%.0f",cv); setSymbol(varName, nb); } else { char nb[32]; sprintf(nb,"%.0f",val); setSymbol(varName, nb); } }
+        else if (op == TOKEN_ASSIGN_OP && typeOf(varName) == TYPE_TEXT && storeText(varName)) {}
+        else { float val = expression(); Symbol* sym = getSymbol(varName); if (sym) { float cv = atof(sym->value); if (op == TOKEN_ADD_ASSIGN_OP) cv += val; else if (op == TOKEN_SUB_ASSIGN_OP) cv -= val; else if (op == TOKEN_MULT_ASSIGN_OP) cv *= val; else if (op == TOKEN_DIV_ASSIGN_OP && val!=0) cv /= val; else if (op == TOKEN_ASSIGN_OP) cv = val; char nb[64]; snprintf(nb, sizeof(nb), "%.0f",cv); setSymbol(varName, nb); } else { char nb[64]; snprintf(nb, sizeof(nb), "%.0f",val); setSymbol(varName, nb); } }
         consume(TOKEN_SEMICOLON, ";");
     } 
     else if (currentToken.type == TOKEN_INCREMENT_OP || currentToken.type == TOKEN_DECREMENT_OP) {
-        TokenType op = currentToken.type; advance(); Symbol* sym = getSymbol(varName); if (sym) { float v = atof(sym->value); if(op==TOKEN_INCREMENT_OP) v++; else v--; char nb[32]; sprintf(nb,"%.0f",v); setSymbol(varName, nb); } consume(TOKEN_SEMICOLON, ";");
+        TokenType op = currentToken.type; advance(); Symbol* sym = getSymbol(varName); if (sym) { float v = atof(sym->value); if(op==TOKEN_INCREMENT_OP) v++; else v--; char nb[64]; snprintf(nb, sizeof(nb), "%.0f",v); setSymbol(varName, nb); } consume(TOKEN_SEMICOLON, ";");
     }
     else if (currentToken.type == TOKEN_SEMICOLON) { consume(TOKEN_SEMICOLON, ";"); }
     else { 
@@ -931,9 +1393,9 @@ void displayStatement() {
 
         if (currentToken.type == TOKEN_STRING) { parseInterpolation(currentToken.lexeme_start + 1, currentToken.lexeme_length - 2); advance(); }
         else if (currentToken.type == TOKEN_IDENTIFIER) {
-             char varName[64]; strncpy(varName, currentToken.lexeme_start, currentToken.lexeme_length); varName[currentToken.lexeme_length] = '\0';
+             char varName[64]; copyLexeme(varName, sizeof(varName), currentToken);
              Symbol* sym = getSymbol(varName);
-             if (sym && sym->value[0] == '"') {
+             if (sym && typeOf(varName) == TYPE_TEXT) {
                  for(int i=1; i<strlen(sym->value)-1; i++) appendMockOutput((char[]){sym->value[i], '\0'});
                  advance();
              } else {
@@ -949,7 +1411,10 @@ void displayStatement() {
 
 void functionDeclaration() { consume(TOKEN_KW_FN, "fn"); consume(TOKEN_IDENTIFIER, "ID"); consume(TOKEN_L_PAREN, "("); consume(TOKEN_R_PAREN, ")"); consume(TOKEN_L_BRACE, "{"); statementList(); consume(TOKEN_R_BRACE, "}"); }
 
-float expression() { return logicOr(); }
+float expression() {
+    if (!enterNesting()) { advance(); return 0; }
+    float v = logicOr(); leaveNesting(); return v;
+}
 
 float logicOr() {
     float l = logicAnd();
@@ -993,19 +1458,19 @@ float term() { float l = factor(); while(currentToken.type == TOKEN_MULT_OP || c
 
 float factor() {
     float val = 0;
+    while (currentToken.type == TOKEN_MULT_OP || currentToken.type == TOKEN_POINTER_OP) advance(); /* dereference is a no-op */
     if (currentToken.type == TOKEN_RW_AUTO_REF) { 
         hasAutoRef = 1; advance(); consume(TOKEN_L_PAREN, "("); if(isType(currentToken) || currentToken.type==TOKEN_IDENTIFIER) advance(); consume(TOKEN_COMMA, ",");
         if (currentToken.type == TOKEN_L_BRACKET) { while(currentToken.type != TOKEN_R_BRACKET && currentToken.type != TOKEN_EOF) advance(); advance(); } 
         else { val = expression(); }
         consume(TOKEN_R_PAREN, ")"); return val;
     }
-    if (currentToken.type == TOKEN_MULT_OP || currentToken.type == TOKEN_POINTER_OP) { advance(); return factor(); }
     if (currentToken.type == TOKEN_NUMBER_INT) { val = atof(currentToken.lexeme_start); advance(); }
     else if (currentToken.type == TOKEN_NUMBER_FLOAT) { val = atof(currentToken.lexeme_start); advance(); }
     else if (currentToken.type == TOKEN_KW_TRUE) { val = 1; advance(); }
     else if (currentToken.type == TOKEN_KW_FALSE) { val = 0; advance(); }
     else if (currentToken.type == TOKEN_IDENTIFIER) {
-        char name[64]; strncpy(name, currentToken.lexeme_start, currentToken.lexeme_length); name[currentToken.lexeme_length] = '\0';
+        char name[64]; copyLexeme(name, sizeof(name), currentToken);
         advance();
         if (currentToken.type == TOKEN_L_BRACKET) { advance(); float idx = expression(); Symbol* s = getSymbol(name); if (s) { char res[64]; getArrayElement(s->value, (int)idx, res); val = atof(res); } consume(TOKEN_R_BRACKET, "]"); }
         else if (currentToken.type == TOKEN_ARROW_OP) { advance(); consume(TOKEN_IDENTIFIER, "Field"); }
@@ -1024,45 +1489,2201 @@ float factor() {
     return val;
 }
 
-int main() {
-    char *input = NULL; size_t buffer_size = 0; size_t total_size = 0; size_t chunk_size = 100000;
-    input = (char *)malloc(chunk_size); if (!input) return 1;
-    size_t bytes_read; while ((bytes_read = fread(input + total_size, 1, chunk_size, stdin)) > 0) {
-        total_size += bytes_read; if (total_size + chunk_size > buffer_size + chunk_size) {
-            buffer_size = total_size + chunk_size * 2; input = (char *)realloc(input, buffer_size);
+/* ========================================================================= */
+/* 4. PARSE CACHE (--cache=FILE)                                             */
+/* ========================================================================= */
+
+/*
+ * Parsing and execution are one pass, so a statement's diagnostics depend on everything
+ * before it. The cache therefore records a boundary before every top-level struct and
+ * every statement directly inside execute(), keyed by a hash of the source prefix the
+ * parser had read at that point. On the next run the longest matching run of boundaries
+ * is replayed (diagnostics, program output, symbol writes) and parsing resumes at the
+ * first unit whose prefix changed.
+ */
+#define CACHE_MAGIC "CNACKPC2"
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME 1099511628211ULL
+
+typedef struct { int type, offset, length, line; } CachedToken;
+
+/* The file system calls whose form differs between platforms */
+long long modifiedNs(const struct stat *info) {
+#if defined(__APPLE__)
+    return info->st_mtimespec.tv_sec * 1000000000LL + info->st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    return info->st_mtime * 1000000000LL;
+#else
+    return info->st_mtim.tv_sec * 1000000000LL + info->st_mtim.tv_nsec;
+#endif
+}
+
+int makeDirectory(const char *path) {
+#ifdef _WIN32
+    return _mkdir(path);
+#else
+    return mkdir(path, 0777);
+#endif
+}
+
+typedef struct {
+    int phase;                 /* UNIT_TOP or UNIT_STATEMENT */
+    int covered;               /* Source bytes the parser had looked at */
+    unsigned long long hash;   /* FNV-1a of those bytes */
+    int restorable;            /* 0 when a token refers to a lexer message instead of source */
+    int scanOffset, scanLine;
+    CachedToken current, lookahead, previous;
+    int success, panicMode, flags;
+    long steps;
+    int symbolCount, symbolsLen, reportsLen, mockLen;
+    char *symbols; /* Symbols written during the unit, as they were at its end (see packSymbol) */
+    char *reports; /* report() calls of the unit, packed (see PackedReport) */
+    char *mock;    /* Program output appended during the unit */
+} UnitRecord;
+
+typedef struct { UnitRecord *items; int count, capacity; } UnitList;
+
+const char *cachePath = NULL;
+_Thread_local UnitList cachedUnits, newUnits;
+_Thread_local const char *unitSource = NULL; _Thread_local size_t unitSourceLen = 0;
+_Thread_local unsigned long long prefixHash = FNV_OFFSET; _Thread_local int hashedUpTo = 0;
+_Thread_local int unitMockPos = 0;
+
+unsigned long long extendHash(unsigned long long h, const char *bytes, int from, int to) {
+    for (int i = from; i < to; i++) { h ^= (unsigned char)bytes[i]; h *= FNV_PRIME; }
+    return h;
+}
+
+int saveToken(CachedToken *out, Token t) {
+    out->type = t.type; out->length = t.lexeme_length; out->line = t.line;
+    if (t.lexeme_start == NULL) { out->offset = -1; return 1; }
+    if (t.lexeme_start < unitSource || t.lexeme_start > unitSource + unitSourceLen) return 0;
+    out->offset = (int)(t.lexeme_start - unitSource); return 1;
+}
+
+Token loadToken(CachedToken in) {
+    Token t; t.type = (TokenType)in.type; t.lexeme_length = in.length; t.line = in.line;
+    t.lexeme_start = in.offset < 0 ? NULL : unitSource + in.offset;
+    return t;
+}
+
+/* Symbols are stored as "index flags\0name\0value\0targets\0" so unused buffer space is not cached */
+int packSymbol(char *out, int index) {
+    Symbol *sym = &symbolTable[index];
+    int len = sprintf(out, "%d %d%d", index, sym->isArray ? 1 : 0, sym->isQPA ? 1 : 0) + 1;
+    len += sprintf(out + len, "%.*s", MAX_VAR_LEN - 1, sym->name) + 1;
+    len += sprintf(out + len, "%.*s", MAX_VAL_LEN - 1, sym->value) + 1;
+    len += sprintf(out + len, "%.*s", (int)sizeof(sym->qpaTargets) - 1, sym->qpaTargets) + 1;
+    return len;
+}
+
+/* Check (apply = 0) or apply packed symbols; returns 0 if the data is malformed */
+int unpackSymbols(const char *data, int len, int symbolLimit, int apply) {
+    const char *end = data + len;
+    while (data < end) {
+        const char *fields[4]; int index, isArray, isQPA;
+        for (int f = 0; f < 4; f++) { fields[f] = data; data = memchr(data, '\0', end - data); if (!data) return 0; data++; }
+        if (sscanf(fields[0], "%d %1d%1d", &index, &isArray, &isQPA) != 3 || index < 0 || index >= symbolLimit) return 0;
+        if (!apply) continue;
+        Symbol *sym = &symbolTable[index]; memset(sym, 0, sizeof(*sym));
+        sym->isArray = isArray; sym->isQPA = isQPA;
+        strncpy(sym->name, fields[1], MAX_VAR_LEN - 1); strncpy(sym->value, fields[2], MAX_VAL_LEN - 1);
+        strncpy(sym->qpaTargets, fields[3], sizeof(sym->qpaTargets) - 1);
+    }
+    return 1;
+}
+
+/* Unit buffers live in parseArena; only the list itself is freed */
+void freeUnits(UnitList *list) {
+    free(list->items); list->items = NULL; list->count = list->capacity = 0;
+}
+
+int pushUnit(UnitList *list, UnitRecord *u) {
+    if (list->count == list->capacity) {
+        int cap = list->capacity ? list->capacity * 2 : 64;
+        UnitRecord *grown = (UnitRecord *)realloc(list->items, cap * sizeof(UnitRecord));
+        if (!grown) return 0;
+        list->items = grown; list->capacity = cap;
+    }
+    list->items[list->count++] = *u; return 1;
+}
+
+/* Record the parser state at a unit boundary; always returns 1 so it can sit in loop conditions */
+int unitBoundary(int phase) {
+    if (!recordingUnits) return 1;
+    if (budgetExceeded) { recordingUnits = 0; return 1; } /* a timeout is not reproducible */
+
+    int scanOffset = (int)(scanner.scan_ptr - unitSource);
+    int covered = scanOffset + 2; /* the lexer peeks up to two bytes past scan_ptr */
+    if (covered > (int)unitSourceLen + 1) covered = (int)unitSourceLen + 1;
+
+    /* Resuming from the cache arrives at the boundary it was restored from */
+    if (newUnits.count > 0 && newUnits.items[newUnits.count - 1].scanOffset == scanOffset &&
+        newUnits.items[newUnits.count - 1].phase == phase && unitReports.length == 0 && mockPos == unitMockPos) return 1;
+
+    UnitRecord u; memset(&u, 0, sizeof(u));
+    prefixHash = extendHash(prefixHash, unitSource, hashedUpTo, covered); hashedUpTo = covered;
+    u.phase = phase; u.covered = covered; u.hash = prefixHash;
+    u.scanOffset = scanOffset; u.scanLine = scanner.line_number;
+    u.restorable = saveToken(&u.current, currentToken) & saveToken(&u.lookahead, lookaheadToken) & saveToken(&u.previous, previousToken);
+    u.success = success; u.panicMode = panicMode; u.steps = stepCount; u.symbolCount = symbolCount;
+    u.flags = hasString | hasCAB << 1 | hasAutoRef << 2 | hasQPA << 3;
+
+    int dirtyCount = 0;
+    for (int i = 0; i < symbolCount; i++) if (symbolDirty[i]) dirtyCount++;
+    u.symbols = (char *)arenaAlloc(&parseArena, dirtyCount * (sizeof(Symbol) + 32) + 1);
+    u.mock = (char *)arenaAlloc(&parseArena, mockPos - unitMockPos + 1);
+    for (int i = 0; i < symbolCount; i++) if (symbolDirty[i]) u.symbolsLen += packSymbol(u.symbols + u.symbolsLen, i);
+    memset(symbolDirty, 0, sizeof(symbolDirty));
+    u.mockLen = mockPos - unitMockPos; memcpy(u.mock, mockOutput + unitMockPos, u.mockLen); unitMockPos = mockPos;
+    u.reportsLen = (int)unitReports.length; u.reports = (char *)arenaAlloc(&parseArena, u.reportsLen + 1);
+    if (u.reportsLen > 0) memcpy(u.reports, unitReports.data, u.reportsLen);
+    unitReports.length = 0;
+
+    if (!pushUnit(&newUnits, &u)) recordingUnits = 0;
+    return 1;
+}
+
+/*
+ * The cache file is mapped read-only, or read into the parse arena without mmap; loaded
+ * units point into it until cachedProgram() ends
+ */
+_Thread_local char *cacheMap = NULL; _Thread_local size_t cacheMapSize = 0;
+
+char *readCacheFile(int fd, size_t size) {
+#ifdef CNACK_MMAP
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    return map == MAP_FAILED ? NULL : (char *)map;
+#else
+    char *data = (char *)arenaAlloc(&parseArena, size);
+    for (size_t got = 0; got < size;) { ssize_t n = read(fd, data + got, size - got); if (n <= 0) return NULL; got += (size_t)n; }
+    return data;
+#endif
+}
+
+/* A copy in the arena goes with arenaReset() */
+void releaseCacheMap() {
+#ifdef CNACK_MMAP
+    if (cacheMap) munmap(cacheMap, cacheMapSize);
+#endif
+    cacheMap = NULL; cacheMapSize = 0;
+}
+
+/* Point *dst at the next `size` bytes of the mapping; a length past its end means the file is corrupt */
+int takeBlock(size_t *at, void **dst, int size) {
+    if (size < 0 || (size_t)size > cacheMapSize - *at) return 0;
+    *dst = cacheMap + *at; *at += size; return 1;
+}
+
+/* Load a cache file written with the same build and budget; anything unexpected is a miss */
+void loadCache(const char *path) {
+    int fd = open(path, O_RDONLY | O_BINARY); if (fd < 0) return;
+    struct stat info; char *data = fstat(fd, &info) == 0 && info.st_size > 0 ? readCacheFile(fd, (size_t)info.st_size) : NULL;
+    close(fd); if (!data) return;
+    cacheMap = data; cacheMapSize = (size_t)info.st_size;
+    long header[4]; int count = 0; size_t at = 0; void *magic;
+    int ok = takeBlock(&at, &magic, 8) && memcmp(magic, CACHE_MAGIC, 8) == 0 && cacheMapSize - at >= sizeof(header) + sizeof(int);
+    if (ok) { memcpy(header, cacheMap + at, sizeof(header)); memcpy(&count, cacheMap + at + sizeof(header), sizeof(int)); at += sizeof(header) + sizeof(int); }
+    ok = ok && header[0] == (long)sizeof(UnitRecord) && header[1] == (long)sizeof(Symbol) && header[2] == maxSteps && header[3] == timeoutMs;
+    for (int i = 0; ok && i < count; i++) {
+        UnitRecord u;
+        if (cacheMapSize - at < sizeof(u)) { ok = 0; break; }
+        memcpy(&u, cacheMap + at, sizeof(u)); at += sizeof(u);
+        ok = u.symbolCount >= 0 && u.symbolCount <= MAX_SYMBOLS &&
+             takeBlock(&at, (void **)&u.symbols, u.symbolsLen) && takeBlock(&at, (void **)&u.reports, u.reportsLen) &&
+             takeBlock(&at, (void **)&u.mock, u.mockLen) && unpackSymbols(u.symbols, u.symbolsLen, u.symbolCount, 0) &&
+             replayReports(u.reports, u.reportsLen, 0);
+        if (!ok || !pushUnit(&cachedUnits, &u)) ok = 0;
+    }
+    if (!ok) { freeUnits(&cachedUnits); releaseCacheMap(); }
+    stats.cached_units = cachedUnits.count;
+}
+
+void saveCache(const char *path) {
+    /* Unique per thread: two runs saving the same file must not write into one temporary */
+    char tmp[4200]; snprintf(tmp, sizeof(tmp), "%s.%ld.%lx.tmp", path, (long)getpid(), (unsigned long)pthread_self());
+    FILE *f = fopen(tmp, "wb"); if (!f) return;
+    long header[4] = { (long)sizeof(UnitRecord), (long)sizeof(Symbol), maxSteps, timeoutMs };
+    int ok = fwrite(CACHE_MAGIC, 1, 8, f) == 8 && fwrite(header, sizeof(long), 4, f) == 4 &&
+             fwrite(&newUnits.count, sizeof(int), 1, f) == 1;
+    for (int i = 0; ok && i < newUnits.count; i++) {
+        UnitRecord *u = &newUnits.items[i];
+        ok = fwrite(u, sizeof(*u), 1, f) == 1 &&
+             fwrite(u->symbols, 1, u->symbolsLen, f) == (size_t)u->symbolsLen &&
+             fwrite(u->reports, 1, u->reportsLen, f) == (size_t)u->reportsLen &&
+             fwrite(u->mock, 1, u->mockLen, f) == (size_t)u->mockLen;
+    }
+    if (fclose(f) != 0) ok = 0;
+    if (ok) rename(tmp, path); else remove(tmp);
+}
+
+/*
+ * --cache-dir=DIR picks the cache file by a hash of the whole source (DIR/<hash>.pc), so every
+ * program run before, e.g. the sample library or the tests, replays at once without a session.
+ * When DIR grows past --cache-max-bytes, the least recently used files are deleted. With
+ * --cache=FILE, an explicit --cache-max-bytes bounds the *.pc files next to FILE the same way
+ * (the server keeps one FILE per session in a directory of its own).
+ */
+#define DEFAULT_CACHE_MAX_BYTES (256L * 1024 * 1024)
+const char *cacheDir = NULL; long cacheMaxBytes = DEFAULT_CACHE_MAX_BYTES; int cacheBounded = 0;
+char cacheDirFile[4096];
+
+typedef struct { char name[64]; off_t size; long long used; } CacheEntry;
+
+int compareCacheEntries(const void *a, const void *b) {
+    long long x = ((const CacheEntry *)a)->used, y = ((const CacheEntry *)b)->used; return (x > y) - (x < y);
+}
+
+void evictCache(const char *directory) {
+    DIR *dir = opendir(directory); if (!dir) return;
+    CacheEntry *entries = NULL; int count = 0, capacity = 0; long long total = 0;
+    char path[4200]; struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name); struct stat info;
+        if (len < 3 || len >= sizeof(entries->name) || strcmp(entry->d_name + len - 3, ".pc") != 0) continue;
+        snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+        if (stat(path, &info) != 0) continue;
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            CacheEntry *grown = (CacheEntry *)realloc(entries, capacity * sizeof(CacheEntry)); if (!grown) break;
+            entries = grown;
+        }
+        memcpy(entries[count].name, entry->d_name, len + 1); entries[count].size = info.st_size;
+        entries[count].used = modifiedNs(&info); total += info.st_size; count++;
+    }
+    closedir(dir);
+    if (total > cacheMaxBytes) {
+        qsort(entries, count, sizeof(CacheEntry), compareCacheEntries);
+        for (int i = 0; i < count && total > cacheMaxBytes; i++) {
+            snprintf(path, sizeof(path), "%s/%s", directory, entries[i].name);
+            if (unlink(path) == 0) total -= entries[i].size;
+        }
+    }
+    free(entries);
+}
+
+/* Evict in the directory that holds the --cache file */
+void evictCacheNextTo(const char *file) {
+    char dir[4096]; snprintf(dir, sizeof(dir), "%s", file);
+    char *slash = strrchr(dir, '/');
+    if (!slash) evictCache(".");
+    else if (slash == dir) evictCache("/");
+    else { *slash = '\0'; evictCache(dir); }
+}
+
+/* Number of leading cached units whose source prefix is unchanged and that can be resumed from */
+int matchCachedUnits() {
+    unsigned long long h = FNV_OFFSET; int upTo = 0, matched = 0, resumable = 0;
+    for (int i = 0; i < cachedUnits.count; i++) {
+        UnitRecord *u = &cachedUnits.items[i];
+        if (u->covered < upTo || u->covered > (int)unitSourceLen + 1) break;
+        h = extendHash(h, unitSource, upTo, u->covered); upTo = u->covered;
+        if (h != u->hash) break;
+        matched = i + 1;
+        if (u->restorable) resumable = matched;
+    }
+    return matched ? resumable : 0;
+}
+
+/* Replay the first `count` cached units and restore the parser to the last one's boundary */
+void replayUnits(int count) {
+    for (int i = 0; i < count; i++) {
+        UnitRecord *u = &cachedUnits.items[i];
+        replayReports(u->reports, u->reportsLen, 1);
+        unpackSymbols(u->symbols, u->symbolsLen, u->symbolCount, 1);
+        if (mockPos + u->mockLen < (int)sizeof(mockOutput)) { memcpy(mockOutput + mockPos, u->mock, u->mockLen); mockPos += u->mockLen; mockOutput[mockPos] = '\0'; }
+        pushUnit(&newUnits, u);
+    }
+    UnitRecord *last = &newUnits.items[newUnits.count - 1];
+    symbolCount = last->symbolCount; success = last->success; panicMode = last->panicMode; stepCount = last->steps;
+    hasString = last->flags & 1; hasCAB = (last->flags >> 1) & 1; hasAutoRef = (last->flags >> 2) & 1; hasQPA = (last->flags >> 3) & 1;
+    scanner.scan_ptr = scanner.token_start = unitSource + last->scanOffset; scanner.line_number = last->scanLine;
+    currentToken = loadToken(last->current); lookaheadToken = loadToken(last->lookahead); previousToken = loadToken(last->previous);
+    prefixHash = last->hash; hashedUpTo = last->covered; unitMockPos = mockPos;
+    /* the replayed records now belong to newUnits */
+    memmove(cachedUnits.items, cachedUnits.items + count, (cachedUnits.count - count) * sizeof(UnitRecord));
+    cachedUnits.count -= count;
+    stats.reused_units = count;
+}
+
+/* Run program() through the cache: resume after the unchanged prefix, then record the new units */
+void cachedProgram() {
+    unitSource = scanner.source_start; unitSourceLen = strlen(unitSource);
+    prefixHash = FNV_OFFSET; hashedUpTo = 0; unitMockPos = mockPos;
+    memset(symbolDirty, 0, sizeof(symbolDirty));
+    loadCache(cachePath);
+    int reuse = matchCachedUnits();
+    recordingUnits = 1;
+    if (reuse > 0) {
+        replayUnits(reuse);
+        if (newUnits.items[newUnits.count - 1].phase == UNIT_STATEMENT) executeBody(); else program();
+    } else {
+        program();
+    }
+    recordingUnits = 0;
+    free(unitReports.data); memset(&unitReports, 0, sizeof(unitReports));
+    /* A run that only replayed the whole file leaves it as it was */
+    if (cachedUnits.count == 0 && stats.reused_units > 0 && stats.reused_units == newUnits.count) utimes(cachePath, NULL);
+    else {
+        saveCache(cachePath);
+        if (cacheDir) evictCache(cacheDir); else if (cacheBounded) evictCacheNextTo(cachePath);
+    }
+    freeUnits(&cachedUnits); freeUnits(&newUnits); releaseCacheMap(); arenaReset(&parseArena);
+}
+
+void printStats() {
+    long total = 0;
+    for (int i = 0; i <= TOKEN_EOF; i++) total += stats.tokens_by_type[i];
+    if (stats.json) {
+        fprintf(stderr, "{\"tool\":\"parser\",\"input_bytes\":%zu,", stats.input_bytes);
+        fprintf(stderr, "\"time_ms\":{\"read\":%.3f,\"lex\":%.3f,\"parse\":%.3f,\"execute\":%.3f,\"format\":%.3f},",
+                stats.read_time * 1000, stats.lex_time * 1000, stats.parse_time * 1000, stats.exec_time * 1000, stats.format_time * 1000);
+        fprintf(stderr, "\"tokens\":%ld,\"tokens_by_type\":{", total);
+        int first = 1;
+        for (int i = 0; i <= TOKEN_EOF; i++) {
+            if (stats.tokens_by_type[i] == 0) continue;
+            fprintf(stderr, "%s\"%s\":%ld", first ? "" : ",", tokenTypeNames[i], stats.tokens_by_type[i]); first = 0;
         }
+        fprintf(stderr, "},\"keyword_probes\":%ld,\"symbol_lookups\":%ld,\"relexed_tokens\":%ld,\"cached_units\":%d,\"reused_units\":%d,\"output_bytes\":%ld}\n",
+                stats.keyword_probes, stats.symbol_lookups, stats.relexed_tokens, stats.cached_units, stats.reused_units, stats.output_bytes);
+        return;
+    }
+    fprintf(stderr, "=== PARSER STATS ===\n");
+    fprintf(stderr, "input bytes     : %zu\n", stats.input_bytes);
+    fprintf(stderr, "read time       : %.3f ms\n", stats.read_time * 1000);
+    fprintf(stderr, "lex time        : %.3f ms\n", stats.lex_time * 1000);
+    fprintf(stderr, "parse time      : %.3f ms\n", stats.parse_time * 1000);
+    fprintf(stderr, "execute time    : %.3f ms\n", stats.exec_time * 1000);
+    fprintf(stderr, "format time     : %.3f ms\n", stats.format_time * 1000);
+    fprintf(stderr, "tokens lexed    : %ld (%ld re-lexed by loop rewinds)\n", total, stats.relexed_tokens);
+    for (int i = 0; i <= TOKEN_EOF; i++) if (stats.tokens_by_type[i] > 0) fprintf(stderr, "  %-20s: %ld\n", tokenTypeNames[i], stats.tokens_by_type[i]);
+    fprintf(stderr, "keyword probes  : %ld\n", stats.keyword_probes);
+    fprintf(stderr, "getSymbol calls : %ld\n", stats.symbol_lookups);
+    if (cachePath) fprintf(stderr, "cached units    : %d reused of %d\n", stats.reused_units, stats.cached_units);
+    fprintf(stderr, "output bytes    : %ld\n", stats.output_bytes);
+}
+
+const char *principleNames[4] = { "String Data Type", "Conditional Assignment Blocks (CAB)", "Auto Reference Command", "Quantum Pointer Aliasing (QPA)" };
+
+/* {"success":..,"diagnostics":[..],"omitted":N,"principles":[..],"output":".."|null} */
+void renderJsonReport(OutputBuffer *out) {
+    int detected[4] = { hasString, hasCAB, hasAutoRef, hasQPA }, first = 1;
+    appendFormat(out, "{\"success\":%s,\"diagnostics\":", success ? "true" : "false");
+    renderDiagnosticsJson(out);
+    appendOutput(out, ",\"principles\":[", 15);
+    for (int i = 0; success && i < 4; i++) if (detected[i]) { appendFormat(out, "%s\"%s\"", first ? "" : ",", principleNames[i]); first = 0; }
+    appendOutput(out, "],\"output\":", 11);
+    if (success) appendJsonString(out, mockOutput, mockPos); else appendOutput(out, "null", 4);
+    appendOutput(out, "}\n", 2);
+}
+
+void renderTextReport(OutputBuffer *out) {
+    int bannerAt = diagnostics.bannerAt;
+    renderDiagnosticLines(out, 0, bannerAt < 0 ? diagnostics.count : bannerAt);
+    if (bannerAt >= 0) { appendFormat(out, ">>> STARTING PARSER FOR CNACK LANGUAGE...\n"); renderDiagnosticLines(out, bannerAt, diagnostics.count); }
+    renderOmitted(out);
+    if (success) {
+        int detected[4] = { hasString, hasCAB, hasAutoRef, hasQPA };
+        appendFormat(out, "\n>>> SYNTAX ANALYSIS: PARSING SUCCESSFUL!\n");
+        appendFormat(out, "----------------------------------------\n");
+        appendFormat(out, "Principles Detected:\n");
+        for (int i = 0; i < 4; i++) if (detected[i]) appendFormat(out, " [x] Principle %d: %s\n", i + 1, principleNames[i]);
+        if (!hasString && !hasCAB && !hasAutoRef && !hasQPA) appendFormat(out, " [ ] None detected.\n");
+        appendFormat(out, "----------------------------------------\n");
+        if (mockPos > 0) { appendFormat(out, "\n[PROGRAM OUTPUT]\n%s\n----------------------------------------\n", mockOutput); }
+    } else {
+        appendFormat(out, "\n>>> SYNTAX ANALYSIS: PARSING UNSUCCESSFUL!\n");
     }
-    input[total_size] = '\0';
-    initScanner(input); lookaheadToken = getNextToken(); advance();
+}
+
+/* Diagnostics and summary of the last parse, written at once */
+void printSummary() {
+    OutputBuffer out = {0};
+    if (diagnosticsJson) renderJsonReport(&out); else renderTextReport(&out);
+    writeOutput(out.data ? out.data : "", out.length);
+    free(out.data);
+}
+
+/* Clear all parser and interpreter globals so another program can be analyzed in-process */
+void resetParserState() {
+    memset(symbolTable, 0, sizeof(symbolTable)); memset(symbolDirty, 0, sizeof(symbolDirty)); symbolCount = 0;
+    mockOutput[0] = '\0'; mockPos = 0;
+    memset(&currentToken, 0, sizeof(Token)); memset(&previousToken, 0, sizeof(Token)); memset(&lookaheadToken, 0, sizeof(Token));
+    panicMode = 0; success = 1; nestingDepth = 0; budgetExceeded = 0;
+    hasString = hasCAB = hasAutoRef = hasQPA = 0;
+    arenaReset(&parseArena); jitReset(); typeReset(); resetDiagnostics(NULL);
+}
+
+/* Parse and execute one NUL-terminated program */
+void parseProgram(const char *input) {
+    startBudget(); resetDiagnostics(input);
+    checkTypes(input);
+    initScanner(input); lookaheadToken = fetchToken(); advance();
     
     // Check for junk BEFORE program
     if (currentToken.type != TOKEN_RW_EXECUTE && currentToken.type != TOKEN_KW_STRUCT && currentToken.type != TOKEN_EOF) {
-        printf("[Syntax Error] Line %d: Unexpected content before program start\n", currentToken.line);
-        success = 0;
+        report(DIAG_BEFORE_PROGRAM, currentToken, currentToken.line, "Unexpected content before program start");
     } else {
         // Parse the single program structure
-        program();
+        if (cachePath && success) cachedProgram(); else program(); /* a program with type errors is not cached */
         // Check for trailing junk
         if (success && currentToken.type != TOKEN_EOF) {
-            printf("[Syntax Error] Line %d: Unexpected content after program end\n", currentToken.line);
-            success = 0;
+            report(DIAG_AFTER_PROGRAM, currentToken, currentToken.line, "Unexpected content after program end");
         }
     }
+}
 
-    if (success) {
-        printf("\n>>> SYNTAX ANALYSIS: PARSING SUCCESSFUL!\n");
-        printf("----------------------------------------\n");
-        printf("Principles Detected:\n");
-        if (hasString)  printf(" [x] Principle 1: String Data Type\n");
-        if (hasCAB)     printf(" [x] Principle 2: Conditional Assignment Blocks (CAB)\n");
-        if (hasAutoRef) printf(" [x] Principle 3: Auto Reference Command\n");
-        if (hasQPA)     printf(" [x] Principle 4: Quantum Pointer Aliasing (QPA)\n");
-        if (!hasString && !hasCAB && !hasAutoRef && !hasQPA) printf(" [ ] None detected.\n");
-        printf("----------------------------------------\n");
-        if (mockPos > 0) { printf("\n[PROGRAM OUTPUT]\n%s\n----------------------------------------\n", mockOutput); }
-    } else {
-        printf("\n>>> SYNTAX ANALYSIS: PARSING UNSUCCESSFUL!\n");
+/* ========================================================================= */
+/* 5. BATCH MODE                                                             */
+/* ========================================================================= */
+
+/*
+ * "parser [options] FILE..." (or --files-from=LIST) checks many programs in one process.
+ * Each result is framed as "#### FILE <index> <status> <bytes> <path>" followed by exactly
+ * <bytes> bytes of the usual output; status is 0 when parsing succeeded, 1 when it did not
+ * and 2 when the file could not be read. A reader thread loads the next files and a writer
+ * thread prints finished ones while the main thread parses.
+ */
+#define PIPELINE_DEPTH 4
+
+/* Read a whole stream into a NUL-terminated buffer; returns NULL if memory runs out */
+char *readStream(FILE *stream, size_t *size) {
+    size_t chunk_size = 100000; size_t buffer_size = chunk_size; size_t total_size = 0;
+    char *input = (char *)malloc(buffer_size); if (!input) return NULL;
+    size_t bytes_read; while ((bytes_read = fread(input + total_size, 1, chunk_size, stream)) > 0) {
+        total_size += bytes_read; if (total_size + chunk_size + 1 > buffer_size) {
+            buffer_size = (total_size + chunk_size + 1) * 2; char *grown = (char *)realloc(input, buffer_size);
+            if (!grown) { free(input); return NULL; } input = grown;
+        }
     }
-    
-    free(input); return 0;
-}
\ No newline at end of file
+    input[total_size] = '\0'; *size = total_size;
+    return input;
+}
+
+typedef struct {
+    int index; const char *path;
+    char *source; size_t size; /* NULL source if the file could not be read */
+    OutputBuffer out;          /* Filled by the parsing stage */
+    int status, done;          /* done: out is complete (--jobs) */
+} BatchJob;
+
+/* Bounded queue handing jobs from one pipeline stage to the next */
+typedef struct {
+    BatchJob *slots[PIPELINE_DEPTH]; int head, count, closed;
+    pthread_mutex_t lock; pthread_cond_t changed;
+} JobQueue;
+
+typedef struct {
+    const char **paths; int count, failures; JobQueue readQueue, doneQueue;
+    Stats readerStats, writerStats; /* Statistics of the helper threads, added after they are joined */
+} Batch;
+
+/* Statistics are per thread; add those a helper thread left behind to this thread's */
+void addStats(const Stats *from) {
+    stats.input_bytes += from->input_bytes;
+    stats.read_time += from->read_time; stats.lex_time += from->lex_time; stats.parse_time += from->parse_time;
+    stats.exec_time += from->exec_time; stats.format_time += from->format_time;
+    for (int i = 0; i <= TOKEN_EOF; i++) stats.tokens_by_type[i] += from->tokens_by_type[i];
+    stats.keyword_probes += from->keyword_probes; stats.symbol_lookups += from->symbol_lookups;
+    stats.relexed_tokens += from->relexed_tokens; stats.output_bytes += from->output_bytes;
+}
+
+void queueInit(JobQueue *q) { q->head = q->count = q->closed = 0; pthread_mutex_init(&q->lock, NULL); pthread_cond_init(&q->changed, NULL); }
+void queueDestroy(JobQueue *q) { pthread_mutex_destroy(&q->lock); pthread_cond_destroy(&q->changed); }
+void queueClose(JobQueue *q) { pthread_mutex_lock(&q->lock); q->closed = 1; pthread_cond_broadcast(&q->changed); pthread_mutex_unlock(&q->lock); }
+
+void queuePush(JobQueue *q, BatchJob *job) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == PIPELINE_DEPTH) pthread_cond_wait(&q->changed, &q->lock);
+    q->slots[(q->head + q->count++) % PIPELINE_DEPTH] = job;
+    pthread_cond_broadcast(&q->changed); pthread_mutex_unlock(&q->lock);
+}
+
+/* Take the next job, or NULL once the queue is closed and drained */
+BatchJob *queuePop(JobQueue *q) {
+    BatchJob *job = NULL;
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && !q->closed) pthread_cond_wait(&q->changed, &q->lock);
+    if (q->count > 0) { job = q->slots[q->head]; q->head = (q->head + 1) % PIPELINE_DEPTH; q->count--; pthread_cond_broadcast(&q->changed); }
+    pthread_mutex_unlock(&q->lock);
+    return job;
+}
+
+void *batchReader(void *arg) {
+    Batch *batch = (Batch *)arg;
+    for (int i = 0; i < batch->count; i++) {
+        BatchJob *job = (BatchJob *)calloc(1, sizeof(BatchJob)); if (!job) break;
+        job->index = i; job->path = batch->paths[i];
+        double start = nowSeconds();
+        FILE *file = fopen(job->path, "rb");
+        if (file) { job->source = readStream(file, &job->size); fclose(file); }
+        stats.read_time += nowSeconds() - start; stats.input_bytes += job->size;
+        queuePush(&batch->readQueue, job);
+    }
+    queueClose(&batch->readQueue);
+    batch->readerStats = stats;
+    return NULL;
+}
+
+void *batchWriter(void *arg) {
+    Batch *batch = (Batch *)arg; BatchJob *job;
+    while ((job = queuePop(&batch->doneQueue)) != NULL) {
+        double start = nowSeconds();
+        printf("#### FILE %d %d %zu %s\n", job->index, job->status, job->out.length, job->path);
+        fwrite(job->out.data, 1, job->out.length, stdout);
+        stats.format_time += nowSeconds() - start;
+        if (job->status != 0) batch->failures++;
+        free(job->out.data); free(job->source); free(job);
+    }
+    fflush(stdout);
+    batch->writerStats = stats;
+    return NULL;
+}
+
+/* Parse one file into its output buffer with this thread's parser state */
+void parseJob(BatchJob *job) {
+    double start = nowSeconds(), lexed = stats.lex_time, executed = stats.exec_time;
+    emitTarget = &job->out;
+    if (!job->source) { emit("Error: Cannot read '%s'\n", job->path); job->status = 2; }
+    else {
+        resetParserState(); stats.high_water = NULL;
+        parseProgram(job->source); printSummary();
+        job->status = success ? 0 : 1;
+    }
+    emitTarget = NULL;
+    stats.parse_time += nowSeconds() - start - (stats.lex_time - lexed) - (stats.exec_time - executed);
+}
+
+/* Parse every file on the calling thread between the reader and writer; returns 1 if all succeeded */
+int parseFiles(const char **paths, int count) {
+    Batch batch; batch.paths = paths; batch.count = count; batch.failures = 0;
+    queueInit(&batch.readQueue); queueInit(&batch.doneQueue);
+    pthread_t reader, writer;
+    if (pthread_create(&reader, NULL, batchReader, &batch) != 0) { fprintf(stderr, "Error: Cannot start reader thread\n"); return 0; }
+    if (pthread_create(&writer, NULL, batchWriter, &batch) != 0) { fprintf(stderr, "Error: Cannot start writer thread\n"); pthread_join(reader, NULL); return 0; }
+
+    BatchJob *job;
+    while ((job = queuePop(&batch.readQueue)) != NULL) { parseJob(job); queuePush(&batch.doneQueue, job); }
+    queueClose(&batch.doneQueue);
+    pthread_join(reader, NULL); pthread_join(writer, NULL);
+    addStats(&batch.readerStats); addStats(&batch.writerStats);
+    queueDestroy(&batch.readQueue); queueDestroy(&batch.doneQueue);
+    return batch.failures == 0;
+}
+
+/*
+ * --jobs=N (N > 1): the files are sorted largest-first and dealt round-robin into one deque
+ * per worker thread. A worker takes the largest file left at the front of its own deque and,
+ * once that is empty, steals the smallest from the back of another worker's. Each worker reads
+ * and parses whole files with its own (thread-local) parser state; the calling thread prints
+ * the finished files in input order.
+ */
+#define WORKER_STACK_SIZE (8 * 1024 * 1024) /* Same as a typical main thread: parsing recurses */
+
+typedef struct { int *items; int head, tail; pthread_mutex_t lock; } WorkDeque; /* owner: head, thieves: tail */
+typedef struct {
+    BatchJob *jobs; int count, workers, statsEnabled; WorkDeque *deques;
+    pthread_mutex_t doneLock; pthread_cond_t doneChanged;
+} WorkPool;
+typedef struct { WorkPool *pool; int self; Stats stats; /* added after the worker is joined */ } Worker;
+typedef struct { int index; long long size; } SizedFile;
+
+/* Number of online processors, used when --jobs=0 */
+int cpuCount() {
+#ifdef _SC_NPROCESSORS_ONLN
+    long count = sysconf(_SC_NPROCESSORS_ONLN); return count > 0 ? (int)count : 1;
+#else
+    return 1;
+#endif
+}
+
+/* Largest first; equal sizes keep input order so the schedule is reproducible */
+int compareSizeDescending(const void *a, const void *b) {
+    const SizedFile *x = (const SizedFile *)a, *y = (const SizedFile *)b;
+    if (x->size != y->size) return x->size < y->size ? 1 : -1;
+    return x->index - y->index;
+}
+
+/* Next job for a worker, or -1 when every deque is empty (no work is ever added) */
+int takeJob(WorkPool *pool, int self) {
+    int job = -1; WorkDeque *own = &pool->deques[self];
+    pthread_mutex_lock(&own->lock); if (own->head < own->tail) job = own->items[own->head++]; pthread_mutex_unlock(&own->lock);
+    for (int k = 1; job < 0 && k < pool->workers; k++) {
+        WorkDeque *victim = &pool->deques[(self + k) % pool->workers];
+        pthread_mutex_lock(&victim->lock); if (victim->head < victim->tail) job = victim->items[--victim->tail]; pthread_mutex_unlock(&victim->lock);
+    }
+    return job;
+}
+
+void *poolWorker(void *arg) {
+    Worker *worker = (Worker *)arg; WorkPool *pool = worker->pool; int index;
+    stats.enabled = pool->statsEnabled;
+    while ((index = takeJob(pool, worker->self)) >= 0) {
+        BatchJob *job = &pool->jobs[index];
+        double start = nowSeconds();
+        FILE *file = fopen(job->path, "rb");
+        if (file) { job->source = readStream(file, &job->size); fclose(file); }
+        stats.read_time += nowSeconds() - start; stats.input_bytes += job->size;
+        parseJob(job);
+        free(job->source); job->source = NULL;
+        pthread_mutex_lock(&pool->doneLock); job->done = 1; pthread_cond_broadcast(&pool->doneChanged); pthread_mutex_unlock(&pool->doneLock);
+    }
+    arenaRelease(&parseArena); jitReset(); typeReset();
+    worker->stats = stats;
+    return NULL;
+}
+
+/* Parse every file on `workers` threads; returns 1 if all succeeded */
+int parseFilesParallel(const char **paths, int count, int workers) {
+    WorkPool pool; pool.count = count; pool.workers = workers < count ? workers : count; pool.statsEnabled = stats.enabled;
+    int perWorker = (count + pool.workers - 1) / pool.workers;
+    pool.jobs = (BatchJob *)calloc(count, sizeof(BatchJob)); pool.deques = (WorkDeque *)calloc(pool.workers, sizeof(WorkDeque));
+    SizedFile *order = (SizedFile *)malloc(count * sizeof(SizedFile)); int *slots = (int *)malloc(pool.workers * perWorker * sizeof(int));
+    Worker *contexts = (Worker *)malloc(pool.workers * sizeof(Worker)); pthread_t *threads = (pthread_t *)malloc(pool.workers * sizeof(pthread_t));
+    int failures = 0, started = 0;
+    if (!pool.jobs || !pool.deques || !order || !slots || !contexts || !threads) { fprintf(stderr, "Error: Memory allocation failed\n"); failures = count; goto cleanup; }
+
+    for (int i = 0; i < count; i++) {
+        struct stat info; pool.jobs[i].index = i; pool.jobs[i].path = paths[i];
+        order[i].index = i; order[i].size = stat(paths[i], &info) == 0 ? (long long)info.st_size : 0;
+    }
+    qsort(order, count, sizeof(SizedFile), compareSizeDescending);
+    for (int w = 0; w < pool.workers; w++) { pool.deques[w].items = slots + w * perWorker; pthread_mutex_init(&pool.deques[w].lock, NULL); }
+    for (int k = 0; k < count; k++) { WorkDeque *deque = &pool.deques[k % pool.workers]; deque->items[deque->tail++] = order[k].index; }
+    pthread_mutex_init(&pool.doneLock, NULL); pthread_cond_init(&pool.doneChanged, NULL);
+
+    /* Deques of workers that could not be started are emptied by stealing */
+    pthread_attr_t attr; pthread_attr_init(&attr); pthread_attr_setstacksize(&attr, WORKER_STACK_SIZE);
+    for (; started < pool.workers; started++) {
+        contexts[started].pool = &pool; contexts[started].self = started;
+        if (pthread_create(&threads[started], &attr, poolWorker, &contexts[started]) != 0) break;
+    }
+    pthread_attr_destroy(&attr);
+    if (started == 0) { fprintf(stderr, "Error: Cannot start worker threads\n"); failures = count; }
+
+    /* Print in input order as soon as each file is finished */
+    for (int i = 0; started > 0 && i < count; i++) {
+        BatchJob *job = &pool.jobs[i];
+        pthread_mutex_lock(&pool.doneLock); while (!job->done) pthread_cond_wait(&pool.doneChanged, &pool.doneLock); pthread_mutex_unlock(&pool.doneLock);
+        double start = nowSeconds();
+        printf("#### FILE %d %d %zu %s\n", job->index, job->status, job->out.length, job->path);
+        fwrite(job->out.data, 1, job->out.length, stdout);
+        stats.format_time += nowSeconds() - start;
+        if (job->status != 0) failures++;
+        free(job->out.data);
+    }
+    fflush(stdout);
+    for (int w = 0; w < started; w++) { pthread_join(threads[w], NULL); addStats(&contexts[w].stats); }
+    for (int w = 0; w < pool.workers; w++) pthread_mutex_destroy(&pool.deques[w].lock);
+    pthread_mutex_destroy(&pool.doneLock); pthread_cond_destroy(&pool.doneChanged);
+cleanup:
+    free(pool.jobs); free(pool.deques); free(order); free(slots); free(contexts); free(threads);
+    return failures == 0;
+}
+
+/* Read a --files-from list ("-" for stdin): one path per line */
+int readFileList(const char *listPath, char **listText, const char ***paths, int *count) {
+    FILE *file = strcmp(listPath, "-") == 0 ? stdin : fopen(listPath, "rb"); size_t size = 0;
+    if (!file) return 0;
+    *listText = readStream(file, &size); if (file != stdin) fclose(file);
+    if (!*listText) return 0;
+    for (char *line = strtok(*listText, "\r\n"); line; line = strtok(NULL, "\r\n")) {
+        const char **grown = (const char **)realloc(*paths, (*count + 1) * sizeof(char *)); if (!grown) return 0;
+        *paths = grown; (*paths)[(*count)++] = line;
+    }
+    return 1;
+}
+
+/* Parse a whole decimal option value in [minimum, maximum]; garbage, overflow or a value out of range fails */
+int parseCount(const char *text, long minimum, long maximum, long *value) {
+    char *end; errno = 0; long parsed = strtol(text, &end, 10);
+    if (end == text || *end || errno == ERANGE || parsed < minimum || parsed > maximum) return 0;
+    *value = parsed; return 1;
+}
+
+/* Report a malformed option value; main returns the result as its exit status */
+int optionError(const char *option, const char *expected) {
+    fprintf(stderr, "Error: %s expects %s\n", option, expected); return 1;
+}
+
+/* ========================================================================= */
+/* 6. C CODE GENERATION (--emit-c)                                           */
+/* ========================================================================= */
+
+/*
+ * "parser --emit-c < prog.txt > prog.c" translates a program into one C file; built with gcc, it
+ * prints exactly what the interpreter shows under [PROGRAM OUTPUT]. The generator is a second
+ * recursive descent over the same tokens: each gen* function consumes them like its counterpart in
+ * section 3 and reports the same syntax errors, but writes C instead of executing, so every loop
+ * body is translated once. The generated program keeps the interpreter's rules: expressions are
+ * floats, a variable holds what its symbol-table text would read back ("%.0f" after an assignment,
+ * "%.0f"/"%.1f" after a declaration), division by zero leaves the left operand, and every
+ * if/elif/else branch runs. It has no step budget and no 8 KB output buffer. Nested assign blocks
+ * and more than MAX_SYMBOLS variables are not supported.
+ */
+static const char *cRuntime[] = {
+    "#include <ctype.h>",
+    "#include <math.h>",
+    "#include <stdio.h>",
+    "#include <stdlib.h>",
+    "#include <string.h>",
+    "",
+    "/* What the interpreter's symbol table holds for a name: nothing yet, a number that reads back",
+    "   from \"%.0f\" or \"%.1f\" text, or a text such as a string literal with its quotes */",
+    "enum { CN_UNDEFINED, CN_WHOLE, CN_DECIMAL, CN_TEXT };",
+    "typedef struct { int kind; float num; const char *text; char digits[48]; } CnValue;",
+    "",
+    "static int cn_last; /* last byte printed, 0 before any output */",
+    "",
+    "static void cn_write(const char *text, size_t len) { if (len) { fwrite(text, 1, len, stdout); cn_last = (unsigned char)text[len - 1]; } }",
+    "static void cn_puts(const char *text) { cn_write(text, strlen(text)); }",
+    "static void cn_newline(void) { if (cn_last && cn_last != '\\n') cn_write(\"\\n\", 1); }",
+    "static void cn_quoted(const char *text) { size_t len = strlen(text); if (len > 2) cn_write(text + 1, len - 2); }",
+    "",
+    "static float cn_num(const CnValue *v) { return v->kind == CN_TEXT ? (float)atof(v->text) : v->num; }",
+    "static float cn_div(float l, float r) { return r != 0 ? l / r : l; }",
+    "static void cn_set_text(CnValue *v, const char *text) { v->kind = CN_TEXT; v->text = text; }",
+    "",
+    "/* Assignments, ++ and --: stored as \"%.0f\" */",
+    "static void cn_round(CnValue *v, float f) { v->kind = CN_WHOLE; v->num = (float)rint(f); }",
+    "",
+    "/* Declarations, assign-block values and for updates: \"%.0f\" when whole, else \"%.1f\" */",
+    "static void cn_store(CnValue *v, float f)",
+    "{",
+    "    if (floorf(f) == f) { v->kind = CN_WHOLE; v->num = f; return; }",
+    "    snprintf(v->digits, sizeof v->digits, \"%.1f\", f);",
+    "    v->kind = CN_DECIMAL; v->num = (float)atof(v->digits); v->text = v->digits;",
+    "}",
+    "",
+    "static float cn_apply(float cv, int op, float val)",
+    "{",
+    "    switch (op) {",
+    "    case '+': return cv + val;",
+    "    case '-': return cv - val;",
+    "    case '*': return cv * val;",
+    "    case '/': return val != 0 ? cv / val : cv;",
+    "    case '=': return val;",
+    "    default: return cv; /* %= changes nothing */",
+    "    }",
+    "}",
+    "",
+    "/* x op= value; a name that does not exist yet just takes the value */",
+    "static void cn_assign(CnValue *v, int op, float val) { cn_round(v, v->kind == CN_UNDEFINED ? val : cn_apply(cn_num(v), op, val)); }",
+    "/* The update part of a for loop only changes an existing name */",
+    "static void cn_update(CnValue *v, int op, float val) { if (v->kind != CN_UNDEFINED) cn_store(v, cn_apply(cn_num(v), op, val)); }",
+    "static void cn_step(CnValue *v, float delta) { if (v->kind != CN_UNDEFINED) cn_round(v, cn_num(v) + delta); }",
+    "",
+    "/* The symbol-table text of a defined name */",
+    "static const char *cn_text(const CnValue *v, char *buf)",
+    "{",
+    "    if (v->kind == CN_TEXT || v->kind == CN_DECIMAL) return v->text;",
+    "    snprintf(buf, 64, \"%.0f\", v->num);",
+    "    return buf;",
+    "}",
+    "",
+    "static void cn_display(float f)",
+    "{",
+    "    char buf[64];",
+    "    snprintf(buf, sizeof buf, floorf(f) == f ? \"%.0f\" : \"%.1f\", f);",
+    "    cn_puts(buf);",
+    "}",
+    "",
+    "/* display(name): a string or char prints without its quotes, anything else as a number */",
+    "static void cn_display_var(const CnValue *v)",
+    "{",
+    "    if (v->kind == CN_TEXT && (v->text[0] == '\"' || v->text[0] == '\\'')) cn_quoted(v->text); else cn_display(cn_num(v));",
+    "}",
+    "",
+    "/* {name} inside a string */",
+    "static void cn_interpolate(const CnValue *v)",
+    "{",
+    "    char buf[64];",
+    "    const char *text;",
+    "    if (v->kind == CN_UNDEFINED) { cn_puts(\"0\"); return; }",
+    "    text = cn_text(v, buf);",
+    "    if (text[0] == '\"' || text[0] == '\\'') cn_quoted(text); else cn_puts(text);",
+    "}",
+    "",
+    "/* {name->field} inside a string: the first quoted text for a *name* field, the digits after the first comma for an *id* field */",
+    "static void cn_field(const CnValue *v, const char *field)",
+    "{",
+    "    char buf[64];",
+    "    const char *text, *start, *end;",
+    "    size_t len = 0;",
+    "    if (v->kind == CN_UNDEFINED) { cn_puts(\"0\"); return; }",
+    "    text = cn_text(v, buf);",
+    "    if (strstr(field, \"name\")) {",
+    "        if ((start = strchr(text, '\"')) != NULL && (end = strchr(start + 1, '\"')) != NULL) {",
+    "            len = (size_t)(end - start - 1);",
+    "            cn_write(start + 1, len > 127 ? 127 : len);",
+    "            return;",
+    "        }",
+    "    } else if (strstr(field, \"id\")) {",
+    "        if ((start = strchr(text, ',')) != NULL) {",
+    "            for (start++; *start == ' '; start++) {}",
+    "            while (len < 127 && isdigit((unsigned char)start[len])) len++;",
+    "            cn_write(start, len);",
+    "            return;",
+    "        }",
+    "    }",
+    "    cn_puts(\"0\");",
+    "}",
+    "",
+    "/* name[index] of an auto_ref array such as [1,2.5,3]; 0 when there is no such element */",
+    "static float cn_index(const CnValue *v, int index)",
+    "{",
+    "    char buf[64], temp[64];",
+    "    const char *p;",
+    "    int count = 0;",
+    "    if (v->kind == CN_UNDEFINED) return 0;",
+    "    p = cn_text(v, buf);",
+    "    if (*p++ != '[') return 0;",
+    "    while (*p != ']' && *p != '\\0') {",
+    "        int i = 0;",
+    "        while (*p == ' ' || *p == ',') p++;",
+    "        if (*p == ']' || *p == '\\0') break;",
+    "        while (isdigit((unsigned char)*p) || *p == '.') { if (i < 63) temp[i++] = *p; p++; }",
+    "        temp[i] = '\\0';",
+    "        if (i == 0 && *p != ']' && *p != '\\0') { p++; continue; }",
+    "        if (count == index) return (float)atof(temp);",
+    "        count++;",
+    "    }",
+    "    return 0;",
+    "}",
+};
+
+/* Variables of the generated program; defined: assigned somewhere earlier in the source */
+typedef struct { char name[MAX_VAR_LEN]; int defined; } CVariable;
+
+_Thread_local CVariable *cVariables = NULL;
+_Thread_local int cVariableCount = 0, cVariableCapacity = 0;
+_Thread_local OutputBuffer cCode; /* Body of the generated main() */
+_Thread_local int cIndent = 1;
+
+void genStatementList(); void genStatement(); void genStatementBody(); void genDeclaration(); void genIfStatement();
+void genAssignmentBlock(); void genAssignment(); void genDisplay(); void genBlock(const char *tail);
+char *genExpression(); char *genLogicOr(); char *genLogicAnd(); char *genEquality(); char *genRelational();
+char *genSimpleExpression(); char *genTerm(); char *genFactor();
+
+/* printf into parseArena; the text lives until the statement being generated is finished */
+char *cFormat(const char *format, ...) {
+    va_list args, again; va_start(args, format); va_copy(again, args);
+    int len = vsnprintf(NULL, 0, format, args);
+    char *text = (char *)arenaAlloc(&parseArena, len + 1); vsnprintf(text, len + 1, format, again);
+    va_end(again); va_end(args);
+    return text;
+}
+
+/* One indented line of main()'s body */
+void cLine(const char *format, ...) {
+    va_list args, again; va_start(args, format); va_copy(again, args);
+    int len = vsnprintf(NULL, 0, format, args);
+    ArenaMark mark = arenaMark(&parseArena);
+    char *text = (char *)arenaAlloc(&parseArena, len + 1); vsnprintf(text, len + 1, format, again);
+    va_end(again); va_end(args);
+    for (int i = 0; i < cIndent; i++) appendOutput(&cCode, "    ", 4);
+    appendOutput(&cCode, text, len); appendOutput(&cCode, "\n", 1);
+    arenaRewind(&parseArena, mark);
+}
+
+/* A C string literal; octal escapes never run into the next character and '?' cannot start a trigraph */
+char *cQuote(const char *text, int len) {
+    char *out = (char *)arenaAlloc(&parseArena, (size_t)len * 4 + 3), *p = out;
+    *p++ = '"';
+    for (int i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '"' || c == '\\' || c == '?') { *p++ = '\\'; *p++ = (char)c; }
+        else if (c < 32 || c >= 127) p += sprintf(p, "\\%03o", c);
+        else *p++ = (char)c;
+    }
+    *p++ = '"'; *p = '\0';
+    return out;
+}
+
+/* The shortest float literal that reads back as f */
+char *cFloat(float f) {
+    if (isinf(f)) return "HUGE_VALF";
+    char buf[64];
+    for (int digits = 6; digits <= 9; digits++) { snprintf(buf, sizeof(buf), "%.*g", digits, f); if (strtof(buf, NULL) == f) break; }
+    return cFormat("%s%sf", buf, strpbrk(buf, ".e") ? "" : ".0");
+}
+
+/* The C variable for a symbol name, e.g. v_count */
+char *cVariable(const char *name, int define) {
+    int i = 0;
+    while (i < cVariableCount && strcmp(cVariables[i].name, name) != 0) i++;
+    if (i == cVariableCount) {
+        if (cVariableCount == cVariableCapacity) {
+            int cap = cVariableCapacity ? cVariableCapacity * 2 : 64;
+            CVariable *grown = (CVariable *)realloc(cVariables, cap * sizeof(CVariable));
+            if (!grown) { fprintf(stderr, "Error: Memory allocation failed\n"); exit(1); }
+            cVariables = grown; cVariableCapacity = cap;
+        }
+        strcpy(cVariables[i].name, name); cVariables[i].defined = 0; cVariableCount++;
+    }
+    if (define) cVariables[i].defined = 1;
+    return cFormat("v_%s", name);
+}
+
+int cDefined(const char *name) {
+    for (int i = 0; i < cVariableCount; i++) if (strcmp(cVariables[i].name, name) == 0) return cVariables[i].defined;
+    return 0;
+}
+
+/* The operator argument of cn_assign() and cn_update() for ASSIGN_OP .. MOD_ASSIGN_OP */
+char cOperator(TokenType op) {
+    switch (op) {
+        case TOKEN_ADD_ASSIGN_OP: return '+'; case TOKEN_SUB_ASSIGN_OP: return '-'; case TOKEN_MULT_ASSIGN_OP: return '*';
+        case TOKEN_DIV_ASSIGN_OP: return '/'; case TOKEN_MOD_ASSIGN_OP: return '%'; default: return '=';
+    }
+}
+
+/* Only names the lexer can produce reach the symbol table; any other {lookup} prints 0 */
+int cSymbolName(const char *name) {
+    if (!isLetter(name[0]) && name[0] != '_') return 0;
+    for (const char *p = name; *p; p++) if (!isLetter(*p) && !isDigit(*p) && *p != '_') return 0;
+    return 1;
+}
+
+/* parseInterpolation, resolved at compile time into output calls */
+void genInterpolation(const char *start, int len) {
+    int i = 0, literal = 0; /* literal: start of the pending plain text */
+    char varName[64];
+    while (i < len) {
+        if (start[i] != '{') { i++; continue; }
+        if (i > literal) cLine("cn_puts(%s);", cQuote(start + literal, i - literal));
+        i++;
+        int vIdx = 0;
+        if (start[i] == '*') { varName[vIdx++] = '*'; i++; }
+        while (i < len && (isalnum(start[i]) || start[i] == '_' || start[i] == '-' || start[i] == '>')) {
+            if (vIdx < 63) varName[vIdx++] = start[i++]; else i++;
+        }
+        varName[vIdx] = '\0';
+        char lookup[64]; strcpy(lookup, varName);
+        if (lookup[0] == '*') memmove(lookup, lookup + 1, strlen(lookup));
+        char *arrow = strstr(lookup, "->");
+        if (cSymbolName(lookup)) cLine("cn_interpolate(&%s);", cVariable(lookup, 0));
+        else if (arrow) {
+            char structName[32]; char fieldName[32];
+            int sLen = arrow - lookup; if (sLen > 31) sLen = 31;
+            strncpy(structName, lookup, sLen); structName[sLen] = '\0';
+            strncpy(fieldName, arrow + 2, 31); fieldName[31] = '\0';
+            if (cSymbolName(structName)) cLine("cn_field(&%s, %s);", cVariable(structName, 0), cQuote(fieldName, (int)strlen(fieldName)));
+            else cLine("cn_puts(\"0\");");
+        }
+        else cLine("cn_puts(\"0\");");
+        if (i < len && start[i] == '}') i++;
+        literal = i;
+    }
+    if (i > literal) cLine("cn_puts(%s);", cQuote(start + literal, i - literal));
+}
+
+void genProgram() {
+    while (currentToken.type == TOKEN_KW_STRUCT) {
+        consume(TOKEN_KW_STRUCT, "Expected 'struct'"); consume(TOKEN_IDENTIFIER, "Expected struct name"); consume(TOKEN_L_BRACE, "Expected '{'");
+        while (isType(currentToken)) genDeclaration();
+        consume(TOKEN_R_BRACE, "Expected '}'");
+        if (panicMode) synchronize();
+    }
+    if (currentToken.type == TOKEN_RW_EXECUTE) {
+        consume(TOKEN_RW_EXECUTE, "Expected 'execute'"); if (panicMode) synchronize();
+        consume(TOKEN_L_PAREN, "Expected '('"); consume(TOKEN_R_PAREN, "Expected ')'"); consume(TOKEN_L_BRACE, "Expected '{'");
+        genStatementList();
+        if (currentToken.type == TOKEN_RW_EXIT) {
+            advance(); consume(TOKEN_L_PAREN, "Expected '('"); consume(TOKEN_R_PAREN, "Expected ')'"); consume(TOKEN_SEMICOLON, "Expected ';'");
+        }
+        consume(TOKEN_R_BRACE, "Expected '}'");
+    } else {
+        error("Unexpected token");
+        advance();
+    }
+}
+
+void genStatementList() {
+    while (currentToken.type != TOKEN_RW_EXIT && currentToken.type != TOKEN_R_BRACE && currentToken.type != TOKEN_EOF) {
+        genStatement();
+        if (panicMode) {
+            while (currentToken.type != TOKEN_SEMICOLON && currentToken.type != TOKEN_R_BRACE && currentToken.type != TOKEN_EOF) advance();
+            if (currentToken.type == TOKEN_SEMICOLON) advance();
+            panicMode = 0;
+        }
+    }
+}
+
+/* Statements run in order on every pass, so the arena is rewound after each one */
+void genStatement() {
+    if (!enterNesting()) { advance(); return; }
+    ArenaMark mark = arenaMark(&parseArena);
+    genStatementBody();
+    arenaRewind(&parseArena, mark); leaveNesting();
+}
+
+void genStatementBody() {
+    if (isType(currentToken)) genDeclaration();
+    else if (currentToken.type == TOKEN_IDENTIFIER) {
+        checkConfusion(currentToken); if (panicMode) { return; }
+        if (currentToken.type == TOKEN_KW_ELSE) { softError("Invalid syntax: 'else' without 'if'"); advance(); return; }
+        if (lookaheadToken.type >= TOKEN_ADD_OP && lookaheadToken.type <= TOKEN_EXPO_OP) {
+            genExpression(); /* no effect */
+            consume(TOKEN_SEMICOLON, ";");
+        } else {
+            genAssignment();
+        }
+    }
+    else if (currentToken.type == TOKEN_KW_DISPLAY) genDisplay();
+    else if (currentToken.type == TOKEN_KW_ASSIGN) { if (!enterNesting()) { advance(); return; } genAssignmentBlock(); leaveNesting(); }
+    else if (currentToken.type == TOKEN_KW_IF) genIfStatement();
+    else if (currentToken.type == TOKEN_KW_WHILE) {
+        consume(TOKEN_KW_WHILE, "while"); consume(TOKEN_L_PAREN, "(");
+        char *cond = genExpression();
+        consume(TOKEN_R_PAREN, ")");
+        cLine("while (%s)", cond); genBlock(NULL);
+    }
+    else if (currentToken.type == TOKEN_KW_DO) {
+        consume(TOKEN_KW_DO, "do");
+        cLine("do"); genBlock(NULL);
+        consume(TOKEN_KW_WHILE, "while"); consume(TOKEN_L_PAREN, "(");
+        cLine("while (%s);", genExpression());
+        consume(TOKEN_R_PAREN, ")"); consume(TOKEN_SEMICOLON, ";");
+    }
+    else if (currentToken.type == TOKEN_KW_FOR) {
+        consume(TOKEN_KW_FOR, "for"); consume(TOKEN_L_PAREN, "(");
+        if (isType(currentToken)) genDeclaration(); else genAssignment();
+        char *cond = genExpression();
+        consume(TOKEN_SEMICOLON, ";");
+
+        /* The interpreter parses the update after each pass of the body; translate it, then skip it like forLoop() */
+        Scanner updStart = scanner; Token updTok = currentToken; Token updLook = lookaheadToken;
+        char *update = NULL;
+        if (currentToken.type == TOKEN_IDENTIFIER) {
+            char varName[64]; copyLexeme(varName, sizeof(varName), currentToken);
+            advance();
+            if (currentToken.type == TOKEN_INCREMENT_OP || currentToken.type == TOKEN_DECREMENT_OP) {
+                update = cFormat("cn_step(&%s, %s);", cVariable(varName, 0), currentToken.type == TOKEN_INCREMENT_OP ? "1" : "-1");
+            } else if (currentToken.type >= TOKEN_ASSIGN_OP && currentToken.type <= TOKEN_MOD_ASSIGN_OP) {
+                char op = cOperator(currentToken.type); advance();
+                char *val = genExpression();
+                update = cFormat("cn_update(&%s, '%c', %s);", cVariable(varName, 0), op, val);
+            }
+        }
+        scanner = updStart; currentToken = updTok; lookaheadToken = updLook;
+        int pCount = 0;
+        while ((currentToken.type != TOKEN_R_PAREN || pCount > 0) && currentToken.type != TOKEN_EOF) {
+            if (currentToken.type == TOKEN_L_BRACE) { softError("Missing ')' in for loop"); break; }
+            if (currentToken.type == TOKEN_L_PAREN) pCount++;
+            else if (currentToken.type == TOKEN_R_PAREN) pCount--;
+            advance();
+        }
+        consume(TOKEN_R_PAREN, "Expected ')'");
+        cLine("while (%s)", cond); genBlock(update);
+    }
+    else if (currentToken.type == TOKEN_KW_FN) {
+        /* The interpreter runs a function body where it is declared */
+        consume(TOKEN_KW_FN, "fn"); consume(TOKEN_IDENTIFIER, "ID"); consume(TOKEN_L_PAREN, "("); consume(TOKEN_R_PAREN, ")");
+        genBlock(NULL);
+    }
+    else if (currentToken.type == TOKEN_QUANTUM_POINTER_OP || currentToken.type == TOKEN_MULT_OP) {
+        /* Writes through a pointer are parsed but change nothing */
+        if (currentToken.type == TOKEN_QUANTUM_POINTER_OP) hasQPA = 1;
+        advance(); consume(TOKEN_IDENTIFIER, "Pointer ID"); advance(); genExpression(); consume(TOKEN_SEMICOLON, ";");
+    }
+    else { error("Unexpected statement start"); advance(); }
+}
+
+/* A braced block of statements; tail is an extra last line inside it (a for update) */
+void genBlock(const char *tail) {
+    consume(TOKEN_L_BRACE, "{");
+    cLine("{"); cIndent++;
+    genStatementList();
+    if (tail) cLine("%s", tail);
+    cIndent--; cLine("}");
+    consume(TOKEN_R_BRACE, "}");
+}
+
+/* Constructs the interpreter accepts but the generated program cannot reproduce */
+void unsupported(const char *what) {
+    report(DIAG_UNSUPPORTED, currentToken, currentToken.line, "%s %s not supported by --emit-c", what, what[strlen(what) - 1] == 's' ? "are" : "is");
+}
+
+/* storeText(): a string literal or string variable into a string variable */
+int genText(const char *varName) {
+    if (currentToken.type == TOKEN_STRING) {
+        char sBuf[256]; copyLexeme(sBuf, sizeof(sBuf), currentToken);
+        cLine("cn_set_text(&%s, %s);", cVariable(varName, 1), cQuote(sBuf, (int)strlen(sBuf))); advance();
+        return 1;
+    }
+    if (currentToken.type != TOKEN_IDENTIFIER || (lookaheadToken.type != TOKEN_COMMA && lookaheadToken.type != TOKEN_SEMICOLON)) return 0;
+    char valName[64]; copyLexeme(valName, sizeof(valName), currentToken);
+    if (typeOf(valName) != TYPE_TEXT) return 0;
+    char *source = cVariable(valName, 0), *var = cVariable(varName, 1);
+    cLine("if (%s.kind != CN_UNDEFINED) %s = %s; else cn_store(&%s, 0.0f);", source, var, source, var); advance();
+    return 1;
+}
+
+void genDeclaration() {
+    int declType = -1;
+    if (currentToken.type == TOKEN_TYPE_INT || currentToken.type == TOKEN_TYPE_FLOAT) declType = 1;
+    else if (currentToken.type == TOKEN_TYPE_STRING) { declType = 3; hasString = 1; }
+    int textDecl = currentToken.type == TOKEN_TYPE_STRING || currentToken.type == TOKEN_TYPE_CHAR;
+
+    advance();
+    if (currentToken.type == TOKEN_MULT_OP || currentToken.type == TOKEN_POINTER_OP) advance();
+    if (currentToken.type == TOKEN_QUANTUM_POINTER_OP) { hasQPA = 1; advance(); }
+
+    do {
+        char varName[64];
+        if (currentToken.type == TOKEN_IDENTIFIER) {
+            copyLexeme(varName, sizeof(varName), currentToken);
+        } else {
+            softError("Invalid identifier name (reserved word)");
+            advance(); goto finish_decl;
+        }
+        consume(TOKEN_IDENTIFIER, "Expected variable name");
+
+        if (currentToken.type == TOKEN_ASSIGN_OP) {
+            advance();
+            if (declType == 3 && currentToken.type == TOKEN_IDENTIFIER) {
+                char valName[64]; copyLexeme(valName, sizeof(valName), currentToken);
+                if (!cDefined(valName)) {
+                    softError("Missing quotation marks for string literal");
+                    advance();
+                    goto finish_decl;
+                }
+            }
+            if (textDecl && genText(varName)) goto finish_decl;
+            if (currentToken.type == TOKEN_L_BRACE && hasQPA) {
+                advance();
+                while (currentToken.type != TOKEN_R_BRACE && currentToken.type != TOKEN_EOF) {
+                    if (currentToken.type == TOKEN_ADDRESS_OF_OP) advance();
+                    if (currentToken.type == TOKEN_IDENTIFIER) advance();
+                    if (currentToken.type == TOKEN_COMMA) advance();
+                    else if (currentToken.type != TOKEN_R_BRACE && currentToken.type != TOKEN_IDENTIFIER && currentToken.type != TOKEN_ADDRESS_OF_OP) { softError("Expected quantum pointer target"); advance(); }
+                }
+                consume(TOKEN_R_BRACE, "Expected '}'");
+                /* setQPA() adds an entry with an empty value, which getSymbol() only finds if the name is new */
+                char *var = cVariable(varName, 1);
+                cLine("if (%s.kind == CN_UNDEFINED) cn_set_text(&%s, \"\");", var, var);
+                goto finish_decl;
+            }
+            if (currentToken.type == TOKEN_RW_AUTO_REF) {
+                hasAutoRef = 1;
+                advance(); consume(TOKEN_L_PAREN, "(");
+                if (isType(currentToken) || currentToken.type == TOKEN_IDENTIFIER) advance();
+                consume(TOKEN_COMMA, ",");
+                if (currentToken.type == TOKEN_L_BRACKET) {
+                     char *arrayVal = (char *)arenaAlloc(&parseArena, MAX_VAL_LEN); strcpy(arrayVal, "[");
+                     advance();
+                     while (currentToken.type != TOKEN_R_BRACKET && currentToken.type != TOKEN_EOF) {
+                         if (currentToken.type == TOKEN_NUMBER_INT || currentToken.type == TOKEN_NUMBER_FLOAT) {
+                             appendBounded(arrayVal, MAX_VAL_LEN - 1, currentToken.lexeme_start, currentToken.lexeme_length); appendBounded(arrayVal, MAX_VAL_LEN - 1, ",", 1);
+                         }
+                         advance();
+                     }
+                     if (arrayVal[strlen(arrayVal)-1] == ',') arrayVal[strlen(arrayVal)-1] = '\0';
+                     strcat(arrayVal, "]"); cLine("cn_set_text(&%s, %s);", cVariable(varName, 1), cQuote(arrayVal, (int)strlen(arrayVal)));
+                     consume(TOKEN_R_BRACKET, "]");
+                }
+                else if (currentToken.type == TOKEN_L_BRACE) {
+                     char *structVal = (char *)arenaAlloc(&parseArena, MAX_VAL_LEN); strcpy(structVal, "{");
+                     advance();
+                     while (currentToken.type != TOKEN_R_BRACE && currentToken.type != TOKEN_EOF) {
+                         if (currentToken.type == TOKEN_STRING) {
+                              appendBounded(structVal, MAX_VAL_LEN - 1, "\"", 1); appendBounded(structVal, MAX_VAL_LEN - 1, currentToken.lexeme_start+1, currentToken.lexeme_length-2); appendBounded(structVal, MAX_VAL_LEN - 1, "\"", 1);
+                         } else { appendBounded(structVal, MAX_VAL_LEN - 1, currentToken.lexeme_start, currentToken.lexeme_length); }
+                         appendBounded(structVal, MAX_VAL_LEN - 1, ",", 1); advance(); if (currentToken.type == TOKEN_COMMA) advance();
+                     }
+                     if (structVal[strlen(structVal)-1] == ',') structVal[strlen(structVal)-1] = '\0';
+                     strcat(structVal, "}"); cLine("cn_set_text(&%s, %s);", cVariable(varName, 1), cQuote(structVal, (int)strlen(structVal)));
+                     consume(TOKEN_R_BRACKET, "}");
+                }
+                else {
+                    char *value = genExpression(); cLine("cn_store(&%s, %s);", cVariable(varName, 1), value);
+                }
+                consume(TOKEN_R_PAREN, ")");
+            }
+            else if (currentToken.type == TOKEN_STRING) {
+                char sBuf[256]; copyLexeme(sBuf, sizeof(sBuf), currentToken);
+                cLine("cn_set_text(&%s, %s);", cVariable(varName, 1), cQuote(sBuf, (int)strlen(sBuf))); advance();
+            } else {
+                char *value = genExpression(); cLine("cn_store(&%s, %s);", cVariable(varName, 1), value);
+            }
+        }
+        else if (isLiteral(currentToken)) {
+            advance();
+        }
+        else if (currentToken.type == TOKEN_EQUAL_TO_OP) {
+             softError("Expected '=' for declaration, found '=='");
+             advance();
+        }
+
+        finish_decl:
+        if (currentToken.type == TOKEN_COMMA) advance(); else break;
+    } while (1);
+    consume(TOKEN_SEMICOLON, "Expected ';'");
+}
+
+/* Every branch runs, as in ifStatementBody(); the conditions are parsed and dropped */
+void genIfStatement() {
+    if (!enterNesting()) { advance(); return; }
+    consume(TOKEN_KW_IF, "if"); consume(TOKEN_L_PAREN, "("); genExpression(); consume(TOKEN_R_PAREN, ")");
+    if (currentToken.type != TOKEN_L_BRACE) {
+        softError("Braces are mandatory"); while (currentToken.type != TOKEN_SEMICOLON && currentToken.type != TOKEN_EOF) advance(); consume(TOKEN_SEMICOLON, ";");
+    } else genBlock(NULL);
+    while (currentToken.type == TOKEN_KW_ELIF) {
+        advance(); consume(TOKEN_L_PAREN, "("); genExpression(); consume(TOKEN_R_PAREN, ")"); genBlock(NULL);
+    }
+    if (currentToken.type == TOKEN_KW_ELSE) {
+        advance();
+        if (currentToken.type == TOKEN_KW_IF) { softError("Use 'elif' instead of 'else if'"); genIfStatement(); }
+        else if (currentToken.type != TOKEN_L_BRACE) { softError("Braces are mandatory"); }
+        else genBlock(NULL);
+    }
+    leaveNesting();
+}
+
+/* captureValue() for one target of an assign block; target is NULL when there is none */
+void genValue(const char *target) {
+    char valBuf[256];
+    if (currentToken.type == TOKEN_STRING) {
+        int len = currentToken.lexeme_length - 2;
+        if (len > (int)sizeof(valBuf) - 3) len = (int)sizeof(valBuf) - 3;
+        valBuf[0] = '"'; memcpy(valBuf + 1, currentToken.lexeme_start + 1, len); valBuf[len + 1] = '"'; valBuf[len + 2] = '\0';
+        advance();
+    } else {
+        char *value = genExpression();
+        if (target) cLine("cn_store(&%s, %s);", cVariable(target, 1), value);
+        return;
+    }
+    if (target) cLine("cn_set_text(&%s, %s);", cVariable(target, 1), cQuote(valBuf, (int)strlen(valBuf)));
+}
+
+/* The values of one branch: "(a, b, ...)" for several targets, else one value for the first */
+void genValues(char targets[][64], int targetCount) {
+    if (currentToken.type == TOKEN_L_PAREN && targetCount > 1) {
+        advance();
+        for (int i = 0; i < targetCount; i++) {
+            genValue(targets[i]);
+            if (i < targetCount - 1) consume(TOKEN_COMMA, ",");
+        }
+        consume(TOKEN_R_PAREN, ")");
+    } else {
+        genValue(targetCount > 0 ? targets[0] : NULL);
+    }
+}
+
+/* The first 'when' whose condition holds assigns, else 'otherwise': an if / else if chain */
+void genAssignmentBlock() {
+    hasCAB = 1; consume(TOKEN_KW_ASSIGN, "assign");
+    consume(TOKEN_L_PAREN, "Expected '('");
+
+    char targets[5][64]; int targetCount = 0;
+    do {
+        if (targetCount < 5 && currentToken.type == TOKEN_IDENTIFIER) {
+            copyLexeme(targets[targetCount], sizeof(targets[targetCount]), currentToken);
+            targetCount++;
+            advance();
+        }
+        if (currentToken.type == TOKEN_COMMA) advance(); else break;
+    } while (1);
+
+    consume(TOKEN_R_PAREN, ")");
+    if (targetCount == 0) { softError("Assign block requires at least one variable"); }
+    consume(TOKEN_L_BRACE, "Expected '{'");
+
+    int branches = 0;
+    while (currentToken.type == TOKEN_RW_WHEN) {
+        advance();
+        char *cond = genExpression();
+
+        if (currentToken.type == TOKEN_L_BRACE) { softError("Used braces instead of colon"); advance(); }
+        else if (currentToken.type != TOKEN_COLON) { softError("Expected ':'"); }
+        else { consume(TOKEN_COLON, ":"); }
+
+        cLine(branches++ ? "else if (%s)" : "if (%s)", cond); cLine("{"); cIndent++;
+        if (currentToken.type == TOKEN_KW_ASSIGN) {
+            /* The interpreter only parses a nested block when its branch is taken */
+            unsupported("nested assign blocks");
+            if (enterNesting()) { genAssignmentBlock(); leaveNesting(); } else advance();
+        } else {
+            genValues(targets, targetCount);
+        }
+        cIndent--; cLine("}");
+        consume(TOKEN_SEMICOLON, "Missing semicolon");
+    }
+
+    if (currentToken.type == TOKEN_RW_OTHERWISE) {
+        advance();
+        if (currentToken.type == TOKEN_ERROR) advance();
+        consume(TOKEN_COLON, "Missing colon");
+        if (branches) cLine("else");
+        cLine("{"); cIndent++;
+        genValues(targets, targetCount);
+        cIndent--; cLine("}");
+        consume(TOKEN_SEMICOLON, "Missing semicolon");
+    } else if (currentToken.type == TOKEN_KW_ELSE) {
+        softError("Used 'else' instead of 'otherwise'");
+        advance(); consume(TOKEN_COLON, ":"); while (currentToken.type != TOKEN_SEMICOLON && currentToken.type != TOKEN_EOF) advance(); consume(TOKEN_SEMICOLON, ";");
+    }
+    consume(TOKEN_R_BRACE, "}");
+}
+
+void genAssignment() {
+    char varName[64]; copyLexeme(varName, sizeof(varName), currentToken);
+
+    if (lookaheadToken.type >= TOKEN_ADD_OP && lookaheadToken.type <= TOKEN_EXPO_OP) {
+        genExpression();
+        consume(TOKEN_SEMICOLON, ";");
+        return;
+    }
+
+    consume(TOKEN_IDENTIFIER, "ID");
+
+    if (currentToken.type >= TOKEN_ASSIGN_OP && currentToken.type <= TOKEN_MOD_ASSIGN_OP) {
+        char op = cOperator(currentToken.type); advance();
+        if (currentToken.type == TOKEN_KW_ASK) { advance(); consume(TOKEN_L_PAREN, "("); if (currentToken.type == TOKEN_IDENTIFIER) advance(); consume(TOKEN_R_PAREN, ")"); }
+        else if (currentToken.type == TOKEN_QUANTUM_POINTER_OP) { softError("Quantum pointer cannot be used as R-value"); advance(); advance(); }
+        else if (op == '=' && typeOf(varName) == TYPE_TEXT && genText(varName)) {}
+        else { char *value = genExpression(); cLine("cn_assign(&%s, '%c', %s);", cVariable(varName, 1), op, value); }
+        consume(TOKEN_SEMICOLON, ";");
+    }
+    else if (currentToken.type == TOKEN_INCREMENT_OP || currentToken.type == TOKEN_DECREMENT_OP) {
+        const char *delta = currentToken.type == TOKEN_INCREMENT_OP ? "1" : "-1"; advance();
+        cLine("cn_step(&%s, %s);", cVariable(varName, 0), delta);
+        consume(TOKEN_SEMICOLON, ";");
+    }
+    else if (currentToken.type == TOKEN_SEMICOLON) { consume(TOKEN_SEMICOLON, ";"); }
+    else {
+        if (strcmp(varName, "integer") == 0) softError("'integer' is likely parsed as IDENTIFIER, leading to syntax error");
+        else if (strcmp(varName, "boolean") == 0) softError("'boolean' must be 'bool'");
+        else if (strcmp(varName, "character") == 0) softError("'character' must be 'char'");
+        else if (strcmp(varName, "Int") == 0) softError("Keywords are lowercase");
+        else if (strcmp(varName, "STRING") == 0) softError("'string' is lowercase in your keyword list");
+        else error("Expected assignment operator");
+
+        while (currentToken.type != TOKEN_SEMICOLON && currentToken.type != TOKEN_EOF) advance();
+        if (currentToken.type == TOKEN_SEMICOLON) advance();
+    }
+}
+
+void genDisplay() {
+    consume(TOKEN_KW_DISPLAY, "display"); consume(TOKEN_L_PAREN, "(");
+    while (1) {
+        if (currentToken.type == TOKEN_RW_EXIT) return;
+
+        if (currentToken.type == TOKEN_IDENTIFIER && currentToken.lexeme_length == 1 && currentToken.lexeme_start[0] == 'f' && lookaheadToken.type == TOKEN_STRING) {
+            advance();
+        }
+
+        if (currentToken.type == TOKEN_STRING) { genInterpolation(currentToken.lexeme_start + 1, currentToken.lexeme_length - 2); advance(); }
+        else if (currentToken.type == TOKEN_IDENTIFIER && (lookaheadToken.type == TOKEN_COMMA || lookaheadToken.type == TOKEN_R_PAREN)) {
+            char varName[64]; copyLexeme(varName, sizeof(varName), currentToken);
+            cLine("cn_display_var(&%s);", cVariable(varName, 0));
+            advance();
+        }
+        else { char *value = genExpression(); cLine("cn_display(%s);", value); }
+        if (currentToken.type == TOKEN_COMMA) advance(); else break;
+    }
+    cLine("cn_newline();"); consume(TOKEN_R_PAREN, ")"); consume(TOKEN_SEMICOLON, ";");
+}
+
+/* Expressions become C float expressions; comparisons and logic yield 0.0f or 1.0f like the interpreter */
+char *genExpression() {
+    if (!enterNesting()) { advance(); return "0.0f"; }
+    char *v = genLogicOr(); leaveNesting(); return v;
+}
+
+char *genLogicOr() {
+    char *l = genLogicAnd();
+    while (currentToken.type == TOKEN_LOGICAL_OR_OP) { advance(); char *r = genLogicAnd(); l = cFormat("(float)(%s || %s)", l, r); }
+    return l;
+}
+
+char *genLogicAnd() {
+    char *l = genEquality();
+    while (currentToken.type == TOKEN_LOGICAL_AND_OP) { advance(); char *r = genEquality(); l = cFormat("(float)(%s && %s)", l, r); }
+    return l;
+}
+
+char *genEquality() {
+    char *l = genRelational();
+    while (currentToken.type == TOKEN_EQUAL_TO_OP || currentToken.type == TOKEN_NOT_EQUAL_TO_OP) {
+        const char *op = currentToken.type == TOKEN_EQUAL_TO_OP ? "==" : "!="; advance(); char *r = genRelational();
+        l = cFormat("(float)(%s %s %s)", l, op, r);
+    }
+    return l;
+}
+
+char *genRelational() {
+    char *l = genSimpleExpression();
+    while (currentToken.type >= TOKEN_GREATER_OP && currentToken.type <= TOKEN_LESS_EQUAL_OP) {
+        TokenType type = currentToken.type; advance(); char *r = genSimpleExpression();
+        const char *op = type == TOKEN_GREATER_OP ? ">" : type == TOKEN_GREATER_EQUAL_OP ? ">=" : type == TOKEN_LESS_OP ? "<" : "<=";
+        l = cFormat("(float)(%s %s %s)", l, op, r);
+    }
+    return l;
+}
+
+char *genSimpleExpression() { char *l = genTerm(); while (currentToken.type == TOKEN_ADD_OP || currentToken.type == TOKEN_SUB_OP) { char op = currentToken.type == TOKEN_ADD_OP ? '+' : '-'; advance(); char *r = genTerm(); l = cFormat("(%s %c %s)", l, op, r); } return l; }
+char *genTerm() { char *l = genFactor(); while (currentToken.type == TOKEN_MULT_OP || currentToken.type == TOKEN_DIV_OP) { int mult = currentToken.type == TOKEN_MULT_OP; advance(); char *r = genFactor(); l = mult ? cFormat("(%s * %s)", l, r) : cFormat("cn_div(%s, %s)", l, r); } return l; }
+
+char *genFactor() {
+    char *val = "0.0f";
+    while (currentToken.type == TOKEN_MULT_OP || currentToken.type == TOKEN_POINTER_OP) advance(); /* dereference is a no-op */
+    if (currentToken.type == TOKEN_RW_AUTO_REF) {
+        hasAutoRef = 1; advance(); consume(TOKEN_L_PAREN, "("); if (isType(currentToken) || currentToken.type == TOKEN_IDENTIFIER) advance(); consume(TOKEN_COMMA, ",");
+        if (currentToken.type == TOKEN_L_BRACKET) { while (currentToken.type != TOKEN_R_BRACKET && currentToken.type != TOKEN_EOF) advance(); advance(); }
+        else { val = genExpression(); }
+        consume(TOKEN_R_PAREN, ")"); return val;
+    }
+    if (currentToken.type == TOKEN_NUMBER_INT || currentToken.type == TOKEN_NUMBER_FLOAT) { val = cFloat((float)atof(currentToken.lexeme_start)); advance(); }
+    else if (currentToken.type == TOKEN_KW_TRUE) { val = "1.0f"; advance(); }
+    else if (currentToken.type == TOKEN_KW_FALSE) { advance(); }
+    else if (currentToken.type == TOKEN_IDENTIFIER) {
+        char name[64]; copyLexeme(name, sizeof(name), currentToken);
+        advance();
+        if (currentToken.type == TOKEN_L_BRACKET) { advance(); char *idx = genExpression(); val = cFormat("cn_index(&%s, (int)%s)", cVariable(name, 0), idx); consume(TOKEN_R_BRACKET, "]"); }
+        else if (currentToken.type == TOKEN_ARROW_OP) { advance(); consume(TOKEN_IDENTIFIER, "Field"); }
+        else { val = cFormat("cn_num(&%s)", cVariable(name, 0)); }
+    } else if (currentToken.type == TOKEN_STRING) { advance(); }
+    else if (currentToken.type == TOKEN_TYPE_CHAR) { advance(); }
+    else if (currentToken.type == TOKEN_L_PAREN) { advance(); val = genExpression(); consume(TOKEN_R_PAREN, ")"); }
+    else if (currentToken.type == TOKEN_R_BRACE || currentToken.type == TOKEN_RW_OTHERWISE || currentToken.type == TOKEN_SEMICOLON) { return val; }
+    else if (currentToken.type == TOKEN_GREATER_OP) {
+        customError("Invalid operator '>>'");
+        advance();
+        if (currentToken.type == TOKEN_NUMBER_INT || currentToken.type == TOKEN_IDENTIFIER) advance();
+        return val;
+    }
+    else { softError("Invalid expression factor"); advance(); }
+    return val;
+}
+
+/* --emit-c: print the C translation of a program, or its diagnostics on stderr; returns 1 on success */
+int emitProgramC(const char *input) {
+    resetParserState(); resetDiagnostics(input); cIndent = 1;
+    checkTypes(input);
+    initScanner(input); lookaheadToken = fetchToken(); advance();
+
+    if (currentToken.type != TOKEN_RW_EXECUTE && currentToken.type != TOKEN_KW_STRUCT && currentToken.type != TOKEN_EOF) {
+        report(DIAG_BEFORE_PROGRAM, currentToken, currentToken.line, "Unexpected content before program start");
+    } else {
+        genProgram();
+        if (success && currentToken.type != TOKEN_EOF) {
+            report(DIAG_AFTER_PROGRAM, currentToken, currentToken.line, "Unexpected content after program end");
+        }
+    }
+    int defined = 0;
+    for (int i = 0; i < cVariableCount; i++) defined += cVariables[i].defined;
+    if (defined > MAX_SYMBOLS) unsupported("more than 100 variables");
+
+    if (success) {
+        printf("/* Generated by `parser --emit-c`. Build: gcc -O2 -ffp-contract=off program.c -o program -lm */\n");
+        printf("/* Prints what the interpreter shows under [PROGRAM OUTPUT]. As there, every if/elif/else branch runs. */\n\n");
+        for (size_t i = 0; i < sizeof(cRuntime) / sizeof(cRuntime[0]); i++) printf("%s\n", cRuntime[i]);
+        printf("\n");
+        for (int i = 0; i < cVariableCount; i++) printf("static CnValue v_%s;\n", cVariables[i].name);
+        printf("\nint main(void)\n{\n");
+        fwrite(cCode.data, 1, cCode.length, stdout);
+        printf("    return 0;\n}\n");
+    } else {
+        OutputBuffer lines = {0};
+        renderDiagnosticLines(&lines, 0, diagnostics.count); renderOmitted(&lines);
+        if (lines.length > 0) fwrite(lines.data, 1, lines.length, stderr);
+        fprintf(stderr, "Error: --emit-c needs a program that parses without errors\n");
+        free(lines.data);
+    }
+    free(cCode.data); memset(&cCode, 0, sizeof(cCode));
+    free(cVariables); cVariables = NULL; cVariableCount = cVariableCapacity = 0;
+    arenaReset(&parseArena);
+    return success;
+}
+
+/* ========================================================================= */
+/* 7. LOOP JIT (x86-64 Linux)                                                */
+/* ========================================================================= */
+
+/*
+ * Once a while, do-while or for loop has run JIT_HOT_ITERATIONS iterations, its body, update and
+ * condition are compiled into one x86-64 function that runs a whole iteration and returns the next
+ * condition. The code is pasted together from fixed instruction templates in a buffer that is
+ * mapped writable and then made executable. The compiler is another recursive descent over the
+ * loop's tokens, like section 6, but it only covers numeric statements: declarations and
+ * assignments of expressions, ++/--, expression statements, pointer writes and if/elif/else (every
+ * branch runs). Any other statement keeps the whole loop in the interpreter; a nested loop is
+ * compiled on its own once it gets hot.
+ *
+ * While compiled code runs, every variable of the loop lives in a JitSlot holding the float that
+ * atof() would read from its symbol text. Expressions are SSE scalar instructions applied in the
+ * interpreter's order, stores call jitAssign()/jitStore(), which round like the "%.0f"/"%.1f" texts
+ * of section 3, and the slots are written back to the symbol table when the run ends. A run stops
+ * before an iteration that would not fit in the step budget, so the budget error is still reported
+ * by the interpreter at the same statement. --no-jit keeps every loop in the interpreter.
+ */
+#ifdef CNACK_JIT
+
+#define JIT_MAX_SLOTS 32
+enum { JIT_UNCHANGED, JIT_WHOLE, JIT_DECIMAL };
+
+/* 64 bytes, so slot i is at [rbx + 64 * i]; text holds the "%.1f" text of a JIT_DECIMAL value */
+typedef struct { float value; int kind; char text[56]; } JitSlot;
+
+struct JitLoop {
+    const char *key;                  /* First token of the condition */
+    float (*iterate)(JitSlot *slots); /* NULL when the loop stays interpreted */
+    void *code; size_t codeSize;
+    long steps;                       /* Execution steps per iteration */
+    int slotCount;
+    char names[JIT_MAX_SLOTS][MAX_VAR_LEN];
+    unsigned char written[JIT_MAX_SLOTS];
+    JitLoop *next;
+};
+
+_Thread_local JitLoop *jitLoops = NULL; /* Every loop tried in this parse, compiled or not */
+_Thread_local struct { unsigned char *code; size_t length, capacity; int failed, depth; JitLoop *loop; } jitCompiler;
+
+/* --- Runtime helpers called from compiled code --- */
+
+float jitApply(float cv, float val, int op) {
+    if (op == TOKEN_ADD_ASSIGN_OP) cv += val; else if (op == TOKEN_SUB_ASSIGN_OP) cv -= val;
+    else if (op == TOKEN_MULT_ASSIGN_OP) cv *= val; else if (op == TOKEN_DIV_ASSIGN_OP && val != 0) cv /= val;
+    else if (op == TOKEN_ASSIGN_OP) cv = val;
+    return cv;
+}
+
+/* Assignment, ++ and --: the interpreter stores "%.0f", which reads back as rint() */
+void jitAssign(JitSlot *slot, float val, int op) { slot->value = (float)rint(jitApply(slot->value, val, op)); slot->kind = JIT_WHOLE; }
+
+/* Declaration and for-loop update: "%.0f" for a whole value, else "%.1f" */
+void jitStore(JitSlot *slot, float val, int op) {
+    float cv = jitApply(slot->value, val, op);
+    if (floorf(cv) == cv) { slot->value = cv; slot->kind = JIT_WHOLE; return; }
+    snprintf(slot->text, sizeof(slot->text), "%.1f", cv); slot->value = (float)atof(slot->text); slot->kind = JIT_DECIMAL;
+}
+
+/* --- Instruction templates; the value being computed is in xmm0 --- */
+
+void jitEmit(const unsigned char *bytes, size_t count) {
+    if (jitCompiler.length + count > jitCompiler.capacity) {
+        size_t cap = (jitCompiler.length + count) * 2 + 256; unsigned char *grown = (unsigned char *)realloc(jitCompiler.code, cap);
+        if (!grown) { jitCompiler.failed = 1; return; }
+        jitCompiler.code = grown; jitCompiler.capacity = cap;
+    }
+    memcpy(jitCompiler.code + jitCompiler.length, bytes, count); jitCompiler.length += count;
+}
+#define JIT_CODE(...) do { static const unsigned char code_[] = { __VA_ARGS__ }; jitEmit(code_, sizeof(code_)); } while (0)
+void jitEmit32(unsigned int v) { unsigned char b[4] = { v & 0xFF, (v >> 8) & 0xFF, (v >> 16) & 0xFF, v >> 24 }; jitEmit(b, 4); }
+
+void jitConstant(float f) { unsigned int bits; memcpy(&bits, &f, 4); JIT_CODE(0xB8); jitEmit32(bits); JIT_CODE(0x66, 0x0F, 0x6E, 0xC0); } /* mov eax, f; movd xmm0, eax */
+void jitLoad(int slot) { JIT_CODE(0xF3, 0x0F, 0x10, 0x83); jitEmit32(slot * sizeof(JitSlot)); }           /* movss xmm0, [rbx + slot] */
+void jitPush() { JIT_CODE(0x48, 0x83, 0xEC, 0x10, 0xF3, 0x0F, 0x11, 0x04, 0x24); }                         /* sub rsp, 16; movss [rsp], xmm0 */
+void jitPop() { JIT_CODE(0x0F, 0x28, 0xC8, 0xF3, 0x0F, 0x10, 0x04, 0x24, 0x48, 0x83, 0xC4, 0x10); }        /* movaps xmm1, xmm0; movss xmm0, [rsp]; add rsp, 16 */
+
+/* xmm0 = xmm0 op xmm1, with the results of section 3's float arithmetic */
+void jitOperator(TokenType op) {
+    switch (op) {
+    case TOKEN_ADD_OP: JIT_CODE(0xF3, 0x0F, 0x58, 0xC1); return;  /* addss xmm0, xmm1 */
+    case TOKEN_SUB_OP: JIT_CODE(0xF3, 0x0F, 0x5C, 0xC1); return;  /* subss */
+    case TOKEN_MULT_OP: JIT_CODE(0xF3, 0x0F, 0x59, 0xC1); return; /* mulss */
+    case TOKEN_DIV_OP: /* xorps xmm2, xmm2; ucomiss xmm1, xmm2; jp div; je skip; div: divss xmm0, xmm1; skip: */
+        JIT_CODE(0x0F, 0x57, 0xD2, 0x0F, 0x2E, 0xCA, 0x7A, 0x02, 0x74, 0x04, 0xF3, 0x0F, 0x5E, 0xC1); return;
+    case TOKEN_EQUAL_TO_OP: JIT_CODE(0xF3, 0x0F, 0xC2, 0xC1, 0x00); break;       /* cmpeqss xmm0, xmm1 */
+    case TOKEN_NOT_EQUAL_TO_OP: JIT_CODE(0xF3, 0x0F, 0xC2, 0xC1, 0x04); break;   /* cmpneqss */
+    case TOKEN_LESS_OP: JIT_CODE(0xF3, 0x0F, 0xC2, 0xC1, 0x01); break;           /* cmpltss */
+    case TOKEN_LESS_EQUAL_OP: JIT_CODE(0xF3, 0x0F, 0xC2, 0xC1, 0x02); break;     /* cmpless */
+    case TOKEN_GREATER_OP: JIT_CODE(0xF3, 0x0F, 0xC2, 0xC8, 0x01, 0x0F, 0x28, 0xC1); break;       /* cmpltss xmm1, xmm0; movaps xmm0, xmm1 */
+    case TOKEN_GREATER_EQUAL_OP: JIT_CODE(0xF3, 0x0F, 0xC2, 0xC8, 0x02, 0x0F, 0x28, 0xC1); break; /* cmpless xmm1, xmm0; movaps xmm0, xmm1 */
+    default: /* && and ||: xorps xmm2, xmm2; cmpneqss xmm0, xmm2; cmpneqss xmm1, xmm2; andps/orps xmm0, xmm1 */
+        JIT_CODE(0x0F, 0x57, 0xD2, 0xF3, 0x0F, 0xC2, 0xC2, 0x04, 0xF3, 0x0F, 0xC2, 0xCA, 0x04);
+        if (op == TOKEN_LOGICAL_AND_OP) JIT_CODE(0x0F, 0x54, 0xC1); else JIT_CODE(0x0F, 0x56, 0xC1);
+    }
+    JIT_CODE(0xB8, 0x00, 0x00, 0x80, 0x3F, 0x66, 0x0F, 0x6E, 0xD0, 0x0F, 0x54, 0xC2); /* mask to 1.0f: mov eax, 1.0f; movd xmm2, eax; andps xmm0, xmm2 */
+}
+
+/* helper(&slots[slot], xmm0, op); rbx is callee-saved and rsp is 16-byte aligned between statements */
+void jitCall(void (*helper)(JitSlot *, float, int), int slot, int op) {
+    unsigned long long address = (unsigned long long)(size_t)helper;
+    JIT_CODE(0x48, 0x8D, 0xBB); jitEmit32(slot * sizeof(JitSlot));                             /* lea rdi, [rbx + slot] */
+    JIT_CODE(0xBE); jitEmit32((unsigned int)op);                                                /* mov esi, op */
+    JIT_CODE(0x48, 0xB8); jitEmit32((unsigned int)address); jitEmit32((unsigned int)(address >> 32)); /* mov rax, helper */
+    JIT_CODE(0xFF, 0xD0);                                                                       /* call rax */
+}
+
+/* --- Compiler: consumes tokens like section 3; anything it does not cover sets failed --- */
+
+void jitAdvance() {
+    currentToken = lookaheadToken; lookaheadToken = fetchToken();
+    if (currentToken.type == TOKEN_ERROR) { jitCompiler.failed = 1; currentToken = lookaheadToken; lookaheadToken = fetchToken(); }
+    while (currentToken.type == TOKEN_SINGLE_COMMENT || currentToken.type == TOKEN_MULTI_COMMENT) { currentToken = lookaheadToken; lookaheadToken = fetchToken(); }
+}
+void jitExpect(TokenType type) { if (currentToken.type == type) jitAdvance(); else jitCompiler.failed = 1; }
+void jitSeek(TokenMark mark) { scanner = mark.scanner; currentToken = mark.current; lookaheadToken = mark.lookahead; }
+
+int jitSlot(Token name, int write) {
+    JitLoop *loop = jitCompiler.loop; char text[MAX_VAR_LEN]; copyLexeme(text, sizeof(text), name);
+    if (typeOf(text) != TYPE_NUMBER && typeOf(text) != TYPE_UNKNOWN) { jitCompiler.failed = 1; return 0; } /* strings stay interpreted */
+    for (int i = 0; i < loop->slotCount; i++) if (strcmp(loop->names[i], text) == 0) { loop->written[i] |= write; return i; }
+    if (loop->slotCount == JIT_MAX_SLOTS) { jitCompiler.failed = 1; return 0; }
+    strcpy(loop->names[loop->slotCount], text); loop->written[loop->slotCount] = write;
+    return loop->slotCount++;
+}
+
+void jitExpression(); void jitLogicOr(); void jitLogicAnd(); void jitEquality(); void jitRelational(); void jitSimpleExpression(); void jitTerm(); void jitFactor();
+void jitStatementList();
+
+void jitBinary(void (*operand)(), TokenType op) { jitAdvance(); jitPush(); operand(); jitPop(); jitOperator(op); }
+
+/* An expression whose value is not used: its tokens are consumed, its code dropped */
+void jitDiscard() { size_t mark = jitCompiler.length; jitExpression(); jitCompiler.length = mark; }
+
+void jitExpression() {
+    if (jitCompiler.failed || jitCompiler.depth >= MAX_NESTING) { jitCompiler.failed = 1; return; }
+    jitCompiler.depth++; jitLogicOr(); jitCompiler.depth--;
+}
+void jitLogicOr() { jitLogicAnd(); while (!jitCompiler.failed && currentToken.type == TOKEN_LOGICAL_OR_OP) jitBinary(jitLogicAnd, TOKEN_LOGICAL_OR_OP); }
+void jitLogicAnd() { jitEquality(); while (!jitCompiler.failed && currentToken.type == TOKEN_LOGICAL_AND_OP) jitBinary(jitEquality, TOKEN_LOGICAL_AND_OP); }
+void jitEquality() { jitRelational(); while (!jitCompiler.failed && (currentToken.type == TOKEN_EQUAL_TO_OP || currentToken.type == TOKEN_NOT_EQUAL_TO_OP)) jitBinary(jitRelational, currentToken.type); }
+void jitRelational() { jitSimpleExpression(); while (!jitCompiler.failed && currentToken.type >= TOKEN_GREATER_OP && currentToken.type <= TOKEN_LESS_EQUAL_OP) jitBinary(jitSimpleExpression, currentToken.type); }
+void jitSimpleExpression() { jitTerm(); while (!jitCompiler.failed && (currentToken.type == TOKEN_ADD_OP || currentToken.type == TOKEN_SUB_OP)) jitBinary(jitTerm, currentToken.type); }
+void jitTerm() { jitFactor(); while (!jitCompiler.failed && (currentToken.type == TOKEN_MULT_OP || currentToken.type == TOKEN_DIV_OP)) jitBinary(jitFactor, currentToken.type); }
+
+void jitFactor() {
+    while (currentToken.type == TOKEN_MULT_OP || currentToken.type == TOKEN_POINTER_OP) jitAdvance();
+    TokenType type = currentToken.type;
+    if (type == TOKEN_RW_AUTO_REF) {
+        jitAdvance(); jitExpect(TOKEN_L_PAREN); if (isType(currentToken) || currentToken.type == TOKEN_IDENTIFIER) jitAdvance(); jitExpect(TOKEN_COMMA);
+        if (currentToken.type == TOKEN_L_BRACKET) { while (currentToken.type != TOKEN_R_BRACKET && currentToken.type != TOKEN_EOF) jitAdvance(); jitAdvance(); jitConstant(0); }
+        else jitExpression();
+        jitExpect(TOKEN_R_PAREN);
+    }
+    else if (type == TOKEN_NUMBER_INT || type == TOKEN_NUMBER_FLOAT) { jitConstant(atof(currentToken.lexeme_start)); jitAdvance(); }
+    else if (type == TOKEN_KW_TRUE || type == TOKEN_KW_FALSE) { jitConstant(type == TOKEN_KW_TRUE); jitAdvance(); }
+    else if (type == TOKEN_IDENTIFIER) {
+        Token name = currentToken; jitAdvance();
+        if (currentToken.type == TOKEN_L_BRACKET) jitCompiler.failed = 1; /* array elements are text */
+        else if (currentToken.type == TOKEN_ARROW_OP) { jitAdvance(); jitExpect(TOKEN_IDENTIFIER); jitConstant(0); }
+        else jitLoad(jitSlot(name, 0));
+    }
+    else if (type == TOKEN_STRING || type == TOKEN_TYPE_CHAR) { jitAdvance(); jitConstant(0); }
+    else if (type == TOKEN_L_PAREN) { jitAdvance(); jitExpression(); jitExpect(TOKEN_R_PAREN); }
+    else if (type == TOKEN_R_BRACE || type == TOKEN_RW_OTHERWISE || type == TOKEN_SEMICOLON) jitConstant(0);
+    else jitCompiler.failed = 1;
+}
+
+void jitDeclaration() {
+    if (currentToken.type == TOKEN_TYPE_STRING) { jitCompiler.failed = 1; return; }
+    jitAdvance();
+    if (currentToken.type == TOKEN_MULT_OP || currentToken.type == TOKEN_POINTER_OP) jitAdvance();
+    if (currentToken.type == TOKEN_QUANTUM_POINTER_OP) { jitCompiler.failed = 1; return; }
+    while (!jitCompiler.failed) {
+        if (currentToken.type != TOKEN_IDENTIFIER) { jitCompiler.failed = 1; return; }
+        Token name = currentToken; jitAdvance();
+        if (currentToken.type == TOKEN_ASSIGN_OP) {
+            jitAdvance();
+            if (currentToken.type == TOKEN_RW_AUTO_REF) {
+                jitAdvance(); jitExpect(TOKEN_L_PAREN); if (isType(currentToken) || currentToken.type == TOKEN_IDENTIFIER) jitAdvance(); jitExpect(TOKEN_COMMA);
+                if (currentToken.type == TOKEN_L_BRACKET || currentToken.type == TOKEN_L_BRACE) { jitCompiler.failed = 1; return; }
+                jitExpression(); jitCall(jitStore, jitSlot(name, 1), TOKEN_ASSIGN_OP); jitExpect(TOKEN_R_PAREN);
+            }
+            else if (currentToken.type == TOKEN_STRING) { jitCompiler.failed = 1; return; }
+            else { jitExpression(); jitCall(jitStore, jitSlot(name, 1), TOKEN_ASSIGN_OP); }
+        }
+        else if (isLiteral(currentToken)) jitAdvance();
+        else if (currentToken.type == TOKEN_EQUAL_TO_OP) jitCompiler.failed = 1;
+        if (currentToken.type == TOKEN_COMMA) jitAdvance(); else break;
+    }
+    jitExpect(TOKEN_SEMICOLON);
+}
+
+void jitAssignment() {
+    Token name = currentToken; jitAdvance();
+    TokenType op = currentToken.type;
+    if (op >= TOKEN_ASSIGN_OP && op <= TOKEN_MOD_ASSIGN_OP) {
+        jitAdvance();
+        if (currentToken.type == TOKEN_KW_ASK) { jitAdvance(); jitExpect(TOKEN_L_PAREN); if (currentToken.type == TOKEN_IDENTIFIER) jitAdvance(); jitExpect(TOKEN_R_PAREN); }
+        else if (currentToken.type == TOKEN_QUANTUM_POINTER_OP) jitCompiler.failed = 1;
+        else { jitExpression(); jitCall(jitAssign, jitSlot(name, 1), op); }
+    }
+    else if (op == TOKEN_INCREMENT_OP || op == TOKEN_DECREMENT_OP) { jitAdvance(); jitConstant(op == TOKEN_INCREMENT_OP ? 1 : -1); jitCall(jitAssign, jitSlot(name, 1), TOKEN_ADD_ASSIGN_OP); }
+    else if (op != TOKEN_SEMICOLON) jitCompiler.failed = 1;
+    jitExpect(TOKEN_SEMICOLON);
+}
+
+void jitBlock() { if (currentToken.type != TOKEN_L_BRACE) { jitCompiler.failed = 1; return; } jitAdvance(); jitStatementList(); jitExpect(TOKEN_R_BRACE); }
+
+void jitIfStatement() {
+    jitAdvance(); jitExpect(TOKEN_L_PAREN); jitDiscard(); jitExpect(TOKEN_R_PAREN); jitBlock();
+    while (!jitCompiler.failed && currentToken.type == TOKEN_KW_ELIF) { jitAdvance(); jitExpect(TOKEN_L_PAREN); jitDiscard(); jitExpect(TOKEN_R_PAREN); jitBlock(); }
+    if (currentToken.type == TOKEN_KW_ELSE) { jitAdvance(); jitBlock(); }
+}
+
+void jitStatement() {
+    if (jitCompiler.depth >= MAX_NESTING) { jitCompiler.failed = 1; return; }
+    jitCompiler.loop->steps++; jitCompiler.depth++;
+    if (isType(currentToken)) jitDeclaration();
+    else if (currentToken.type == TOKEN_IDENTIFIER) {
+        if (strncmp(currentToken.lexeme_start, "print", 5) == 0 || strncmp(currentToken.lexeme_start, "cout", 4) == 0 || strncmp(currentToken.lexeme_start, "input", 5) == 0) jitCompiler.failed = 1;
+        else if (lookaheadToken.type >= TOKEN_ADD_OP && lookaheadToken.type <= TOKEN_EXPO_OP) { jitDiscard(); jitExpect(TOKEN_SEMICOLON); }
+        else jitAssignment();
+    }
+    else if (currentToken.type == TOKEN_KW_IF) jitIfStatement();
+    else if (currentToken.type == TOKEN_QUANTUM_POINTER_OP || currentToken.type == TOKEN_MULT_OP) { jitAdvance(); jitExpect(TOKEN_IDENTIFIER); jitAdvance(); jitDiscard(); jitExpect(TOKEN_SEMICOLON); }
+    else jitCompiler.failed = 1; /* display, assign blocks, loops, fn */
+    jitCompiler.depth--;
+}
+
+void jitStatementList() {
+    while (!jitCompiler.failed && currentToken.type != TOKEN_RW_EXIT && currentToken.type != TOKEN_R_BRACE && currentToken.type != TOKEN_EOF) jitStatement();
+}
+
+/* The update of a for loop: only "name++", "name--" and "name op= expression" do something */
+void jitForUpdate() {
+    if (currentToken.type != TOKEN_IDENTIFIER) return;
+    Token name = currentToken; jitAdvance();
+    TokenType op = currentToken.type;
+    if (op == TOKEN_INCREMENT_OP || op == TOKEN_DECREMENT_OP) { jitConstant(op == TOKEN_INCREMENT_OP ? 1 : -1); jitCall(jitAssign, jitSlot(name, 1), TOKEN_ADD_ASSIGN_OP); }
+    else if (op >= TOKEN_ASSIGN_OP && op <= TOKEN_MOD_ASSIGN_OP) { jitAdvance(); jitExpression(); jitCall(jitStore, jitSlot(name, 1), op); }
+}
+
+/* --- Loops --- */
+
+/* The compiled form of a hot loop, or NULL if it has to stay interpreted; compiled once per parse */
+JitLoop *jitLoop(TokenMark cond, TokenMark body, const TokenMark *update) {
+    for (JitLoop *loop = jitLoops; loop; loop = loop->next) if (loop->key == cond.current.lexeme_start) return loop->iterate ? loop : NULL;
+    JitLoop *loop = (JitLoop *)calloc(1, sizeof(JitLoop)); if (!loop) return NULL;
+    loop->key = cond.current.lexeme_start; loop->steps = 1; loop->next = jitLoops; jitLoops = loop;
+
+    TokenMark saved = { scanner, currentToken, lookaheadToken };
+    jitCompiler.loop = loop; jitCompiler.length = 0; jitCompiler.failed = 0; jitCompiler.depth = 0;
+    JIT_CODE(0x53, 0x48, 0x89, 0xFB); /* push rbx; mov rbx, rdi (the slots) */
+    jitSeek(body); jitStatementList(); jitExpect(TOKEN_R_BRACE);
+    if (update) { jitSeek(*update); jitForUpdate(); }
+    jitSeek(cond); jitExpression();
+    JIT_CODE(0x5B, 0xC3);             /* pop rbx; ret */
+    jitSeek(saved);
+    if (jitCompiler.failed) return NULL;
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE), size = (jitCompiler.length + page - 1) / page * page;
+    void *code = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) return NULL;
+    memcpy(code, jitCompiler.code, jitCompiler.length);
+    if (mprotect(code, size, PROT_READ | PROT_EXEC) != 0) { munmap(code, size); return NULL; }
+    loop->code = code; loop->codeSize = size; memcpy(&loop->iterate, &code, sizeof(code));
+    return loop;
+}
+
+/* Run whole iterations of a compiled loop whose condition holds and return the condition after them.
+   When none can run (budget, deadline, a variable the interpreter would create), *loop is cleared. */
+float jitIterate(JitLoop **loop, float cond) {
+    JitLoop *compiled = *loop; JitSlot slots[JIT_MAX_SLOTS];
+    long room = maxSteps > 0 ? (maxSteps - stepCount) / compiled->steps : 0;
+    if (!success || budgetExceeded || (maxSteps > 0 && room <= 0) || (deadline > 0 && nowSeconds() > deadline)) { *loop = NULL; return cond; }
+    for (int i = 0; i < compiled->slotCount; i++) {
+        Symbol *sym = getSymbol(compiled->names[i]);
+        if (!sym && compiled->written[i]) { *loop = NULL; return cond; }
+        slots[i].value = sym ? (float)atof(sym->value) : 0; slots[i].kind = JIT_UNCHANGED;
+    }
+
+    long done = 0;
+    while (cond && (maxSteps <= 0 || done < room)) {
+        cond = compiled->iterate(slots); done++;
+        if (deadline > 0 && (done & 4095) == 0 && nowSeconds() > deadline) break;
+    }
+    stepCount += done * compiled->steps;
+
+    for (int i = 0; i < compiled->slotCount; i++) {
+        char text[64];
+        if (slots[i].kind == JIT_WHOLE) { snprintf(text, sizeof(text), "%.0f", slots[i].value); setSymbol(compiled->names[i], text); }
+        else if (slots[i].kind == JIT_DECIMAL) setSymbol(compiled->names[i], slots[i].text);
+    }
+    return cond;
+}
+
+void jitReset() {
+    while (jitLoops) { JitLoop *next = jitLoops->next; if (jitLoops->code) munmap(jitLoops->code, jitLoops->codeSize); free(jitLoops); jitLoops = next; }
+    free(jitCompiler.code); memset(&jitCompiler, 0, sizeof(jitCompiler));
+}
+
+#else /* other platforms: every loop is interpreted */
+JitLoop *jitLoop(TokenMark cond, TokenMark body, const TokenMark *update) { (void)cond; (void)body; (void)update; return NULL; }
+float jitIterate(JitLoop **loop, float cond) { *loop = NULL; return cond; }
+void jitReset() {}
+#endif
+
+/* ========================================================================= */
+/* 8. TYPE CHECKING                                                          */
+/* ========================================================================= */
+
+/*
+ * Before a program runs, checkTypes() gives each variable one static type: a number (int, float and
+ * bool variables, and anything an expression stores), a string (a quoted literal, so char
+ * variables are strings too), an array or struct (auto_ref), or a quantum pointer. Like sections 6
+ * and 7 it is a silent recursive descent over the program; syntax errors are left to the parser.
+ * The first pass records what each declaration and assignment stores, so a name used before its
+ * declaration is still known; the second reports a name that gets a second type, a string used as
+ * a number and an index into a non-array. [Type Error] lines come before the parse and, as any
+ * error, stop loops and hide the program output. The interpreter asks typeOf() instead of looking
+ * at the first character of a value.
+ */
+
+typedef struct { char name[MAX_VAR_LEN]; ValueType type; Token definition; } TypedName; /* definition: where it got its type */
+typedef struct { ValueType type; Token token; } Operand; /* token names the literal or variable in messages */
+
+_Thread_local TypedName *typeTable = NULL;
+_Thread_local int typeCount = 0, typeCapacity = 0;
+_Thread_local struct { int reporting, depth, seenQPA; } typeChecker;
+
+const char *typeNames[] = { "unknown", "a number", "a string", "an array", "a struct", "a quantum pointer" };
+
+TypedName *typedName(const char *name) {
+    for (int i = 0; i < typeCount; i++) if (strcmp(typeTable[i].name, name) == 0) return &typeTable[i];
+    return NULL;
+}
+
+ValueType typeOf(const char *name) { TypedName *t = typedName(name); return t ? t->type : TYPE_UNKNOWN; }
+
+void typeReset() { free(typeTable); typeTable = NULL; typeCount = typeCapacity = 0; }
+
+void typeError(DiagnosticCode code, Token at, int line, const char *format, ...) {
+    if (!typeChecker.reporting) return;
+    char message[256]; va_list args; va_start(args, format); vsnprintf(message, sizeof(message), format, args); va_end(args);
+    report(code, at, line, "%s", message);
+}
+
+/* A name keeps the first type it is given; a conflict is reported at line */
+void defineType(Token name, ValueType type, int line) {
+    char text[MAX_VAR_LEN]; copyLexeme(text, sizeof(text), name);
+    if (type == TYPE_UNKNOWN) return;
+    TypedName *t = typedName(text);
+    if (t) {
+        if (t->type != type) typeError(DIAG_TYPE_CONFLICT, name, line, "'%s' is %s (line %d), not %s", text, typeNames[t->type], t->definition.line, typeNames[type]);
+        return;
+    }
+    if (typeCount == typeCapacity) {
+        int cap = typeCapacity ? typeCapacity * 2 : 64; TypedName *grown = (TypedName *)realloc(typeTable, cap * sizeof(TypedName));
+        if (!grown) return;
+        typeTable = grown; typeCapacity = cap;
+    }
+    strcpy(typeTable[typeCount].name, text); typeTable[typeCount].type = type; typeTable[typeCount++].definition = name;
+}
+
+void requireNumber(Operand operand) {
+    if (operand.type == TYPE_NUMBER || operand.type == TYPE_UNKNOWN) return;
+    Token t = operand.token;
+    if (t.type == TOKEN_STRING) typeError(DIAG_NOT_A_NUMBER, t, t.line, "Expected a number, found string literal %.*s", t.lexeme_length, t.lexeme_start);
+    else typeError(DIAG_NOT_A_NUMBER, t, t.line, "'%.*s' is %s, not a number", t.lexeme_length, t.lexeme_start, typeNames[operand.type]);
+}
+
+/* --- Tokens: comments and error tokens are skipped; the checker's lexing is not in --stats --- */
+
+void typeAdvance() {
+    currentToken = lookaheadToken; lookaheadToken = getNextToken();
+    while (currentToken.type == TOKEN_ERROR || currentToken.type == TOKEN_SINGLE_COMMENT || currentToken.type == TOKEN_MULTI_COMMENT) { currentToken = lookaheadToken; lookaheadToken = getNextToken(); }
+}
+int typeAccept(TokenType type) { if (currentToken.type != type) return 0; typeAdvance(); return 1; }
+/* To the end of the statement, as the parser's panic mode */
+void typeSkip() { while (currentToken.type != TOKEN_SEMICOLON && currentToken.type != TOKEN_R_BRACE && currentToken.type != TOKEN_EOF) typeAdvance(); typeAccept(TOKEN_SEMICOLON); }
+
+/* --- Expressions --- */
+
+Operand typeExpression();
+
+int isBinaryOperator(TokenType t) {
+    return t == TOKEN_ADD_OP || t == TOKEN_SUB_OP || t == TOKEN_MULT_OP || t == TOKEN_DIV_OP || t == TOKEN_EQUAL_TO_OP || t == TOKEN_NOT_EQUAL_TO_OP ||
+           (t >= TOKEN_GREATER_OP && t <= TOKEN_LESS_EQUAL_OP) || t == TOKEN_LOGICAL_AND_OP || t == TOKEN_LOGICAL_OR_OP;
+}
+
+Operand typeOperand() {
+    while (currentToken.type == TOKEN_MULT_OP || currentToken.type == TOKEN_POINTER_OP) typeAdvance();
+    Operand operand = { TYPE_NUMBER, currentToken };
+    if (typeAccept(TOKEN_RW_AUTO_REF)) {
+        typeAccept(TOKEN_L_PAREN); if (isType(currentToken) || currentToken.type == TOKEN_IDENTIFIER) typeAdvance(); typeAccept(TOKEN_COMMA);
+        if (currentToken.type == TOKEN_L_BRACKET) { while (currentToken.type != TOKEN_R_BRACKET && currentToken.type != TOKEN_EOF) typeAdvance(); typeAdvance(); }
+        else requireNumber(typeExpression());
+        typeAccept(TOKEN_R_PAREN);
+    } else if (currentToken.type == TOKEN_IDENTIFIER) {
+        char name[MAX_VAR_LEN]; copyLexeme(name, sizeof(name), currentToken); ValueType type = typeOf(name);
+        typeAdvance();
+        if (typeAccept(TOKEN_L_BRACKET)) {
+            if (type != TYPE_ARRAY && type != TYPE_UNKNOWN) typeError(DIAG_NOT_AN_ARRAY, operand.token, operand.token.line, "'%s' is %s, not an array", name, typeNames[type]);
+            requireNumber(typeExpression()); typeAccept(TOKEN_R_BRACKET);
+        } else if (typeAccept(TOKEN_ARROW_OP)) {
+            if (type != TYPE_STRUCT && type != TYPE_UNKNOWN) typeError(DIAG_NOT_A_STRUCT, operand.token, operand.token.line, "'%s' is %s, not a struct", name, typeNames[type]);
+            typeAccept(TOKEN_IDENTIFIER);
+        } else operand.type = type;
+    }
+    else if (currentToken.type == TOKEN_STRING) { operand.type = TYPE_TEXT; typeAdvance(); }
+    else if (typeAccept(TOKEN_L_PAREN)) { operand = typeExpression(); typeAccept(TOKEN_R_PAREN); }
+    else if (currentToken.type != TOKEN_R_BRACE && currentToken.type != TOKEN_RW_OTHERWISE && currentToken.type != TOKEN_SEMICOLON) typeAdvance();
+    return operand;
+}
+
+/* Every operator takes and gives numbers, so precedence does not matter here */
+Operand typeExpression() {
+    Operand result = { TYPE_NUMBER, currentToken };
+    if (typeChecker.depth >= MAX_NESTING) return result;
+    typeChecker.depth++;
+    result = typeOperand();
+    if (isBinaryOperator(currentToken.type)) {
+        requireNumber(result); result.type = TYPE_NUMBER;
+        while (isBinaryOperator(currentToken.type)) { typeAdvance(); requireNumber(typeOperand()); }
+    }
+    typeChecker.depth--;
+    return result;
+}
+
+void typeCondition() { typeAccept(TOKEN_L_PAREN); requireNumber(typeExpression()); typeAccept(TOKEN_R_PAREN); }
+
+/* --- Statements --- */
+
+void typeStatementList(); void typeAssignBlock();
+
+void typeBlock() {
+    if (!typeAccept(TOKEN_L_BRACE)) return;
+    typeStatementList(); typeAccept(TOKEN_R_BRACE);
+}
+
+/* A value storeText() takes: a string literal, or a string variable on its own */
+int typeText() {
+    if (typeAccept(TOKEN_STRING)) return 1;
+    if (currentToken.type != TOKEN_IDENTIFIER || (lookaheadToken.type != TOKEN_COMMA && lookaheadToken.type != TOKEN_SEMICOLON)) return 0;
+    char name[MAX_VAR_LEN]; copyLexeme(name, sizeof(name), currentToken);
+    if (typeOf(name) != TYPE_TEXT) return 0;
+    typeAdvance(); return 1;
+}
+
+int isUnknownName(Token name) { char text[MAX_VAR_LEN]; copyLexeme(text, sizeof(text), name); return typeOf(text) == TYPE_UNKNOWN; }
+
+/* What a declaration's initializer stores, after the '=' */
+ValueType typeInitializer(TokenType declared, Token name) {
+    ValueType type = declared == TOKEN_TYPE_STRING || declared == TOKEN_TYPE_CHAR ? TYPE_TEXT : declared == TOKEN_IDENTIFIER ? TYPE_UNKNOWN : TYPE_NUMBER;
+    if (currentToken.type == TOKEN_L_BRACE && typeChecker.seenQPA) {
+        while (currentToken.type != TOKEN_R_BRACE && currentToken.type != TOKEN_EOF) typeAdvance();
+        typeAccept(TOKEN_R_BRACE); return TYPE_QPA;
+    }
+    if (typeAccept(TOKEN_RW_AUTO_REF)) {
+        ValueType stored = TYPE_NUMBER;
+        typeAccept(TOKEN_L_PAREN); if (isType(currentToken) || currentToken.type == TOKEN_IDENTIFIER) typeAdvance(); typeAccept(TOKEN_COMMA);
+        if (currentToken.type == TOKEN_L_BRACKET || currentToken.type == TOKEN_L_BRACE) {
+            TokenType close = currentToken.type == TOKEN_L_BRACKET ? TOKEN_R_BRACKET : TOKEN_R_BRACE;
+            stored = close == TOKEN_R_BRACKET ? TYPE_ARRAY : TYPE_STRUCT;
+            while (currentToken.type != close && currentToken.type != TOKEN_EOF) typeAdvance();
+            typeAdvance();
+        } else requireNumber(typeExpression());
+        typeAccept(TOKEN_R_PAREN);
+        if (type == TYPE_TEXT) { typeError(DIAG_NOT_A_STRING, name, name.line, "Expected a string for '%.*s', found %s", name.lexeme_length, name.lexeme_start, typeNames[stored]); return TYPE_TEXT; }
+        return stored;
+    }
+    if (type == TYPE_TEXT && typeText()) return TYPE_TEXT;
+    if (currentToken.type == TOKEN_STRING) {
+        Operand literal = { TYPE_TEXT, currentToken }; typeAdvance();
+        if (type == TYPE_NUMBER) { requireNumber(literal); return TYPE_NUMBER; }
+        return TYPE_TEXT;
+    }
+    if (declared == TOKEN_TYPE_STRING && currentToken.type == TOKEN_IDENTIFIER && isUnknownName(currentToken)) { typeAdvance(); return TYPE_TEXT; } /* the parser reports the missing quotes */
+    Operand value = typeExpression(); requireNumber(value);
+    if (type == TYPE_TEXT) {
+        if (value.type == TYPE_NUMBER || value.type == TYPE_UNKNOWN) typeError(DIAG_NOT_A_STRING, name, name.line, "Expected a string for '%.*s', found a number", name.lexeme_length, name.lexeme_start);
+        return TYPE_TEXT;
+    }
+    return TYPE_NUMBER;
+}
+
+void typeDeclaration() {
+    TokenType declared = currentToken.type;
+    ValueType type = declared == TOKEN_TYPE_STRING || declared == TOKEN_TYPE_CHAR ? TYPE_TEXT : declared == TOKEN_IDENTIFIER ? TYPE_UNKNOWN : TYPE_NUMBER;
+    typeAdvance();
+    if (currentToken.type == TOKEN_MULT_OP || currentToken.type == TOKEN_POINTER_OP) typeAdvance();
+    if (typeAccept(TOKEN_QUANTUM_POINTER_OP)) typeChecker.seenQPA = 1;
+    do {
+        if (currentToken.type != TOKEN_IDENTIFIER) { typeAdvance(); continue; }
+        Token name = currentToken; ValueType stored = type;
+        typeAdvance();
+        if (typeAccept(TOKEN_ASSIGN_OP)) stored = typeInitializer(declared, name);
+        else if (isLiteral(currentToken) || currentToken.type == TOKEN_EQUAL_TO_OP) typeAdvance();
+        defineType(name, stored, name.line);
+    } while (typeAccept(TOKEN_COMMA));
+    typeSkip();
+}
+
+/* x = e, x += e, x++ and x--; a for-loop update (statement 0) only stores numbers */
+void typeAssignment(int statement) {
+    Token name = currentToken; typeAdvance();
+    if (currentToken.type >= TOKEN_ASSIGN_OP && currentToken.type <= TOKEN_MOD_ASSIGN_OP) {
+        TokenType op = currentToken.type; typeAdvance();
+        if (currentToken.type == TOKEN_KW_ASK || currentToken.type == TOKEN_QUANTUM_POINTER_OP) return;
+        if (statement && op == TOKEN_ASSIGN_OP && typeText()) defineType(name, TYPE_TEXT, name.line);
+        else { requireNumber(typeExpression()); defineType(name, TYPE_NUMBER, name.line); }
+    } else if (currentToken.type == TOKEN_INCREMENT_OP || currentToken.type == TOKEN_DECREMENT_OP) {
+        char text[MAX_VAR_LEN]; copyLexeme(text, sizeof(text), name);
+        typeAdvance(); requireNumber((Operand){ typeOf(text), name });
+    }
+}
+
+void typeDisplay() {
+    typeAdvance(); typeAccept(TOKEN_L_PAREN);
+    do {
+        if (currentToken.type == TOKEN_RW_EXIT) return;
+        if (currentToken.type == TOKEN_IDENTIFIER && currentToken.lexeme_length == 1 && currentToken.lexeme_start[0] == 'f' && lookaheadToken.type == TOKEN_STRING) typeAdvance();
+        if (currentToken.type == TOKEN_STRING) { typeAdvance(); continue; }
+        if (currentToken.type == TOKEN_IDENTIFIER) {
+            char name[MAX_VAR_LEN]; copyLexeme(name, sizeof(name), currentToken);
+            if (typeOf(name) == TYPE_TEXT) { typeAdvance(); continue; } /* printed as text */
+        }
+        requireNumber(typeExpression());
+    } while (typeAccept(TOKEN_COMMA));
+    typeSkip();
+}
+
+/* One value of an assign block branch, as captureValue() */
+ValueType typeValue() {
+    if (typeAccept(TOKEN_STRING)) return TYPE_TEXT;
+    if (currentToken.type == TOKEN_TYPE_CHAR) { typeError(DIAG_TYPE_AS_VALUE, currentToken, currentToken.line, "Expected a value, found the type 'char'"); typeAdvance(); return TYPE_UNKNOWN; }
+    requireNumber(typeExpression()); return TYPE_NUMBER;
+}
+
+void typeValues(Token *targets, int targetCount) {
+    if (currentToken.type == TOKEN_L_PAREN && targetCount > 1) {
+        typeAdvance();
+        for (int i = 0; i < targetCount; i++) { int line = currentToken.line; defineType(targets[i], typeValue(), line); if (i < targetCount - 1) typeAccept(TOKEN_COMMA); }
+        typeAccept(TOKEN_R_PAREN);
+    } else if (currentToken.type == TOKEN_KW_ASSIGN) typeAssignBlock();
+    else if (targetCount == 0) typeValue();
+    else { int line = currentToken.line; defineType(targets[0], typeValue(), line); }
+}
+
+/* Every branch is checked, whichever one runs */
+void typeAssignBlock() {
+    Token targets[5]; int targetCount = 0;
+    typeAdvance(); typeAccept(TOKEN_L_PAREN);
+    do { if (targetCount < 5 && currentToken.type == TOKEN_IDENTIFIER) { targets[targetCount++] = currentToken; typeAdvance(); } } while (typeAccept(TOKEN_COMMA));
+    typeAccept(TOKEN_R_PAREN); typeAccept(TOKEN_L_BRACE);
+    while (typeAccept(TOKEN_RW_WHEN)) {
+        requireNumber(typeExpression());
+        if (!typeAccept(TOKEN_L_BRACE)) typeAccept(TOKEN_COLON);
+        typeValues(targets, targetCount); typeSkip();
+    }
+    if (typeAccept(TOKEN_RW_OTHERWISE)) { typeAccept(TOKEN_COLON); typeValues(targets, targetCount); typeSkip(); }
+    typeAccept(TOKEN_R_BRACE);
+}
+
+void typeStatement() {
+    Token start = currentToken;
+    if (typeChecker.depth >= MAX_NESTING) { typeAdvance(); return; }
+    typeChecker.depth++;
+    if (isType(currentToken)) typeDeclaration();
+    else if (currentToken.type == TOKEN_IDENTIFIER) {
+        if (lookaheadToken.type >= TOKEN_ADD_OP && lookaheadToken.type <= TOKEN_EXPO_OP) requireNumber(typeExpression());
+        else typeAssignment(1);
+        typeSkip();
+    }
+    else if (currentToken.type == TOKEN_KW_DISPLAY) typeDisplay();
+    else if (currentToken.type == TOKEN_KW_ASSIGN) typeAssignBlock();
+    else if (typeAccept(TOKEN_KW_IF)) {
+        typeCondition(); typeBlock();
+        while (typeAccept(TOKEN_KW_ELIF)) { typeCondition(); typeBlock(); }
+        if (typeAccept(TOKEN_KW_ELSE)) { if (currentToken.type == TOKEN_KW_IF) typeStatement(); else typeBlock(); }
+    }
+    else if (typeAccept(TOKEN_KW_WHILE)) { typeCondition(); typeBlock(); }
+    else if (typeAccept(TOKEN_KW_DO)) { typeBlock(); typeAccept(TOKEN_KW_WHILE); typeCondition(); typeAccept(TOKEN_SEMICOLON); }
+    else if (typeAccept(TOKEN_KW_FOR)) {
+        typeAccept(TOKEN_L_PAREN);
+        if (isType(currentToken)) typeDeclaration(); else if (currentToken.type == TOKEN_IDENTIFIER) { typeAssignment(1); typeSkip(); }
+        requireNumber(typeExpression()); typeAccept(TOKEN_SEMICOLON);
+        if (currentToken.type == TOKEN_IDENTIFIER) typeAssignment(0);
+        for (int parens = 0; (currentToken.type != TOKEN_R_PAREN || parens > 0) && currentToken.type != TOKEN_L_BRACE && currentToken.type != TOKEN_EOF; typeAdvance())
+            parens += (currentToken.type == TOKEN_L_PAREN) - (currentToken.type == TOKEN_R_PAREN);
+        typeAccept(TOKEN_R_PAREN); typeBlock();
+    }
+    else if (typeAccept(TOKEN_KW_FN)) { typeAccept(TOKEN_IDENTIFIER); typeAccept(TOKEN_L_PAREN); typeAccept(TOKEN_R_PAREN); typeBlock(); }
+    else if (currentToken.type == TOKEN_QUANTUM_POINTER_OP || currentToken.type == TOKEN_MULT_OP) {
+        if (currentToken.type == TOKEN_QUANTUM_POINTER_OP) typeChecker.seenQPA = 1;
+        typeAdvance(); typeAccept(TOKEN_IDENTIFIER); typeAdvance(); requireNumber(typeExpression()); typeSkip();
+    }
+    else typeAdvance();
+    typeChecker.depth--;
+    if (currentToken.lexeme_start == start.lexeme_start && currentToken.type != TOKEN_EOF) typeAdvance(); /* always make progress */
+}
+
+void typeStatementList() {
+    while (currentToken.type != TOKEN_RW_EXIT && currentToken.type != TOKEN_R_BRACE && currentToken.type != TOKEN_EOF) typeStatement();
+}
+
+/* Both passes over the program; reports [Type Error]s and clears success on any */
+void checkTypes(const char *input) {
+    typeCount = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        memset(&typeChecker, 0, sizeof(typeChecker)); typeChecker.reporting = pass;
+        initScanner(input); lookaheadToken = getNextToken(); typeAdvance();
+        while (currentToken.type == TOKEN_KW_STRUCT) {
+            typeAdvance(); typeAccept(TOKEN_IDENTIFIER); typeAccept(TOKEN_L_BRACE);
+            while (isType(currentToken)) typeDeclaration();
+            typeAccept(TOKEN_R_BRACE);
+        }
+        if (!typeAccept(TOKEN_RW_EXECUTE)) continue;
+        typeAccept(TOKEN_L_PAREN); typeAccept(TOKEN_R_PAREN); typeAccept(TOKEN_L_BRACE);
+        typeStatementList();
+    }
+}
+
+#ifndef CNACK_NO_MAIN
+int main(int argc, char *argv[]) {
+    const char **paths = NULL; int pathCount = 0; char *fileList = NULL; /* batch mode input files */
+    int jobs = 0; /* batch worker threads, 0 = one per processor */
+    int emitC = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stats") == 0) stats.enabled = 1;
+        else if (strcmp(argv[i], "--stats=json") == 0) stats.enabled = stats.json = 1;
+        else if (strncmp(argv[i], "--max-steps=", 12) == 0) { if (!parseCount(argv[i] + 12, 0, LONG_MAX, &maxSteps)) return optionError("--max-steps", "a step count (0 = unlimited)"); }
+        else if (strncmp(argv[i], "--timeout-ms=", 13) == 0) { if (!parseCount(argv[i] + 13, 0, LONG_MAX, &timeoutMs)) return optionError("--timeout-ms", "milliseconds (0 = unlimited)"); }
+        else if (strncmp(argv[i], "--cache=", 8) == 0) cachePath = argv[i] + 8;
+        else if (strncmp(argv[i], "--cache-dir=", 12) == 0) cacheDir = argv[i] + 12;
+        else if (strncmp(argv[i], "--cache-max-bytes=", 18) == 0) { if (!parseCount(argv[i] + 18, 1, LONG_MAX, &cacheMaxBytes)) return optionError("--cache-max-bytes", "a positive byte count"); cacheBounded = 1; }
+        else if (strncmp(argv[i], "--jobs=", 7) == 0) { long count; if (!parseCount(argv[i] + 7, 0, INT_MAX, &count)) return optionError("--jobs", "a thread count (0 = one per processor)"); jobs = (int)count; }
+        else if (strcmp(argv[i], "--emit-c") == 0) emitC = 1;
+        else if (strcmp(argv[i], "--no-jit") == 0) useJit = 0;
+        else if (strncmp(argv[i], "--max-diagnostics=", 18) == 0) { long limit; if (!parseCount(argv[i] + 18, 0, INT_MAX, &limit)) return optionError("--max-diagnostics", "a count (0 = unlimited)"); maxDiagnostics = (int)limit; }
+        else if (strcmp(argv[i], "--diagnostics=json") == 0) diagnosticsJson = 1;
+        else if (strcmp(argv[i], "--diagnostics=text") == 0) diagnosticsJson = 0;
+        else if (strncmp(argv[i], "--files-from=", 13) == 0) {
+            if (!readFileList(argv[i] + 13, &fileList, &paths, &pathCount)) { fprintf(stderr, "Error: Cannot read file list '%s'\n", argv[i] + 13); return 1; }
+        }
+        else if (strncmp(argv[i], "--", 2) != 0) {
+            const char **grown = (const char **)realloc(paths, (pathCount + 1) * sizeof(char *)); if (!grown) return 1;
+            paths = grown; paths[pathCount++] = argv[i];
+        }
+        else { fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]); return 1; }
+    }
+
+    if (pathCount > 0 || fileList) {
+        if (cachePath || cacheDir) { fprintf(stderr, "Error: --cache and --cache-dir work on stdin only\n"); return 1; }
+        if (emitC) { fprintf(stderr, "Error: --emit-c works on stdin only\n"); return 1; }
+        if (jobs <= 0) jobs = cpuCount();
+        int ok = jobs > 1 && pathCount > 1 ? parseFilesParallel(paths, pathCount, jobs) : parseFiles(paths, pathCount);
+        if (stats.enabled) printStats();
+        free(paths); free(fileList); return ok ? 0 : 1;
+    }
+
+    double start = nowSeconds();
+    size_t total_size = 0; char *input = readStream(stdin, &total_size); if (!input) return 1;
+    stats.input_bytes = total_size; stats.read_time = nowSeconds() - start;
+    if (cacheDir && !cachePath) {
+        makeDirectory(cacheDir);
+        snprintf(cacheDirFile, sizeof(cacheDirFile), "%s/%016llx.pc", cacheDir, extendHash(FNV_OFFSET, input, 0, (int)strlen(input)));
+        cachePath = cacheDirFile;
+    }
+    else if (cacheDir) { fprintf(stderr, "Error: use either --cache or --cache-dir\n"); return 1; }
+    if (emitC) { int ok = emitProgramC(input); free(input); return ok ? 0 : 1; }
+
+    start = nowSeconds();
+    parseProgram(input);
+    stats.parse_time = nowSeconds() - start - stats.lex_time - stats.exec_time;
+
+    start = nowSeconds();
+    printSummary();
+    fflush(stdout);
+    stats.format_time = nowSeconds() - start;
+
+    if (stats.enabled) printStats();
+    free(input); return 0;
+}
+#endif
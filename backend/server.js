@@ -5,22 +5,111 @@ const cors = require('cors');
 const bodyParser = require('body-parser');
 const path = require('path');
 const fs = require('fs');
-const { spawn } = require('child_process');
+const fsp = fs.promises;
+const os = require('os');
+const crypto = require('crypto');
+const { spawn, spawnSync } = require('child_process');
+const { pipeline } = require('stream');
+const { parseTokenStream, formatTokenStream, parseDelta, applyDelta, parseSemanticTokens } = require('./tools/tokens');
+const { ResultCache, binaryMode } = require('./tools/cache');
+const { RecordStream, lexerRecord, parserRecord, parseBatchOutput } = require('./tools/records');
+const { Scheduler, SchedulerError } = require('./tools/scheduler');
+const { binaryPath } = require('./tools/build');
 
 const app = express();
 const PORT = 3001; 
 
 // Middleware
 app.use(cors());
+app.use('/batch', bodyParser.json({ limit: '64mb' })); // many programs in one request
+app.use(['/lexical/stream', '/syntax/stream'], bodyParser.json({ limit: '64mb' })); // large programs, answered as they are analyzed
 app.use(bodyParser.json());
 app.use(bodyParser.text());
 
 // -----------------------------
 //  PATHS TO EXECUTABLES
 // -----------------------------
+// Binaries built from the current sources (npm run build, backend/build/) are used when
+// they exist; the prebuilt bin/*.exe may predate options such as --semantic-tokens.
 const BIN_DIR = path.join(__dirname, 'bin');
-const LEXER_PATH = path.join(BIN_DIR, 'lexer.exe');
-const PARSER_PATH = path.join(BIN_DIR, 'parser.exe'); // NEW: Path for Syntax Analyzer
+const analyzerPath = (name) => (fs.existsSync(binaryPath(name)) ? binaryPath(name) : path.join(BIN_DIR, `${name}.exe`));
+const LEXER_PATH = analyzerPath('lexer');
+const PARSER_PATH = analyzerPath('parser'); // NEW: Path for Syntax Analyzer
+
+// An older binary ignores options it does not know and prints its usual output, so the
+// options the endpoints depend on are probed once; requests needing a missing one are
+// refused instead of answered with output in the wrong format (or none at all).
+// Each probe runs the binary on PROBE_SOURCE inside a scratch directory; the parser only
+// writes a cache once it has reached the program, so the source has one.
+const PROBE_SOURCE = 'execute() {\n}\n';
+const OPTION_PROBES = {
+  '--semantic-tokens': (run) => run(['--semantic-tokens']).startsWith('#CNACK-SEMANTIC '),
+  '--columns': (run) => run(['--columns']).includes('| COL '),
+  '--files-from': (run, dir) => run([`--files-from=${path.join(dir, 'files.txt')}`]).startsWith('#### FILE 0 '),
+  '--cache': (run, dir) => { run([`--cache=${path.join(dir, 'probe.pc')}`]); return fs.existsSync(path.join(dir, 'probe.pc')); },
+  '--cache-dir': (run, dir) => { run([`--cache-dir=${path.join(dir, 'tokens')}`]); return fs.existsSync(path.join(dir, 'tokens')); },
+};
+
+// Map of option -> supported; empty when the binary is missing (that is reported per request)
+function probeOptions(binary, options) {
+  const supported = new Map();
+  if (!fs.existsSync(binary)) return supported;
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'cnack-probe-'));
+  try {
+    fs.writeFileSync(path.join(dir, 'probe.txt'), PROBE_SOURCE);
+    fs.writeFileSync(path.join(dir, 'files.txt'), path.join(dir, 'probe.txt'));
+    const run = (args) => spawnSync(binary, args, { input: PROBE_SOURCE, encoding: 'utf8' }).stdout || '';
+    for (const option of options) supported.set(option, OPTION_PROBES[option](run, dir));
+  } finally {
+    fs.rmSync(dir, { recursive: true, force: true });
+  }
+  return supported;
+}
+
+const ANALYZERS = {
+  lexer: { name: 'Lexer', path: LEXER_PATH, options: probeOptions(LEXER_PATH, ['--semantic-tokens', '--columns', '--files-from', '--cache-dir']) },
+  parser: { name: 'Parser', path: PARSER_PATH, options: probeOptions(PARSER_PATH, ['--files-from', '--cache']) },
+};
+
+function unsupportedOptions(analyzer) {
+  return [...analyzer.options].filter(([, supported]) => !supported).map(([option]) => option);
+}
+
+// Answer 501 when args ("--option" or "--option=value") need an option the binary lacks
+function rejectUnsupported(res, analyzer, args) {
+  const missing = args.map((arg) => arg.replace(/=.*$/, '')).find((option) => analyzer.options.get(option) === false);
+  if (!missing) return false;
+  res.status(501).json({ error: `${analyzer.name} at ${analyzer.path} does not support ${missing}; run npm run build to rebuild it.` });
+  return true;
+}
+
+// In-process lexer and parser (npm run build:addon), run on the libuv thread pool.
+// Endpoints fall back to spawning the binaries when a module is missing; CNACK_NATIVE=0
+// always spawns.
+const native = process.env.CNACK_NATIVE === '0' ? {} : require('./addon');
+
+// Set CNACK_STATS=1 to run the analyzers with --stats=json and log per-request timings
+const LOG_STATS = process.env.CNACK_STATS === '1';
+
+// Identical submissions are answered from a result cache. CNACK_CACHE=0 disables it,
+// CNACK_CACHE_MB sets the memory budget and CNACK_CACHE_DIR adds a disk tier
+// (budget CNACK_CACHE_DISK_MB) that survives restarts.
+const resultCache = process.env.CNACK_CACHE === '0' ? null : new ResultCache({
+  maxBytes: parseFloat(process.env.CNACK_CACHE_MB || '64') * 1024 * 1024,
+  dir: process.env.CNACK_CACHE_DIR || null,
+  maxDiskBytes: parseFloat(process.env.CNACK_CACHE_DISK_MB || '256') * 1024 * 1024,
+});
+
+// Every analyzer run goes through one scheduler: CNACK_MAX_JOBS runs at a time (default:
+// one per core), at most CNACK_QUEUE_MAX requests wait, each for CNACK_QUEUE_WAIT_MS, and
+// a run is killed after CNACK_RUN_TIMEOUT_MS or when its client disconnects.
+const envInt = (name) => (process.env[name] ? parseInt(process.env[name], 10) : undefined);
+const scheduler = new Scheduler({
+  concurrency: envInt('CNACK_MAX_JOBS'),
+  maxQueue: envInt('CNACK_QUEUE_MAX'),
+  maxWaitMs: envInt('CNACK_QUEUE_WAIT_MS'),
+  runTimeoutMs: envInt('CNACK_RUN_TIMEOUT_MS'),
+});
 
 // Root endpoint
 app.get('/', (req, res) => {
@@ -30,22 +119,313 @@ app.get('/', (req, res) => {
 // -----------------------------
 //  1. LEXICAL ANALYSIS ENDPOINT
 // -----------------------------
+// With { columns: true } the table gets a COL column (lexer --columns)
 app.post('/lexical', (req, res) => {
-  handleProcess(req, res, LEXER_PATH, "Lexer");
+  const args = req.body.columns ? ['--columns'] : [];
+  if (native.lexer) {
+    return handleNative(req, res, native.lexer, "Lexer", args, (code) => native.lexer.lex(code, { columns: args.length > 0 }));
+  }
+  if (rejectUnsupported(res, ANALYZERS.lexer, args)) return;
+  return handleProcess(req, res, LEXER_PATH, "Lexer", args);
+});
+
+// -----------------------------
+//  1b. INCREMENTAL LEXICAL ANALYSIS
+// -----------------------------
+// The client sends the whole buffer plus a sessionId. The previous source and token
+// stream of the session are kept here; the edit is the span between their common prefix
+// and suffix, and the lexer only relexes that region (--incremental). The response holds
+// a token delta, or the full stream for a new session.
+const MAX_SESSIONS = 64;
+const sessions = new Map();
+
+app.post('/lexical/incremental', async (req, res) => {
+  const { code, sessionId } = req.body;
+  if (typeof code !== 'string' || !sessionId) {
+    return res.status(400).json({ error: 'Expected { code, sessionId }.' });
+  }
+  if (!fs.existsSync(LEXER_PATH)) {
+    return res.status(500).json({ error: `Lexer executable NOT FOUND at: ${LEXER_PATH}.` });
+  }
+
+  const source = Buffer.from(code);
+  const previous = sessions.get(sessionId);
+  sessions.delete(sessionId);
+
+  try {
+    let result = null;
+    if (previous && source.length > 0) result = await relexSession(previous, source, res);
+    if (!result) {
+      const full = await runScheduled(res, LEXER_PATH, ['--emit-tokens'], source);
+      if (full.status !== 0) return res.json({ success: false, output: full.stderr || full.stdout, type: 'error' });
+      const stream = parseTokenStream(full.stdout);
+      result = { stream, body: { mode: 'full', tokens: stream.tokens } };
+    }
+
+    sessions.set(sessionId, { source, stream: result.stream });
+    if (sessions.size > MAX_SESSIONS) sessions.delete(sessions.keys().next().value);
+    return res.json({ success: true, ...result.body, type: 'success' });
+  } catch (err) {
+    if (err instanceof SchedulerError) return rejectRequest(res, err);
+    return res.status(500).json({ error: `Incremental lexing failed: ${err.message}` });
+  }
+});
+
+// Relex the edited region of a session; returns null when a full run is needed instead
+async function relexSession(previous, source, res) {
+  const old = previous.source;
+  let prefix = 0;
+  const maxPrefix = Math.min(old.length, source.length);
+  while (prefix < maxPrefix && old[prefix] === source[prefix]) prefix++;
+  let suffix = 0;
+  while (suffix < maxPrefix - prefix && old[old.length - 1 - suffix] === source[source.length - 1 - suffix]) suffix++;
+  const removed = old.length - prefix - suffix;
+  const inserted = source.length - prefix - suffix;
+
+  const edit = `--edit=${prefix},${removed},${inserted}`;
+  const run = await relexWithStream(res, formatTokenStream(previous.stream), edit, source);
+  if (run.status !== 0) return null;
+  const delta = parseDelta(run.stdout);
+  return {
+    stream: applyDelta(previous.stream, delta, source.length),
+    body: { mode: 'delta', edit: { offset: prefix, removed, inserted }, delta },
+  };
+}
+
+// The previous token stream is written without blocking into a directory of its own, so
+// requests in the same millisecond never share (or delete) each other's file
+async function relexWithStream(res, streamText, edit, source) {
+  const dir = await fsp.mkdtemp(path.join(os.tmpdir(), 'cnack-session-'));
+  try {
+    const streamFile = path.join(dir, 'previous.txt');
+    await fsp.writeFile(streamFile, streamText);
+    return await runScheduled(res, LEXER_PATH, [`--incremental=${streamFile}`, edit], source);
+  } finally {
+    await fsp.rm(dir, { recursive: true, force: true });
+  }
+}
+
+// -----------------------------
+//  1c. SEMANTIC TOKENS
+// -----------------------------
+// Highlighting data for the editor from the real lexer (--semantic-tokens): legend holds
+// the class names, data four numbers per token (line delta, column delta, length, class)
+// with columns and lengths in UTF-16 units, as in LSP semantic tokens.
+app.post('/lexical/semantic', async (req, res) => {
+  const { code } = req.body;
+  if (typeof code !== 'string' || code === '') {
+    return res.status(400).json({ error: 'Expected { code } with some code to highlight.' });
+  }
+  if (!fs.existsSync(LEXER_PATH)) {
+    return res.status(500).json({ error: `Lexer executable NOT FOUND at: ${LEXER_PATH}.` });
+  }
+
+  const args = ['--semantic-tokens'];
+  if (rejectUnsupported(res, ANALYZERS.lexer, args)) return;
+  const cacheKey = resultCacheKey(LEXER_PATH, "Semantic", args, code);
+  if (cacheKey) {
+    const cached = await resultCache.get(cacheKey);
+    if (cached) return res.json(cached);
+  }
+  try {
+    const run = await runScheduled(res, LEXER_PATH, args, code);
+    if (run.status !== 0) return res.json({ success: false, output: run.stderr || run.stdout, type: 'error' });
+    const result = { success: true, ...parseSemanticTokens(run.stdout), type: 'success' };
+    if (cacheKey) resultCache.set(cacheKey, result);
+    return res.json(result);
+  } catch (err) {
+    if (err instanceof SchedulerError) return rejectRequest(res, err);
+    return res.status(500).json({ error: `Semantic tokens failed: ${err.message}` });
+  }
 });
 
 // -----------------------------
 //  2. SYNTAX ANALYSIS ENDPOINT (NEW)
 // -----------------------------
+// With a sessionId the parser keeps a per-session --cache file, so only the
+// statements from the first edited one onward are parsed again. Without one the
+// in-process parser answers, and the response also lists the diagnostics. The
+// parser deletes the least recently used session files past PARSE_CACHE_MAX_BYTES.
+const PARSE_CACHE_DIR = path.join(os.tmpdir(), 'cnack-parse-cache');
+const PARSE_CACHE_MAX_BYTES = 64 * 1024 * 1024;
+
 app.post('/syntax', (req, res) => {
-  handleProcess(req, res, PARSER_PATH, "Parser");
+  const { sessionId } = req.body;
+  const args = [];
+  if (!sessionId && native.parser) {
+    return handleNative(req, res, native.parser, "Parser", args, (code) => native.parser.parse(code));
+  }
+  if (sessionId) {
+    fs.mkdirSync(PARSE_CACHE_DIR, { recursive: true });
+    const key = crypto.createHash('sha1').update(String(sessionId)).digest('hex');
+    args.push(`--cache=${path.join(PARSE_CACHE_DIR, `${key}.pc`)}`, `--cache-max-bytes=${PARSE_CACHE_MAX_BYTES}`);
+    if (rejectUnsupported(res, ANALYZERS.parser, args)) return;
+  }
+  return handleProcess(req, res, PARSER_PATH, "Parser", args);
+});
+
+// -----------------------------
+//  3. BATCH ANALYSIS ENDPOINT
+// -----------------------------
+// Body: { sources: [{ name, code } | code, ...], tools: ['lexer', 'parser'] }.
+// Cached results are answered directly; the rest go to one process per tool,
+// which reads, analyzes and prints the files as a pipeline (FILE... batch mode).
+const BATCH_TOOLS = ANALYZERS;
+
+app.post('/batch', async (req, res) => {
+  const { sources, tools = ['lexer', 'parser'] } = req.body;
+  if (!Array.isArray(sources) || sources.length === 0) {
+    return res.status(400).json({ error: 'Expected { sources: [...] } with at least one program.' });
+  }
+  const items = sources.map((s, i) => (typeof s === 'string' ? { name: `source-${i + 1}`, code: s } : { name: s.name || `source-${i + 1}`, code: s.code }));
+  if (items.some((item) => typeof item.code !== 'string')) {
+    return res.status(400).json({ error: 'Every source needs a code string.' });
+  }
+  for (const tool of tools) {
+    if (!BATCH_TOOLS[tool]) return res.status(400).json({ error: `Unknown tool '${tool}'.` });
+    if (!fs.existsSync(BATCH_TOOLS[tool].path)) {
+      return res.status(500).json({ error: `${BATCH_TOOLS[tool].name} executable NOT FOUND at: ${BATCH_TOOLS[tool].path}.` });
+    }
+    if (rejectUnsupported(res, BATCH_TOOLS[tool], ['--files-from'])) return;
+  }
+
+  try {
+    const results = items.map((item) => ({ name: item.name }));
+    await Promise.all(tools.map(async (tool) => {
+      const outputs = await runBatch(BATCH_TOOLS[tool], items.map((item) => item.code), res);
+      outputs.forEach((output, i) => { results[i][tool] = output; });
+    }));
+    return res.json({ success: true, results });
+  } catch (err) {
+    if (err instanceof SchedulerError) return rejectRequest(res, err);
+    return res.status(500).json({ error: `Batch analysis failed: ${err.message}` });
+  }
+});
+
+// Analyze many sources with one process; returns one { success, output, type } per source
+async function runBatch(tool, codes, res) {
+  const results = new Array(codes.length);
+  const keys = codes.map((code) => resultCacheKey(tool.path, tool.name, [], code));
+  const pending = [];
+  const cached = await Promise.all(keys.map((key) => key && resultCache.get(key)));
+  codes.forEach((code, i) => {
+    if (cached[i]) results[i] = cached[i];
+    else pending.push(i);
+  });
+  if (pending.length === 0) return results;
+
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'cnack-batch-'));
+  try {
+    const files = pending.map((i) => {
+      const file = path.join(dir, `${i}.cnack`);
+      fs.writeFileSync(file, codes[i]);
+      return file;
+    });
+    const listFile = path.join(dir, 'files.txt');
+    fs.writeFileSync(listFile, files.join('\n'));
+
+    const run = await runScheduled(res, tool.path, [`--files-from=${listFile}`], '', 'buffer');
+    const framed = parseBatchOutput(run.stdout);
+    if (framed.length !== pending.length) throw new Error(run.stderr || `${tool.name} returned ${framed.length} of ${pending.length} results`);
+
+    framed.forEach((entry, n) => {
+      const i = pending[n];
+      if (entry.status === 2) {
+        results[i] = { success: false, output: entry.output, type: 'error' };
+      } else {
+        results[i] = { success: true, output: entry.output || 'No output generated.', type: 'success' };
+        storeResult(keys[i], results[i]);
+      }
+    });
+    return results;
+  } finally {
+    fs.rmSync(dir, { recursive: true, force: true });
+  }
+}
+
+// -----------------------------
+//  4. STREAMING ANALYSIS ENDPOINTS
+// -----------------------------
+// Same body as /lexical and /syntax, answered as application/x-ndjson: one record per
+// token row, diagnostic or output line as the binary prints it, then
+// { type: 'end', success }. The child's stdout is piped into the response, so a slow
+// client leaves the child blocked on a full pipe instead of the output piling up here.
+// The lexer runs with --stream and prints rows while it is still reading the source.
+// Streamed results are not cached. A run killed by the scheduler ends with success: false.
+app.post('/lexical/stream', (req, res) => {
+  const args = req.body.columns ? ['--columns'] : ['--stream'];
+  if (rejectUnsupported(res, ANALYZERS.lexer, args)) return;
+  return streamProcess(req, res, LEXER_PATH, "Lexer", args, lexerRecord);
+});
+
+app.post('/syntax/stream', (req, res) => {
+  return streamProcess(req, res, PARSER_PATH, "Parser", [], parserRecord);
+});
+
+async function streamProcess(req, res, executablePath, processName, args, toRecord) {
+  const { code } = req.body;
+  if (!code || code.trim() === '') {
+    return res.status(400).json({ error: 'Empty code: Please enter some code to analyze.' });
+  }
+  if (!fs.existsSync(executablePath)) {
+    return res.status(500).json({ error: `${processName} executable NOT FOUND at: ${executablePath}.` });
+  }
+
+  try {
+    await schedule(res, (signal) => {
+      const child = spawn(executablePath, LOG_STATS ? [...args, '--stats=json'] : args, { signal, killSignal: 'SIGKILL' });
+      let errorOutput = '';
+      child.on('error', () => {}); // the abort that killed the child is reported in the end record
+      child.stderr.on('data', (data) => { errorOutput += data.toString(); });
+      const closed = new Promise((resolve) => child.on('close', resolve));
+
+      const records = new RecordStream(toRecord, async () => {
+        const status = await closed;
+        if (LOG_STATS) errorOutput = logStats(processName, errorOutput);
+        if (signal.aborted) return { type: 'end', success: false, error: signal.reason.message };
+        if (status === 0) return { type: 'end', success: true };
+        return { type: 'end', success: false, error: errorOutput.trim() || `${processName} exited with status ${status}` };
+      });
+
+      // Headers go out now, so a later timeout can only be reported in the end record
+      res.type('application/x-ndjson');
+      res.flushHeaders();
+      // A client that disconnects ends the pipeline early; the child is not needed any more
+      const piped = new Promise((resolve) => pipeline(child.stdout, records, res, (err) => {
+        if (err) child.kill('SIGKILL');
+        resolve();
+      }));
+      child.stdin.on('error', () => {}); // EPIPE when the child was killed before reading everything
+      child.stdin.end(code);
+      return Promise.all([closed, piped]);
+    });
+  } catch (err) {
+    if (err instanceof SchedulerError) return rejectRequest(res, err);
+    throw err;
+  }
+}
+
+// -----------------------------
+//  RESULT CACHE STATISTICS
+// -----------------------------
+app.get('/cache/stats', (req, res) => {
+  res.json(resultCache ? resultCache.stats() : { enabled: false });
+});
+
+// -----------------------------
+//  SCHEDULER STATISTICS
+// -----------------------------
+// Running and queued analyzer runs, the queue's high-water mark and how many requests
+// were rejected, expired in the queue, cancelled or killed at the run timeout
+app.get('/scheduler/stats', (req, res) => {
+  res.json(scheduler.stats());
 });
 
 // -----------------------------
 //  HELPER FUNCTION
 // -----------------------------
 // Reusable function to handle both Lexer and Parser processes
-function handleProcess(req, res, executablePath, processName) {
+async function handleProcess(req, res, executablePath, processName, args = []) {
   const { code } = req.body;
 
   // Validate user input 
@@ -62,44 +442,148 @@ function handleProcess(req, res, executablePath, processName) {
     });
   }
 
-  // Spawn the process (Lexer or Parser) 
-  const child = spawn(executablePath);
+  // Serve repeated submissions from the cache
+  const cacheKey = resultCacheKey(executablePath, processName, args, code);
+  if (cacheKey) {
+    const cached = await resultCache.get(cacheKey);
+    if (cached) return res.json(cached);
+  }
 
-  let output = '';
-  let errorOutput = '';
+  // Run the process (Lexer or Parser) once the scheduler admits it
+  let run;
+  try {
+    run = await runScheduled(res, executablePath, args, code);
+  } catch (err) {
+    if (err instanceof SchedulerError) return rejectRequest(res, err);
+    throw err;
+  }
 
-  // Capture Standard Output
-  child.stdout.on('data', (data) => {
-    output += data.toString();
-  });
+  // If the process had stderr output, treat it as an error message
+  // Note: Some compilers print warnings to stderr, so you might want to adjust this logic depending on your C code's behavior.
+  if (run.stderr && run.status !== 0) {
+    return res.json({
+      success: false,
+      output: run.stderr, // Send the error message from C code back to frontend
+      type: 'error'
+    });
+  }
 
-  // Capture Standard Error
-  child.stderr.on('data', (data) => {
-    errorOutput += data.toString();
-  });
+  const result = {
+    success: true,
+    output: run.stdout || 'No output generated.',
+    type: 'success'
+  };
+  storeResult(cacheKey, result);
+  return res.json(result);
+}
 
-  // Handle Process Closure
-  child.on('close', (code) => {
-    // If the process had stderr output, treat it as an error message
-    // Note: Some compilers print warnings to stderr, so you might want to adjust this logic depending on your C code's behavior.
-    if (errorOutput && code !== 0) { 
-        return res.json({ 
-            success: false, 
-            output: errorOutput, // Send the error message from C code back to frontend
-            type: 'error'
-        });
-    }
+// Same contract as handleProcess, answered by an addon module instead of a process
+async function handleNative(req, res, addon, processName, args, analyze) {
+  const { code } = req.body;
+  if (!code || code.trim() === '') {
+    return res.status(400).json({
+      error: 'Empty code: Please enter some code to analyze.'
+    });
+  }
 
-    return res.json({
+  const cacheKey = resultCacheKey(addon.file, processName, args, code);
+  if (cacheKey) {
+    const cached = await resultCache.get(cacheKey);
+    if (cached) return res.json(cached);
+  }
+
+  try {
+    // The addon cannot be stopped once it runs; a timeout only answers the client early
+    const analysis = await schedule(res, async () => {
+      const start = process.hrtime.bigint();
+      const done = await analyze(code);
+      if (LOG_STATS) {
+        const ms = Number(process.hrtime.bigint() - start) / 1e6;
+        console.log(`[stats] ${processName}: ${JSON.stringify({ native: true, bytes: Buffer.byteLength(code), ms })}`);
+      }
+      return done;
+    });
+    const result = {
       success: true,
-      output: output || 'No output generated.',
+      output: analysis.output || 'No output generated.',
       type: 'success'
+    };
+    if (analysis.diagnostics) result.diagnostics = analysis.diagnostics;
+    storeResult(cacheKey, result);
+    return res.json(result);
+  } catch (err) {
+    if (err instanceof SchedulerError) return rejectRequest(res, err);
+    return res.json({ success: false, output: `Error: ${err.message}`, type: 'error' });
+  }
+}
+
+// The key covers the binary's (or addon module's) version and the arguments that change the output
+// (the --cache options only change how fast it is produced)
+function resultCacheKey(executablePath, processName, args, code) {
+  if (!resultCache) return null;
+  return resultCache.key(processName, binaryMode(executablePath, args), code);
+}
+
+function storeResult(cacheKey, result) {
+  // A wall-clock timeout depends on machine load, so that result is not reusable
+  if (cacheKey && !result.output.includes('Execution time limit exceeded')) resultCache.set(cacheKey, result);
+}
+
+// Run a binary with the given stdin and collect its exit status and output
+// (stdout as a string, or as a Buffer when framed byte counts must be kept).
+// Aborting the signal kills the child.
+function runBinary(executablePath, args, input, stdoutAs = 'string', signal = undefined) {
+  return new Promise((resolve, reject) => {
+    const child = spawn(executablePath, LOG_STATS ? [...args, '--stats=json'] : args, { signal, killSignal: 'SIGKILL' });
+    const chunks = [];
+    let stderr = '';
+    child.stdout.on('data', (data) => { chunks.push(data); });
+    child.stderr.on('data', (data) => { stderr += data.toString(); });
+    child.on('error', reject);
+    child.on('close', (status) => {
+      if (LOG_STATS) stderr = logStats(path.basename(executablePath), stderr);
+      const stdout = Buffer.concat(chunks);
+      resolve({ status, stdout: stdoutAs === 'buffer' ? stdout : stdout.toString(), stderr });
     });
+    child.stdin.on('error', () => {}); // EPIPE when the child was killed before reading everything
+    child.stdin.end(input);
   });
+}
+
+// -----------------------------
+//  SCHEDULING HELPERS
+// -----------------------------
+// Run an analyzer job for a request; it is cancelled when the client disconnects first
+function schedule(res, job) {
+  const client = new AbortController();
+  res.on('close', () => { if (!res.writableFinished) client.abort(); });
+  return scheduler.run(job, { signal: client.signal });
+}
+
+function runScheduled(res, executablePath, args, input, stdoutAs) {
+  return schedule(res, (signal) => runBinary(executablePath, args, input, stdoutAs, signal));
+}
+
+// Answer a request the scheduler turned away or gave up on
+function rejectRequest(res, err) {
+  if (err.code === 'CANCELLED' || res.headersSent) return; // nobody is waiting for a JSON error
+  if (err.code !== 'TIMEOUT') res.set('Retry-After', '1');
+  return res.status(err.code === 'TIMEOUT' ? 504 : 503).json({ error: err.message });
+}
 
-  // Write code to STDIN of the C program 
-  child.stdin.write(code);
-  child.stdin.end();
+// Pull the --stats=json line out of stderr, log it, and return the remaining stderr text
+function logStats(processName, errorOutput) {
+  const lines = errorOutput.split('\n');
+  const statsIndex = lines.findIndex((line) => line.startsWith('{"tool":'));
+  if (statsIndex === -1) return errorOutput;
+  try {
+    const stats = JSON.parse(lines[statsIndex]);
+    console.log(`[stats] ${processName}: ${JSON.stringify(stats)}`);
+  } catch (e) {
+    console.error(`[stats] ${processName}: could not parse stats line`);
+  }
+  lines.splice(statsIndex, 1);
+  return lines.join('\n');
 }
 
 // -----------------------------
@@ -120,5 +604,13 @@ app.listen(PORT, () => {
   console.log(`📁 Bin Directory: ${BIN_DIR}`);
   console.log(`   Expecting Lexer at:  ${LEXER_PATH}`);
   console.log(`   Expecting Parser at: ${PARSER_PATH}`);
+  for (const analyzer of Object.values(ANALYZERS)) {
+    const missing = unsupportedOptions(analyzer);
+    if (missing.length) console.warn(`⚠️  ${analyzer.name} does not support ${missing.join(', ')}; run npm run build`);
+  }
+  if (native.lexer || native.parser) {
+    console.log(`⚡ In-process: ${[native.lexer && 'lexer', native.parser && 'parser'].filter(Boolean).join(', ')}`);
+  }
+  console.log(`🚦 Analyzer runs: ${scheduler.concurrency} at a time, up to ${scheduler.maxQueue} waiting`);
   console.log(`✅ Ready to accept requests!\n`);
 });
\ No newline at end of file
@@ -0,0 +1,138 @@
+// -----------------------------
+//  LEXER / PARSER BENCHMARK
+// -----------------------------
+// Generates one corpus per shape, then times the lexer and parser binaries on it.
+// Reports MB/s and tokens/s for the lexer and statements/s for the parser.
+// Usage: node tools/bench.js [--size=1MB] [--runs=5] [--warmup=1] [--shapes=loops,strings]
+//                            [--lexer=path] [--parser=path] [--json=results.json]
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { spawnSync } = require('child_process');
+const { generate, parseSize, SHAPES } = require('./corpus');
+const { ensureBinaries, BACKEND_DIR } = require('./build');
+
+function parseArgs(argv) {
+  const args = {};
+  for (const a of argv) {
+    if (!a.startsWith('--')) continue;
+    const eq = a.indexOf('=');
+    if (eq === -1) args[a.slice(2)] = true;
+    else args[a.slice(2, eq)] = a.slice(eq + 1);
+  }
+  return args;
+}
+
+// Run a binary once with the corpus on stdin and return wall time in seconds
+function timeRun(binary, input) {
+  const start = process.hrtime.bigint();
+  const result = spawnSync(binary, [], { input, maxBuffer: 1024 * 1024 * 1024 });
+  const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+  if (result.error) throw result.error;
+  if (result.status !== 0 || result.signal) {
+    const how = result.signal ? `signal ${result.signal}` : `exit status ${result.status}`;
+    throw new Error(`${binary} failed with ${how}\n${result.stderr.toString().trim()}`);
+  }
+  return { seconds, stdout: result.stdout };
+}
+
+// Count token rows in the lexer's table output (everything between the header rule and footer)
+function countTokens(stdout) {
+  const text = stdout.toString();
+  const start = text.indexOf('-------|');
+  if (start === -1) return 0;
+  let count = 0;
+  let pos = text.indexOf('\n', start) + 1;
+  while (pos > 0 && pos < text.length && text[pos] !== '=') {
+    count++;
+    pos = text.indexOf('\n', pos) + 1;
+  }
+  return count;
+}
+
+function summarize(samples) {
+  const sorted = [...samples].sort((a, b) => a - b);
+  const mid = Math.floor(sorted.length / 2);
+  const median = sorted.length % 2 ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2;
+  const mean = samples.reduce((s, v) => s + v, 0) / samples.length;
+  return { min: sorted[0], median, mean, max: sorted[sorted.length - 1] };
+}
+
+function measure(binary, input, runs, warmup) {
+  for (let i = 0; i < warmup; i++) timeRun(binary, input);
+  const samples = [];
+  let stdout = null;
+  for (let i = 0; i < runs; i++) {
+    const run = timeRun(binary, input);
+    samples.push(run.seconds);
+    stdout = run.stdout;
+  }
+  return { times: summarize(samples), stdout };
+}
+
+function gitRevision() {
+  const result = spawnSync('git', ['rev-parse', '--short', 'HEAD'], { cwd: BACKEND_DIR, encoding: 'utf8' });
+  return result.status === 0 ? result.stdout.trim() : null;
+}
+
+function main() {
+  const args = parseArgs(process.argv.slice(2));
+  const size = parseSize(args.size || '1MB');
+  const runs = parseInt(args.runs || '5', 10);
+  const warmup = parseInt(args.warmup || '1', 10);
+  const seed = parseInt(args.seed || '1', 10);
+  const shapes = args.shapes ? args.shapes.split(',') : SHAPES;
+
+  const built = (args.lexer && args.parser) ? {} : ensureBinaries();
+  const lexer = args.lexer || built.lexer;
+  const parser = args.parser || built.parser;
+
+  const report = {
+    timestamp: new Date().toISOString(),
+    revision: gitRevision(),
+    host: { platform: process.platform, arch: process.arch, cpus: os.cpus().length },
+    config: { size, runs, warmup, seed },
+    results: [],
+  };
+
+  for (const shape of shapes) {
+    const { source, statements } = generate({ shape, size, seed });
+    const input = Buffer.from(source);
+    const mb = input.length / (1024 * 1024);
+
+    const lex = measure(lexer, input, runs, warmup);
+    const tokens = countTokens(lex.stdout);
+    const parse = measure(parser, input, runs, warmup);
+
+    const entry = {
+      shape,
+      bytes: input.length,
+      tokens,
+      statements,
+      lexer: {
+        seconds: lex.times,
+        mbPerSec: mb / lex.times.median,
+        tokensPerSec: tokens / lex.times.median,
+      },
+      parser: {
+        seconds: parse.times,
+        mbPerSec: mb / parse.times.median,
+        statementsPerSec: statements / parse.times.median,
+      },
+    };
+    report.results.push(entry);
+
+    if (!args.quiet) {
+      console.error(`${shape.padEnd(12)} lexer ${entry.lexer.mbPerSec.toFixed(2).padStart(8)} MB/s ` +
+        `${Math.round(entry.lexer.tokensPerSec).toString().padStart(10)} tok/s | ` +
+        `parser ${Math.round(entry.parser.statementsPerSec).toString().padStart(10)} stmt/s`);
+    }
+  }
+
+  const json = JSON.stringify(report, null, 2);
+  if (args.json) fs.writeFileSync(path.resolve(args.json), json + '\n');
+  else process.stdout.write(json + '\n');
+}
+
+main();
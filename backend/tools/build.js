@@ -0,0 +1,125 @@
+// -----------------------------
+//  NATIVE BUILD HELPER
+// -----------------------------
+// Compiles lexer.c and parser.c with the system gcc into backend/build/ so the
+// bench and test tools always run a binary that matches the current sources.
+// The language server (lsp/lsp.c) includes parser.c and is built alongside them.
+// --addon builds the Node-API modules in addon/ instead (build/cnack_*.node).
+// Usage: node tools/build.js [--cflags="-O2 -g"] [--out=build] [--addon]
+
+const path = require('path');
+const fs = require('fs');
+const { spawnSync } = require('child_process');
+
+const BACKEND_DIR = path.join(__dirname, '..');
+const EXE_SUFFIX = process.platform === 'win32' ? '.exe' : '';
+
+const TARGETS = {
+  lexer: { source: 'lexer.c', libs: ['-pthread'] },
+  parser: { source: 'parser.c', libs: ['-lm', '-pthread'] },
+  lsp: { source: 'lsp/lsp.c', deps: ['parser.c'], libs: ['-lm', '-pthread'] },
+};
+
+// The addons include lexer.c / parser.c, so they are rebuilt when either file changes
+const ADDONS = {
+  lexer: { source: 'addon/lexer_addon.c', deps: ['lexer.c'], libs: ['-pthread'] },
+  parser: { source: 'addon/parser_addon.c', deps: ['parser.c'], libs: ['-lm', '-pthread'] },
+};
+
+function binaryPath(name, outDir) {
+  return path.join(outDir || path.join(BACKEND_DIR, 'build'), name + EXE_SUFFIX);
+}
+
+// Rebuild a target only when its source (or a file it includes) is newer than the binary
+function buildTarget(name, options = {}) {
+  const target = TARGETS[name];
+  const outDir = options.outDir || path.join(BACKEND_DIR, 'build');
+  const sources = [target.source, ...(target.deps || [])].map((file) => path.join(BACKEND_DIR, file));
+  const output = binaryPath(name, outDir);
+  const cflags = options.cflags || ['-O2'];
+
+  fs.mkdirSync(outDir, { recursive: true });
+  if (!options.force && fs.existsSync(output) &&
+      sources.every((file) => fs.statSync(output).mtimeMs >= fs.statSync(file).mtimeMs)) {
+    return output;
+  }
+
+  const args = [...cflags, sources[0], '-o', output, ...target.libs];
+  const result = spawnSync('gcc', args, { encoding: 'utf8' });
+  if (result.error || result.status !== 0) {
+    const reason = result.error ? result.error.message : result.stderr;
+    throw new Error(`gcc failed for ${target.source}:\n${reason}`);
+  }
+  return output;
+}
+
+function addonPath(name, outDir) {
+  return path.join(outDir || path.join(BACKEND_DIR, 'build'), `cnack_${name}.node`);
+}
+
+// node_api.h ships with node: <prefix>/include/node, or the distribution's /usr/include/node
+function nodeIncludeDir() {
+  const candidates = [path.join(path.dirname(process.execPath), '..', 'include', 'node'), '/usr/include/node'];
+  const found = candidates.find((dir) => fs.existsSync(path.join(dir, 'node_api.h')));
+  if (!found) throw new Error(`node_api.h not found in ${candidates.join(' or ')}`);
+  return found;
+}
+
+function buildAddon(name, options = {}) {
+  if (process.platform === 'win32') throw new Error('The native addon is built with gcc and is not supported on Windows');
+  const addon = ADDONS[name];
+  const outDir = options.outDir || path.join(BACKEND_DIR, 'build');
+  const output = addonPath(name, outDir);
+  const cflags = options.cflags || ['-O2'];
+
+  fs.mkdirSync(outDir, { recursive: true });
+  const sources = [addon.source, ...addon.deps].map((file) => path.join(BACKEND_DIR, file));
+  if (!options.force && fs.existsSync(output) &&
+      sources.every((file) => fs.statSync(output).mtimeMs >= fs.statSync(file).mtimeMs)) {
+    return output;
+  }
+
+  // Hidden visibility binds the analyzers' own functions inside the module: libc also
+  // exports an advance(), which would otherwise replace the parser's. Node resolves
+  // the napi_* symbols when it loads the module.
+  const undefinedOk = process.platform === 'darwin' ? ['-undefined', 'dynamic_lookup'] : [];
+  const args = [...cflags, '-shared', '-fPIC', '-fvisibility=hidden', '-I', nodeIncludeDir(), sources[0], '-o', output,
+    ...undefinedOk, ...addon.libs];
+  const result = spawnSync('gcc', args, { encoding: 'utf8' });
+  if (result.error || result.status !== 0) {
+    const reason = result.error ? result.error.message : result.stderr;
+    throw new Error(`gcc failed for ${addon.source}:\n${reason}`);
+  }
+  return output;
+}
+
+function ensureBinaries(options = {}) {
+  return {
+    lexer: buildTarget('lexer', options),
+    parser: buildTarget('parser', options),
+    lsp: buildTarget('lsp', options),
+  };
+}
+
+function ensureAddons(options = {}) {
+  return {
+    lexer: buildAddon('lexer', options),
+    parser: buildAddon('parser', options),
+  };
+}
+
+module.exports = { ensureBinaries, ensureAddons, buildTarget, buildAddon, binaryPath, addonPath, BACKEND_DIR };
+
+if (require.main === module) {
+  const cflagsArg = process.argv.find((a) => a.startsWith('--cflags='));
+  const outArg = process.argv.find((a) => a.startsWith('--out='));
+  const options = {
+    force: true,
+    cflags: cflagsArg ? cflagsArg.slice(9).split(/\s+/).filter(Boolean) : undefined,
+    outDir: outArg ? path.resolve(outArg.slice(6)) : undefined,
+  };
+  const bins = process.argv.includes('--addon') ? ensureAddons(options) : ensureBinaries(options);
+  console.log(`Built lexer:  ${bins.lexer}`);
+  console.log(`Built parser: ${bins.parser}`);
+  if (bins.lsp) console.log(`Built lsp:    ${bins.lsp}`);
+}
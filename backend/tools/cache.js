@@ -0,0 +1,204 @@
+// -----------------------------
+//  RESULT CACHE
+// -----------------------------
+// Content-addressed cache for lexer/parser responses. Keys hash the tool, its mode
+// (binary version and arguments) and the submitted source, so identical submissions
+// are answered without spawning a process. Entries live in an in-memory LRU with a
+// byte budget and, optionally, in a directory that survives server restarts.
+
+const fs = require('fs');
+const fsp = fs.promises;
+const path = require('path');
+const crypto = require('crypto');
+
+// A prune runs this long after the disk tier first goes over budget, off the request path
+const PRUNE_DELAY_MS = 1000;
+
+class ResultCache {
+  constructor({ maxBytes = 64 * 1024 * 1024, dir = null, maxDiskBytes = 256 * 1024 * 1024, pruneDelayMs = PRUNE_DELAY_MS } = {}) {
+    this.maxBytes = maxBytes;
+    this.dir = dir;
+    this.maxDiskBytes = maxDiskBytes;
+    this.pruneDelayMs = pruneDelayMs;
+    this.entries = new Map(); // key -> { value, bytes }, oldest first
+    this.bytes = 0;
+    this.counters = { hits: 0, diskHits: 0, misses: 0, stores: 0, evictions: 0, diskEvictions: 0 };
+    this.disk = new Map(); // key -> bytes of its file, least recently used first
+    this.diskBytes = 0;
+    this.pruneTimer = null;
+    this.writes = 0;
+    // The directory is indexed once in the background; lookups wait for it, requests do not
+    this.diskReady = this.dir ? this.indexDisk() : Promise.resolve();
+  }
+
+  // sha1 is native in node and fast enough next to a process spawn; it also makes safe file names
+  key(tool, mode, source) {
+    return crypto.createHash('sha1').update(`${tool}\0${mode}\0`).update(source).digest('hex');
+  }
+
+  async get(key) {
+    const entry = this.entries.get(key);
+    if (entry) {
+      // Re-insert to mark as most recently used
+      this.entries.delete(key);
+      this.entries.set(key, entry);
+      this.counters.hits++;
+      return entry.value;
+    }
+    const value = await this.readDisk(key);
+    if (value !== undefined) {
+      this.counters.diskHits++;
+      this.remember(key, value);
+      return value;
+    }
+    this.counters.misses++;
+    return undefined;
+  }
+
+  // The disk write finishes in the background
+  set(key, value) {
+    this.counters.stores++;
+    const text = this.remember(key, value);
+    if (this.dir && text) this.writeDisk(key, text);
+  }
+
+  // Insert into the memory tier, evicting least recently used entries over the budget
+  remember(key, value) {
+    const text = JSON.stringify(value);
+    const bytes = Buffer.byteLength(text) + key.length;
+    if (bytes > this.maxBytes) return text;
+    const old = this.entries.get(key);
+    if (old) {
+      this.bytes -= old.bytes;
+      this.entries.delete(key);
+    }
+    this.entries.set(key, { value, bytes });
+    this.bytes += bytes;
+    for (const [oldest, entry] of this.entries) {
+      if (this.bytes <= this.maxBytes) break;
+      this.entries.delete(oldest);
+      this.bytes -= entry.bytes;
+      this.counters.evictions++;
+    }
+    return text;
+  }
+
+  // -----------------------------
+  //  DISK TIER
+  // -----------------------------
+  // this.disk mirrors the directory, so lookups, writes and prunes never list or stat it.
+
+  diskPath(key) {
+    return path.join(this.dir, key.slice(0, 2), `${key}.json`);
+  }
+
+  async indexDisk() {
+    const files = [];
+    try {
+      await fsp.mkdir(this.dir, { recursive: true });
+      for (const sub of await fsp.readdir(this.dir, { withFileTypes: true })) {
+        if (!sub.isDirectory()) continue;
+        const subDir = path.join(this.dir, sub.name);
+        for (const name of await fsp.readdir(subDir)) {
+          if (!name.endsWith('.json')) continue;
+          const stat = await fsp.stat(path.join(subDir, name));
+          files.push({ key: name.slice(0, -'.json'.length), size: stat.size, mtimeMs: stat.mtimeMs });
+        }
+      }
+    } catch (e) {
+      console.error(`[cache] could not index ${this.dir}: ${e.message}`);
+    }
+    files.sort((a, b) => a.mtimeMs - b.mtimeMs);
+    for (const f of files) this.trackDisk(f.key, f.size);
+    this.schedulePrune();
+  }
+
+  // Record a file of `bytes` for key as the most recently used one
+  trackDisk(key, bytes) {
+    this.forgetDisk(key);
+    this.disk.set(key, bytes);
+    this.diskBytes += bytes;
+  }
+
+  forgetDisk(key) {
+    const bytes = this.disk.get(key);
+    if (bytes === undefined) return;
+    this.disk.delete(key);
+    this.diskBytes -= bytes;
+  }
+
+  async readDisk(key) {
+    if (!this.dir) return undefined;
+    await this.diskReady;
+    if (!this.disk.has(key)) return undefined;
+    const file = this.diskPath(key);
+    try {
+      const value = JSON.parse(await fsp.readFile(file, 'utf8'));
+      this.trackDisk(key, this.disk.get(key));
+      const now = new Date();
+      fsp.utimes(file, now, now).catch(() => {}); // mtime orders the index after a restart
+      return value;
+    } catch (e) {
+      this.forgetDisk(key);
+      return undefined;
+    }
+  }
+
+  // Write through a temporary name so a concurrent reader never sees half a file
+  async writeDisk(key, text) {
+    await this.diskReady;
+    const file = this.diskPath(key);
+    const temporary = `${file}.${process.pid}.${++this.writes}.tmp`;
+    try {
+      await fsp.mkdir(path.dirname(file), { recursive: true });
+      await fsp.writeFile(temporary, text);
+      await fsp.rename(temporary, file);
+      this.trackDisk(key, Buffer.byteLength(text));
+      this.schedulePrune();
+    } catch (e) {
+      fsp.rm(temporary, { force: true }).catch(() => {});
+      console.error(`[cache] could not write ${file}: ${e.message}`);
+    }
+  }
+
+  schedulePrune() {
+    if (this.pruneTimer || this.diskBytes <= this.maxDiskBytes) return;
+    this.pruneTimer = setTimeout(() => {
+      this.pruneDisk().catch((e) => console.error(`[cache] could not prune ${this.dir}: ${e.message}`))
+        .finally(() => { this.pruneTimer = null; });
+    }, this.pruneDelayMs);
+    this.pruneTimer.unref();
+  }
+
+  // Drop the least recently used files until the directory is back under 90% of its budget
+  async pruneDisk() {
+    for (const [key, bytes] of this.disk) {
+      if (this.diskBytes <= this.maxDiskBytes * 0.9) break;
+      this.disk.delete(key);
+      this.diskBytes -= bytes;
+      this.counters.diskEvictions++;
+      await fsp.rm(this.diskPath(key), { force: true });
+    }
+  }
+
+  stats() {
+    const lookups = this.counters.hits + this.counters.diskHits + this.counters.misses;
+    return {
+      ...this.counters,
+      hitRate: lookups ? (this.counters.hits + this.counters.diskHits) / lookups : 0,
+      entries: this.entries.size,
+      bytes: this.bytes,
+      maxBytes: this.maxBytes,
+      disk: this.dir ? { dir: this.dir, bytes: this.diskBytes, maxBytes: this.maxDiskBytes } : null,
+    };
+  }
+}
+
+// The mode of a binary run: its size and mtime, so a rebuild changes every key, and its
+// arguments without the --cache options, which only say where the binary keeps state
+function binaryMode(executablePath, args) {
+  const binary = fs.statSync(executablePath);
+  return [binary.size, binary.mtimeMs, ...args.filter((a) => !a.startsWith('--cache'))].join(' ');
+}
+
+module.exports = { ResultCache, binaryMode };
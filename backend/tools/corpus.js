@@ -0,0 +1,199 @@
+// -----------------------------
+//  CNACK CORPUS GENERATOR
+// -----------------------------
+// Emits synthetic CNACK programs of a chosen shape and approximate size.
+// Output is deterministic for a given seed so runs can be compared over time.
+// Usage: node tools/corpus.js --shape=loops --size=1MB [--seed=42] [--out=file]
+
+const fs = require('fs');
+
+const SHAPES = ['identifiers', 'comments', 'strings', 'nested', 'loops', 'errors'];
+
+// Small seeded PRNG (mulberry32) so corpora are reproducible
+function createRng(seed) {
+  let state = seed >>> 0;
+  const next = () => {
+    state = (state + 0x6D2B79F5) >>> 0;
+    let t = state;
+    t = Math.imul(t ^ (t >>> 15), t | 1);
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+  return {
+    next,
+    int: (min, max) => min + Math.floor(next() * (max - min + 1)),
+    pick: (list) => list[Math.floor(next() * list.length)],
+  };
+}
+
+const WORDS = ['alpha', 'beta', 'gamma', 'delta', 'total', 'count', 'score', 'level',
+  'index', 'value', 'bonus', 'grade', 'limit', 'offset', 'result', 'buffer'];
+
+function identifier(rng) {
+  return `${rng.pick(WORDS)}_${rng.pick(WORDS)}${rng.int(0, 999)}`;
+}
+
+function sentence(rng, words) {
+  const out = [];
+  for (let i = 0; i < words; i++) out.push(rng.pick(WORDS));
+  return out.join(' ');
+}
+
+// -----------------------------
+//  SHAPE GENERATORS
+// -----------------------------
+// Each generator returns { text, statements } for one chunk of the body.
+// Variable names are drawn from a small pool so the parser's symbol table
+// (MAX_SYMBOLS) is never exhausted on large corpora.
+
+const generators = {
+  identifiers(rng, ctx) {
+    const a = ctx.vars[rng.int(0, ctx.vars.length - 1)];
+    const b = ctx.vars[rng.int(0, ctx.vars.length - 1)];
+    const c = ctx.vars[rng.int(0, ctx.vars.length - 1)];
+    return { text: `    ${a} = ${b} + ${c} - ${identifier(rng)};\n`, statements: 1 };
+  },
+
+  comments(rng) {
+    if (rng.next() < 0.5) {
+      return { text: `    // ${sentence(rng, rng.int(4, 12))}\n`, statements: 0 };
+    }
+    const lines = [];
+    for (let i = rng.int(2, 5); i > 0; i--) lines.push(`       ${sentence(rng, rng.int(3, 9))}`);
+    return { text: `    /* ${lines.join('\n').trim()}\n    */\n    count = count + 1;\n`, statements: 1 };
+  },
+
+  strings(rng, ctx) {
+    const v = ctx.vars[rng.int(0, ctx.vars.length - 1)];
+    if (rng.next() < 0.5) {
+      return { text: `    msg = "${sentence(rng, rng.int(3, 10))}";\n`, statements: 1 };
+    }
+    return { text: `    display("${sentence(rng, rng.int(2, 6))} {${v}}");\n`, statements: 1 };
+  },
+
+  nested(rng, ctx) {
+    const depth = rng.int(4, ctx.maxDepth);
+    let text = '';
+    let indent = '    ';
+    for (let d = 0; d < depth; d++) {
+      text += `${indent}if (count > ${d}) {\n`;
+      indent += '    ';
+    }
+    text += `${indent}count = count + 1;\n`;
+    for (let d = depth - 1; d >= 0; d--) {
+      indent = indent.slice(4);
+      text += `${indent}}\n`;
+    }
+    return { text, statements: depth + 1 };
+  },
+
+  loops(rng) {
+    const n = rng.int(2, 8);
+    if (rng.next() < 0.5) {
+      return {
+        text: `    for (int i = 0; i < ${n}; i++) {\n        total += i;\n    }\n`,
+        statements: 2,
+      };
+    }
+    return {
+      text: `    w = 0;\n    while (w < ${n}) {\n        w++;\n        total += 2;\n    }\n`,
+      statements: 4,
+    };
+  },
+
+  errors(rng) {
+    const bad = rng.pick(['@', '#', '$', '`', '\\', '?']);
+    const name = identifier(rng);
+    return { text: `    int ${name} ${bad} ${rng.int(0, 99)};\n`, statements: 1 };
+  },
+};
+
+function generate({ shape = 'identifiers', size = 64 * 1024, seed = 1 } = {}) {
+  if (!generators[shape]) throw new Error(`Unknown shape '${shape}'. Use one of: ${SHAPES.join(', ')}`);
+  const rng = createRng(seed);
+  const ctx = { vars: [], maxDepth: 24 };
+  for (let i = 0; i < 16; i++) ctx.vars.push(`v${i}_${rng.pick(WORDS)}`);
+
+  const parts = [`// Generated CNACK corpus: shape=${shape} seed=${seed}\n\nexecute() {\n`];
+  let statements = 0;
+  let bytes = parts[0].length;
+
+  // Declarations used by every shape
+  const decls = [
+    '    int count = 0;\n',
+    '    int total = 0;\n',
+    '    int w = 0;\n',
+    '    string msg = "start";\n',
+    ...ctx.vars.map((v, i) => `    int ${v} = ${i};\n`),
+  ];
+  for (const d of decls) { parts.push(d); bytes += d.length; statements++; }
+
+  const footer = '\n    exit();\n}\n';
+  while (bytes + footer.length < size) {
+    const chunk = generators[shape](rng, ctx);
+    parts.push(chunk.text);
+    bytes += chunk.text.length;
+    statements += chunk.statements;
+  }
+  parts.push(footer);
+  statements++;
+
+  return { source: parts.join(''), statements };
+}
+
+// -----------------------------
+//  FUZZ PROGRAMS
+// -----------------------------
+// Small random programs for regression and differential testing: snippets from
+// every terminating shape, then byte-level mutations that break quotes, comments
+// and operators. Loops are left out so a mutated condition can never spin forever.
+
+const MUTATION_BYTES = ['"', "'", '/*', '*/', '//', '{', '}', '(', ')', ';', '@', '#',
+  '===', '*|', '->', '&&', '||', '++', '\n', ' ', '0', '1.5', 'x', 'display', 'int '];
+
+function fuzzProgram(seed, { snippets = 12, mutations = 6 } = {}) {
+  const rng = createRng(seed);
+  const ctx = { vars: ['count', 'total', 'w', 'msg'], maxDepth: 6 };
+  const shapes = SHAPES.filter((s) => s !== 'loops');
+
+  let body = '';
+  for (let i = 0; i < snippets; i++) body += generators[rng.pick(shapes)](rng, ctx).text;
+  let source = `execute() {\n    int count = 1;\n    int total = 2;\n${body}    exit();\n}\n`;
+
+  for (let i = rng.int(0, mutations); i > 0; i--) {
+    const at = rng.int(0, source.length);
+    if (rng.next() < 0.6) {
+      source = source.slice(0, at) + rng.pick(MUTATION_BYTES) + source.slice(at);
+    } else {
+      source = source.slice(0, at) + source.slice(at + rng.int(1, 8));
+    }
+  }
+  return source;
+}
+
+function parseSize(text) {
+  const match = /^(\d+(?:\.\d+)?)\s*(b|kb|k|mb|m)?$/i.exec(String(text).trim());
+  if (!match) throw new Error(`Invalid size '${text}'`);
+  const unit = (match[2] || 'b').toLowerCase();
+  const scale = unit.startsWith('m') ? 1024 * 1024 : unit.startsWith('k') ? 1024 : 1;
+  return Math.floor(parseFloat(match[1]) * scale);
+}
+
+module.exports = { generate, fuzzProgram, parseSize, createRng, SHAPES };
+
+if (require.main === module) {
+  const args = Object.fromEntries(process.argv.slice(2)
+    .filter((a) => a.startsWith('--'))
+    .map((a) => { const [k, v] = a.slice(2).split('='); return [k, v === undefined ? true : v]; }));
+  const { source, statements } = generate({
+    shape: args.shape || 'identifiers',
+    size: parseSize(args.size || '64KB'),
+    seed: parseInt(args.seed || '1', 10),
+  });
+  if (args.out) {
+    fs.writeFileSync(args.out, source);
+    console.error(`Wrote ${source.length} bytes (${statements} statements) to ${args.out}`);
+  } else {
+    process.stdout.write(source);
+  }
+}
@@ -0,0 +1,1020 @@
+// -----------------------------
+//  GOLDEN OUTPUT REGRESSION TESTS
+// -----------------------------
+// Runs the lexer and parser over tests/*.txt and tests/fuzz/*.txt and compares the
+// exact output against tests/golden/. Any change to the token table or to the
+// "[Syntax Error]" and "[Type Error]" diagnostics shows up as a failing case. Each case is also
+// edited at random places to check that `lexer --incremental` matches a full relex
+// and that `parser --cache` matches a parse without the cache, and lexed in tiny
+// parallel chunks, with `--columns` and through `--stream` in tiny reads to check that
+// all of them match a serial lex; `--semantic-tokens` must encode the same spans. Runs
+// that fill and then load `--cache-dir` must print what uncached runs print, and
+// `--diagnostics=json` must carry the same reports as the text output. Programs
+// that parse are also translated with `parser --emit-c`, built with gcc and run against
+// the interpreter's output. Every case is parsed again with `--no-jit`, also under small
+// step budgets, to check that compiled hot loops change nothing. The language server
+// must publish the parser's diagnostics while a case is edited through it, and place
+// semantic tokens where the lexer does. When the native addon builds, its lexer and
+// parser output is compared with the binaries too. The server's helper modules (the
+// analyzer scheduler, the result cache, the NDJSON record streams and the --files-from
+// frame parser) are checked on their own, without starting the server.
+//
+// Usage:
+//   node tools/golden.js                      check every case (exit 1 on mismatch)
+//   node tools/golden.js --update             rewrite the golden files from the current build
+//   node tools/golden.js --regen-fuzz         regenerate tests/fuzz/ from seeds (then --update)
+//   node tools/golden.js --differential --old-rev=HEAD~1 [--cases=500] [--seed=1]
+//   node tools/golden.js --differential --old-lexer=a --old-parser=b [--new-lexer=c --new-parser=d]
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { spawn, spawnSync } = require('child_process');
+const { fuzzProgram, createRng, generate, SHAPES } = require('./corpus');
+const { parseTokenStream, formatTokenStream, parseDelta, applyDelta, parseSemanticTokens } = require('./tokens');
+const { ensureBinaries, ensureAddons, BACKEND_DIR } = require('./build');
+const { Scheduler } = require('./scheduler');
+const { ResultCache, binaryMode } = require('./cache');
+const { RecordStream, lexerRecord, parserRecord, parseBatchOutput } = require('./records');
+
+const TESTS_DIR = path.join(BACKEND_DIR, '..', 'tests');
+const FUZZ_DIR = path.join(TESTS_DIR, 'fuzz');
+const GOLDEN_DIR = path.join(TESTS_DIR, 'golden');
+const FUZZ_CASES = 24;
+const RUN_TIMEOUT_MS = 10000;
+const EDITS_PER_CASE = 4;
+const EDIT_TEXTS = ['', 'x', ' ', '\n', '"', '/*', '*/', '//', '1.', '.5', '+', '=', 'int y = 2;\n', '}'];
+
+function parseArgs(argv) {
+  const args = {};
+  for (const a of argv) {
+    if (!a.startsWith('--')) continue;
+    const eq = a.indexOf('=');
+    if (eq === -1) args[a.slice(2)] = true;
+    else args[a.slice(2, eq)] = a.slice(eq + 1);
+  }
+  return args;
+}
+
+function run(binary, input, args = []) {
+  const result = spawnSync(binary, args, { input, timeout: RUN_TIMEOUT_MS, maxBuffer: 256 * 1024 * 1024 });
+  if (result.error && result.error.code === 'ETIMEDOUT') return '<<TIMEOUT>>\n';
+  if (result.error) throw result.error;
+  let out = result.stdout.toString();
+  if (result.status !== 0) out += `<<EXIT ${result.status === null ? result.signal : result.status}>>\n`;
+  return out;
+}
+
+function listCases() {
+  const cases = [];
+  for (const dir of [TESTS_DIR, FUZZ_DIR]) {
+    if (!fs.existsSync(dir)) continue;
+    for (const file of fs.readdirSync(dir).sort()) {
+      if (file.endsWith('.txt')) cases.push({ name: path.basename(file, '.txt'), file: path.join(dir, file) });
+    }
+  }
+  return cases;
+}
+
+// Print the first few differing lines so a failure is readable without extra tools
+function describeDiff(expected, actual) {
+  const a = expected.split('\n');
+  const b = actual.split('\n');
+  const lines = [];
+  for (let i = 0; i < Math.max(a.length, b.length) && lines.length < 8; i++) {
+    if (a[i] !== b[i]) {
+      lines.push(`    line ${i + 1}:`);
+      lines.push(`      - ${a[i] === undefined ? '<missing>' : a[i]}`);
+      lines.push(`      + ${b[i] === undefined ? '<missing>' : b[i]}`);
+    }
+  }
+  return lines.join('\n');
+}
+
+// The "[Kind] Line N: message" lines of a parser run, before its summary
+function diagnosticLines(output) {
+  const lines = [];
+  for (const line of output.split('\n')) {
+    if (line.startsWith('>>> SYNTAX ANALYSIS')) break;
+    if (/^\[[A-Za-z ]+\] Line -?\d+: /.test(line)) lines.push(line);
+  }
+  return lines;
+}
+
+function regenerateFuzz() {
+  fs.mkdirSync(FUZZ_DIR, { recursive: true });
+  for (let seed = 1; seed <= FUZZ_CASES; seed++) {
+    const name = `fuzz-${String(seed).padStart(3, '0')}.txt`;
+    fs.writeFileSync(path.join(FUZZ_DIR, name), fuzzProgram(seed));
+  }
+  console.log(`Wrote ${FUZZ_CASES} fuzz cases to ${FUZZ_DIR}`);
+}
+
+function checkGoldens(bins, update) {
+  fs.mkdirSync(GOLDEN_DIR, { recursive: true });
+  let failures = 0;
+  let total = 0;
+  let seed = 0;
+
+  for (const c of listCases()) {
+    const input = fs.readFileSync(c.file);
+    if (!update) {
+      const incremental = checkIncremental(bins, c.name, input, ++seed);
+      total++;
+      if (incremental.length) {
+        failures++;
+        console.log(incremental.join('\n'));
+      }
+    }
+    for (const [tool, binary] of [['lexer', bins.lexer], ['parser', bins.parser]]) {
+      const goldenFile = path.join(GOLDEN_DIR, `${c.name}.${tool}.out`);
+      const actual = run(binary, input);
+      total++;
+
+      if (update) {
+        fs.writeFileSync(goldenFile, actual);
+        continue;
+      }
+      if (!fs.existsSync(goldenFile)) {
+        failures++;
+        console.log(`MISSING ${c.name} (${tool}): run with --update to create ${path.relative(process.cwd(), goldenFile)}`);
+        continue;
+      }
+      const expected = fs.readFileSync(goldenFile, 'utf8');
+      if (expected !== actual) {
+        failures++;
+        console.log(`FAIL    ${c.name} (${tool})\n${describeDiff(expected, actual)}`);
+      }
+    }
+  }
+
+  if (update) {
+    console.log(`Updated ${total} golden files in ${GOLDEN_DIR}`);
+    return 0;
+  }
+  console.log(`\n${total - failures}/${total} golden cases passed`);
+  return failures ? 1 : 0;
+}
+
+// -----------------------------
+//  SEMANTIC TOKENS CHECK
+// -----------------------------
+// `lexer --semantic-tokens` must encode the spans of `--emit-tokens`: computed here from
+// the byte offsets, split at newlines, with lines and columns counted in UTF-16 units.
+
+function semanticClass(type) {
+  if (/^(COMMA|SEMICOLON|COLON|[LR]_(PAREN|BRACE|BRACKET))$/.test(type)) return 'punctuation';
+  if (type.endsWith('_OP')) return 'operator';
+  if (type === 'IDENTIFIER') return 'variable';
+  if (type.startsWith('NUMBER_')) return 'number';
+  if (type === 'STRING') return 'string';
+  if (type.startsWith('TYPE_')) return 'type';
+  if (type === 'RW_AUTO_REF') return 'builtin';
+  if (type.startsWith('KW_') || type.startsWith('RW_')) return 'keyword';
+  if (type.endsWith('_COMMENT')) return 'comment';
+  return 'error';
+}
+
+function expectedSemanticTokens(input, stream) {
+  const rows = [];
+  let line = 0;
+  let lineStart = 0;
+  let lastLine = 0;
+  let lastColumn = 0;
+  let at = 0;
+  for (const token of stream.tokens) {
+    if (token.type === 'EOF') continue;
+    const pieces = input.toString('utf8', token.offset, token.offset + token.length).split('\n');
+    for (; at < token.offset; at++) {
+      if (input[at] === 10) {
+        line++;
+        lineStart = at + 1;
+      }
+    }
+    pieces.forEach((piece, i) => {
+      if (i > 0) line++;
+      const column = i === 0 ? input.toString('utf8', lineStart, token.offset).length : 0;
+      if (piece.length === 0) return;
+      rows.push(`${line - lastLine} ${line === lastLine ? column - lastColumn : column} ${piece.length} ${semanticClass(token.type)}`);
+      lastLine = line;
+      lastColumn = column;
+    });
+    for (; at < token.offset + token.length; at++) {
+      if (input[at] === 10) lineStart = at + 1; // lines inside the token were counted above
+    }
+  }
+  return rows.join('\n');
+}
+
+function semanticRows(text) {
+  const { legend, data } = parseSemanticTokens(text);
+  const rows = [];
+  for (let i = 0; i < data.length; i += 4) rows.push(`${data[i]} ${data[i + 1]} ${data[i + 2]} ${legend[data[i + 3]]}`);
+  return rows.join('\n');
+}
+
+// -----------------------------
+//  INCREMENTAL LEXING AND PARSING CHECK
+// -----------------------------
+// Applies seeded random edits to a case and compares the old stream plus the
+// --incremental delta against --emit-tokens on the edited source, and a parse
+// that starts from the original's --cache against a parse from scratch.
+
+function checkIncremental(bins, name, input, seed) {
+  const failures = [];
+  const streamFile = path.join(os.tmpdir(), `cnack-tokens-${process.pid}.txt`);
+  const cacheFile = path.join(os.tmpdir(), `cnack-parse-${process.pid}.bin`);
+  const editedCache = `${cacheFile}.edit`;
+  const cacheDir = path.join(os.tmpdir(), `cnack-cache-${process.pid}`);
+  const rng = createRng(seed);
+  const before = run(bins.lexer, input, ['--emit-tokens']);
+  fs.writeFileSync(streamFile, before);
+
+  // Tiny chunks start inside comments and strings, which stitching the chunks must repair
+  const chunked = run(bins.lexer, input, ['--emit-tokens', '--jobs=4', '--chunk-bytes=16']);
+  if (chunked !== before) failures.push(`FAIL    ${name} (lexer --jobs)\n${describeDiff(before, chunked)}`);
+  // --columns resolves lines from a line index instead of counting them while scanning
+  const lazy = run(bins.lexer, input, ['--emit-tokens', '--columns']);
+  if (lazy !== before) failures.push(`FAIL    ${name} (lexer --columns)\n${describeDiff(before, lazy)}`);
+  // Columns are UTF-16 units of the decoded text, so only valid UTF-8 has one right answer
+  if (Buffer.from(input.toString()).equals(input)) {
+    const expected = expectedSemanticTokens(input, parseTokenStream(before));
+    const actual = semanticRows(run(bins.lexer, input, ['--semantic-tokens']));
+    if (actual !== expected) failures.push(`FAIL    ${name} (lexer --semantic-tokens)\n${describeDiff(expected, actual)}`);
+  }
+  // Tiny reads make tokens, comments and strings straddle refills of the stream buffer
+  const table = run(bins.lexer, input);
+  const streamed = run(bins.lexer, input, ['--stream', '--stream-block=7']);
+  if (streamed !== table) failures.push(`FAIL    ${name} (lexer --stream)\n${describeDiff(table, streamed)}`);
+
+  // A mutated loop may never end; a small budget keeps both parser runs short and identical
+  const parserArgs = ['--max-steps=100000'];
+  fs.rmSync(cacheFile, { force: true });
+  const parsed = run(bins.parser, input, parserArgs);
+  for (const pass of ['cold', 'warm']) {
+    const cached = run(bins.parser, input, [...parserArgs, `--cache=${cacheFile}`]);
+    if (cached !== parsed) failures.push(`FAIL    ${name} (parser --cache, ${pass})\n${describeDiff(parsed, cached)}`);
+  }
+
+  // --diagnostics=json must report what the text output shows
+  const report = JSON.parse(run(bins.parser, input, [...parserArgs, '--diagnostics=json']));
+  const shown = diagnosticLines(parsed).join('\n');
+  const rendered = report.diagnostics.map((d) => `[${d.kind}] Line ${d.line}: ${d.message}`).join('\n');
+  if (rendered !== shown || report.success !== parsed.includes('PARSING SUCCESSFUL')) {
+    failures.push(`FAIL    ${name} (parser --diagnostics=json)\n${describeDiff(shown, rendered)}`);
+  }
+
+  // The first run fills the content-addressed cache, the second one loads from it
+  fs.rmSync(cacheDir, { recursive: true, force: true });
+  const columns = run(bins.lexer, input, ['--columns']);
+  for (const pass of ['cold', 'warm']) {
+    const tokens = run(bins.lexer, input, ['--emit-tokens', `--cache-dir=${cacheDir}`]);
+    if (tokens !== before) failures.push(`FAIL    ${name} (lexer --cache-dir, ${pass})\n${describeDiff(before, tokens)}`);
+    const located = run(bins.lexer, input, ['--columns', `--cache-dir=${cacheDir}`]);
+    if (located !== columns) failures.push(`FAIL    ${name} (lexer --columns --cache-dir, ${pass})\n${describeDiff(columns, located)}`);
+    const cached = run(bins.parser, input, [...parserArgs, `--cache-dir=${cacheDir}`]);
+    if (cached !== parsed) failures.push(`FAIL    ${name} (parser --cache-dir, ${pass})\n${describeDiff(parsed, cached)}`);
+  }
+
+  for (let i = 0; i < EDITS_PER_CASE; i++) {
+    const offset = rng.int(0, input.length);
+    const removed = Math.min(rng.int(0, 6), input.length - offset);
+    const inserted = Buffer.from(rng.pick(EDIT_TEXTS));
+    const edited = Buffer.concat([input.subarray(0, offset), inserted, input.subarray(offset + removed)]);
+    if (edited.length === 0) continue;
+
+    const edit = `--edit=${offset},${removed},${inserted.length}`;
+    const expected = run(bins.lexer, edited, ['--emit-tokens']);
+    const deltaText = run(bins.lexer, edited, [`--incremental=${streamFile}`, edit]);
+    let actual;
+    try {
+      actual = formatTokenStream(applyDelta(parseTokenStream(before), parseDelta(deltaText), edited.length));
+    } catch (e) {
+      actual = `<<${e.message}>>\n${deltaText}`;
+    }
+    if (actual !== expected) {
+      failures.push(`FAIL    ${name} (incremental ${edit} inserting ${JSON.stringify(inserted.toString())})\n` +
+        describeDiff(expected, actual));
+    }
+
+    if (fs.existsSync(cacheFile)) fs.copyFileSync(cacheFile, editedCache);
+    else fs.rmSync(editedCache, { force: true });
+    const reparsed = run(bins.parser, edited, [...parserArgs, `--cache=${editedCache}`]);
+    const fresh = run(bins.parser, edited, parserArgs);
+    if (reparsed !== fresh) {
+      failures.push(`FAIL    ${name} (parser --cache ${edit} inserting ${JSON.stringify(inserted.toString())})\n` +
+        describeDiff(fresh, reparsed));
+    }
+  }
+  for (const file of [streamFile, cacheFile, editedCache, cacheDir]) fs.rmSync(file, { recursive: true, force: true });
+  return failures;
+}
+
+// -----------------------------
+//  NATIVE ADDON CHECK
+// -----------------------------
+// The in-process lexer and parser must print exactly what the binaries print. Every
+// case is submitted at once, so several run on the libuv thread pool together.
+
+async function checkAddons(bins) {
+  let addon;
+  try {
+    ensureAddons();
+    addon = require('../addon');
+  } catch (e) {
+    console.log(`SKIP    addon: ${e.message.split('\n')[0]}`);
+    return 0;
+  }
+  if (!addon.lexer || !addon.parser) {
+    console.log('SKIP    addon: the modules could not be loaded');
+    return 0;
+  }
+
+  const cases = listCases();
+  const results = await Promise.all(cases.map((c) => {
+    const input = fs.readFileSync(c.file);
+    return Promise.all([addon.lexer.lex(input), addon.lexer.lex(input, { columns: true }), addon.parser.parse(input)]);
+  }));
+
+  let failures = 0;
+  cases.forEach((c, i) => {
+    const input = fs.readFileSync(c.file);
+    const [table, columns, parsed] = results[i];
+    const expected = [
+      ['lexer', run(bins.lexer, input), table.output],
+      ['lexer --columns', run(bins.lexer, input, ['--columns']), columns.output],
+      ['parser', run(bins.parser, input), parsed.output],
+    ];
+    for (const [mode, binary, inProcess] of expected) {
+      if (binary !== inProcess) {
+        failures++;
+        console.log(`FAIL    ${c.name} (addon ${mode})\n${describeDiff(binary, inProcess)}`);
+      }
+    }
+  });
+  console.log(`${cases.length * 3 - failures}/${cases.length * 3} addon cases passed`);
+  return failures ? 1 : 0;
+}
+
+// -----------------------------
+//  C BACKEND CHECK
+// -----------------------------
+// Every case the interpreter runs without errors, and one generated program per corpus
+// shape, is translated with `parser --emit-c`, compiled with gcc and run. It must print
+// exactly what the interpreter shows under [PROGRAM OUTPUT].
+
+const OUTPUT_HEADER = '\n[PROGRAM OUTPUT]\n';
+const OUTPUT_FOOTER = '\n----------------------------------------\n';
+
+function programOutput(parsed) {
+  const start = parsed.indexOf(OUTPUT_HEADER);
+  return start === -1 ? '' : parsed.slice(start + OUTPUT_HEADER.length, parsed.lastIndexOf(OUTPUT_FOOTER));
+}
+
+function checkEmitC(bins) {
+  const programs = listCases().map((c) => ({ name: c.name, input: fs.readFileSync(c.file) }));
+  for (const shape of SHAPES.filter((s) => s !== 'errors')) {
+    programs.push({ name: `corpus-${shape}`, input: Buffer.from(generate({ shape, size: 4096, seed: 1 }).source) });
+  }
+
+  const workDir = fs.mkdtempSync(path.join(os.tmpdir(), 'cnack-emit-c-'));
+  const source = path.join(workDir, 'program.c');
+  const program = path.join(workDir, process.platform === 'win32' ? 'program.exe' : 'program');
+  let failures = 0;
+  let checked = 0;
+  for (const p of programs) {
+    const interpreted = run(bins.parser, p.input);
+    if (!interpreted.includes('PARSING SUCCESSFUL')) continue;
+    checked++;
+
+    const emitted = spawnSync(bins.parser, ['--emit-c'], { input: p.input, maxBuffer: 64 * 1024 * 1024 });
+    if (emitted.status !== 0) {
+      failures++;
+      console.log(`FAIL    ${p.name} (parser --emit-c)\n    ${emitted.stderr.toString().split('\n')[0]}`);
+      continue;
+    }
+    fs.writeFileSync(source, emitted.stdout);
+    const cc = spawnSync('gcc', ['-O2', '-ffp-contract=off', source, '-o', program, '-lm'], { encoding: 'utf8' });
+    if (cc.status !== 0) {
+      failures++;
+      console.log(`FAIL    ${p.name} (gcc on --emit-c output)\n${cc.stderr}`);
+      continue;
+    }
+    const expected = programOutput(interpreted);
+    const actual = run(program, '');
+    if (actual !== expected) {
+      failures++;
+      console.log(`FAIL    ${p.name} (--emit-c)\n${describeDiff(expected, actual)}`);
+    }
+  }
+  fs.rmSync(workDir, { recursive: true, force: true });
+  console.log(`${checked - failures}/${checked} C backend cases passed`);
+  return failures ? 1 : 0;
+}
+
+// -----------------------------
+//  LOOP JIT CHECK
+// -----------------------------
+// The parser compiles hot loops to machine code unless it runs with `--no-jit`. Both
+// runs must print the same, also when a small step budget ends the program inside a
+// compiled loop (the budgets below stop test6_hot_loops in three different loops).
+
+const JIT_BUDGETS = [[], ['--max-steps=1000'], ['--max-steps=165000'], ['--max-steps=175000']];
+
+function checkJit(bins) {
+  const cases = listCases();
+  let failures = 0;
+  for (const c of cases) {
+    const input = fs.readFileSync(c.file);
+    for (const budget of JIT_BUDGETS) {
+      const compiled = run(bins.parser, input, budget);
+      const interpreted = run(bins.parser, input, [...budget, '--no-jit']);
+      if (compiled !== interpreted) {
+        failures++;
+        console.log(`FAIL    ${c.name} (parser ${[...budget, '--no-jit'].join(' ')})\n${describeDiff(interpreted, compiled)}`);
+      }
+    }
+  }
+  const total = cases.length * JIT_BUDGETS.length;
+  console.log(`${total - failures}/${total} loop JIT cases passed`);
+  return failures ? 1 : 0;
+}
+
+// -----------------------------
+//  LANGUAGE SERVER CHECK
+// -----------------------------
+// Every case is opened in one `lsp` process and edited at random places through
+// incremental didChange messages. After each edit the published diagnostics must be the
+// "[Kind] Line N: message" lines of the parser run over the edited text. The semantic
+// tokens of tests/*.txt must put every identifier and number where `lexer --columns`
+// does, and go-to-definition is checked on a known variable.
+
+const LSP_URI = 'file:///case.cnk';
+const LSP_LEGEND = ['keyword', 'type', 'function', 'variable', 'number', 'string', 'comment', 'operator'];
+// test5_emit_c: `count` on line 25 was declared on line 4
+const LSP_DEFINITION = { name: 'test5_emit_c', line: 24, character: 4, expected: { line: 3, character: 8, length: 5 } };
+
+function lspSession(binary, messages, args = []) {
+  const input = messages.map((m) => {
+    const body = Buffer.from(JSON.stringify({ jsonrpc: '2.0', ...m }));
+    return Buffer.concat([Buffer.from(`Content-Length: ${body.length}\r\n\r\n`), body]);
+  });
+  const result = spawnSync(binary, args, { input: Buffer.concat(input), timeout: RUN_TIMEOUT_MS * 4, maxBuffer: 256 * 1024 * 1024 });
+  if (result.error) throw result.error;
+  const out = result.stdout;
+  const replies = [];
+  for (let at = 0; at < out.length;) {
+    const headerEnd = out.indexOf('\r\n\r\n', at);
+    const length = parseInt(/Content-Length: (\d+)/.exec(out.toString('latin1', at, headerEnd))[1], 10);
+    replies.push(JSON.parse(out.toString('utf8', headerEnd + 4, headerEnd + 4 + length)));
+    at = headerEnd + 4 + length;
+  }
+  return { status: result.status, replies };
+}
+
+// The LSP position of a string offset: lines end at '\n', characters are UTF-16 units
+function lspPosition(text, offset) {
+  const before = text.slice(0, offset);
+  const lineStart = before.lastIndexOf('\n') + 1;
+  return { line: before.split('\n').length - 1, character: offset - lineStart };
+}
+
+// Diagnostics of a `parser --diagnostics=json` run as the language server should publish them
+function parserDiagnostics(output, lineCount) {
+  return JSON.parse(output).diagnostics
+    .map((d) => `${Math.min(Math.max(d.line - 1, 0), lineCount - 1)} [${d.code}] ${d.message}`).join('\n');
+}
+
+function publishedDiagnostics(reply) {
+  return reply.params.diagnostics.map((d) => `${d.range.start.line} [${d.code}] ${d.message}`).join('\n');
+}
+
+function checkLsp(bins, lsp) {
+  const parserArgs = ['--max-steps=100000'];
+  let failures = 0;
+  let total = 0;
+  let seed = 0;
+  const fail = (name, mode, expected, actual) => {
+    failures++;
+    console.log(`FAIL    ${name} (lsp ${mode})\n${describeDiff(expected, actual)}`);
+  };
+
+  for (const c of listCases()) {
+    const rng = createRng(++seed * 7919);
+    let text = fs.readFileSync(c.file, 'utf8');
+    const texts = [text];
+    const messages = [
+      { id: 1, method: 'initialize', params: {} },
+      { method: 'textDocument/didOpen', params: { textDocument: { uri: LSP_URI, languageId: 'cnack', version: 1, text } } },
+      { id: 2, method: 'textDocument/semanticTokens/full', params: { textDocument: { uri: LSP_URI } } },
+    ];
+    const definition = c.name === LSP_DEFINITION.name;
+    if (definition) {
+      messages.push({ id: 3, method: 'textDocument/definition',
+        params: { textDocument: { uri: LSP_URI }, position: { line: LSP_DEFINITION.line, character: LSP_DEFINITION.character } } });
+    }
+    for (let i = 0; i < EDITS_PER_CASE; i++) {
+      let start = rng.int(0, text.length);
+      if (start > 0 && start < text.length && /[\uDC00-\uDFFF]/.test(text[start])) start--;
+      let end = Math.min(start + rng.int(0, 6), text.length);
+      if (end < text.length && /[\uDC00-\uDFFF]/.test(text[end])) end++;
+      const inserted = rng.pick(EDIT_TEXTS);
+      const range = { start: lspPosition(text, start), end: lspPosition(text, end) };
+      messages.push({ method: 'textDocument/didChange',
+        params: { textDocument: { uri: LSP_URI, version: i + 2 }, contentChanges: [{ range, text: inserted }] } });
+      text = text.slice(0, start) + inserted + text.slice(end);
+      texts.push(text);
+    }
+    messages.push({ method: 'textDocument/didClose', params: { textDocument: { uri: LSP_URI } } },
+      { id: 4, method: 'shutdown' }, { method: 'exit' });
+
+    const { status, replies } = lspSession(lsp, messages, parserArgs);
+    total++;
+    if (status !== 0) fail(c.name, 'exit status', '0', String(status));
+
+    const published = replies.filter((r) => r.method === 'textDocument/publishDiagnostics');
+    texts.forEach((edited, i) => {
+      total++;
+      const report = run(bins.parser, Buffer.from(edited), [...parserArgs, '--diagnostics=json']);
+      const expected = parserDiagnostics(report, edited.split('\n').length);
+      const actual = published[i] ? publishedDiagnostics(published[i]) : '<no diagnostics published>';
+      if (actual !== expected) fail(c.name, i ? `diagnostics after edit ${i}` : 'diagnostics', expected, actual);
+    });
+    total++;
+    if (!published[texts.length] || published[texts.length].params.diagnostics.length !== 0) {
+      fail(c.name, 'didClose', 'empty diagnostics', JSON.stringify(published[texts.length]));
+    }
+
+    if (definition) {
+      total++;
+      const { line, character, length } = LSP_DEFINITION.expected;
+      const expected = JSON.stringify({ uri: LSP_URI, range: { start: { line, character }, end: { line, character: character + length } } });
+      const actual = JSON.stringify((replies.find((r) => r.id === 3) || {}).result);
+      if (actual !== expected) fail(c.name, 'definition', expected, actual);
+    }
+
+    if (path.dirname(c.file) !== TESTS_DIR) continue;
+    total++;
+    const source = texts[0];
+    const lines = source.split('\n');
+    const expected = [];
+    for (const row of run(bins.lexer, Buffer.from(source), ['--columns']).split('\n')) {
+      const cells = row.split(' | ').map((cell) => cell.trim());
+      if (!/^\d+$/.test(cells[0]) || !['IDENTIFIER', 'NUMBER_INT', 'NUMBER_FLOAT'].includes(cells[2])) continue;
+      const lineText = Buffer.from(lines[cells[0] - 1]);
+      const character = lineText.toString('utf8', 0, cells[1] - 1).length;
+      expected.push(`${cells[0] - 1}:${character} ${cells[3]}`);
+    }
+    // lexer.c reports `i++` and `&x` as invalid tokens where the parser's scanner does not, so
+    // tokens it has no row for only have to cover a whole word
+    const actual = new Set();
+    const data = ((replies.find((r) => r.id === 2) || {}).result || { data: [] }).data;
+    for (let i = 0, line = 0, character = 0; i < data.length; i += 5) {
+      line += data[i];
+      character = data[i] ? data[i + 1] : character + data[i + 1];
+      const kind = LSP_LEGEND[data[i + 3]];
+      const lexeme = lines[line].slice(character, character + data[i + 2]);
+      const token = `${line}:${character} ${lexeme}`;
+      if (!['variable', 'function', 'type', 'number'].includes(kind) || kind === 'type' && !/^[A-Z]/.test(lexeme)) continue;
+      actual.add(token);
+      const word = kind === 'number' ? /^\d+(\.\d+)?$/ : /^[A-Za-z_]\w*$/;
+      if (!word.test(lexeme) || /\w/.test(lines[line][character + lexeme.length] || '')) {
+        fail(c.name, 'semantic tokens', `a ${kind} token`, token);
+      }
+    }
+    const missing = expected.filter((token) => !actual.has(token));
+    if (missing.length) fail(c.name, 'semantic tokens', missing.join('\n'), '<no token>');
+  }
+  console.log(`${total - failures}/${total} language server cases passed`);
+  return failures ? 1 : 0;
+}
+
+// -----------------------------
+//  SERVER MODULE CHECKS
+// -----------------------------
+// Each case is an async function that throws (usually through expect()) when the module
+// misbehaves. Timers are real but a few milliseconds long.
+
+function expect(actual, expected, what) {
+  if (actual !== expected) throw new Error(`${what}: expected ${JSON.stringify(expected)}, got ${JSON.stringify(actual)}`);
+}
+
+function expectThrows(fn, pattern, what) {
+  try {
+    fn();
+  } catch (err) {
+    if (pattern.test(err.message)) return;
+    throw new Error(`${what}: threw '${err.message}'`);
+  }
+  throw new Error(`${what}: did not throw`);
+}
+
+const delay = (ms) => new Promise((resolve) => setTimeout(resolve, ms));
+
+// "resolved <value>" or the SchedulerError code the promise settles with
+const outcome = (promise) => promise.then((value) => `resolved ${value}`, (err) => err.code || err.message);
+
+const UNIT_TIMEOUT_MS = 2000;
+
+// A case that never settles fails instead of letting the process exit with nothing pending
+async function checkUnits(label, cases, context) {
+  let failures = 0;
+  for (const [name, test] of cases) {
+    let timer;
+    const timeout = new Promise((resolve, reject) => {
+      timer = setTimeout(() => reject(new Error(`did not finish within ${UNIT_TIMEOUT_MS} ms`)), UNIT_TIMEOUT_MS);
+    });
+    try {
+      await Promise.race([test(context), timeout]);
+    } catch (err) {
+      failures++;
+      console.log(`FAIL    ${label}: ${name}\n    ${err.message}`);
+    } finally {
+      clearTimeout(timer);
+    }
+  }
+  console.log(`${cases.length - failures}/${cases.length} ${label} cases passed`);
+  return failures ? 1 : 0;
+}
+
+// Poll until condition() holds, giving up with the case's time limit
+async function until(condition) {
+  const deadline = Date.now() + UNIT_TIMEOUT_MS;
+  while (!condition()) {
+    if (Date.now() > deadline) throw new Error('the expected state was never reached');
+    await delay(5);
+  }
+}
+
+// A job that ignores its signal and runs until release() is called
+function blockingJob() {
+  let release;
+  const done = new Promise((resolve) => { release = resolve; });
+  const job = (signal) => { job.signal = signal; return done; };
+  job.release = release;
+  return job;
+}
+
+// A job that ends as soon as its signal fires
+function abortableJob() {
+  const job = (signal) => {
+    job.signal = signal;
+    return new Promise((resolve) => {
+      if (signal.aborted) resolve('aborted');
+      signal.addEventListener('abort', () => resolve('aborted'));
+    });
+  };
+  return job;
+}
+
+const SCHEDULER_CASES = [
+  ['a full queue rejects the job', async () => {
+    const scheduler = new Scheduler({ concurrency: 1, maxQueue: 1, maxWaitMs: 0, runTimeoutMs: 0 });
+    const blocker = blockingJob();
+    const first = outcome(scheduler.run(blocker));
+    const queued = outcome(scheduler.run(() => 'queued'));
+    expect(await outcome(scheduler.run(() => 'extra')), 'QUEUE_FULL', 'job past maxQueue');
+    blocker.release('first');
+    expect(await first, 'resolved first', 'running job');
+    expect(await queued, 'resolved queued', 'queued job');
+    expect(scheduler.counters.rejected, 1, 'rejected counter');
+  }],
+  ['a queued job expires after maxWaitMs', async () => {
+    const scheduler = new Scheduler({ concurrency: 1, maxQueue: 4, maxWaitMs: 20, runTimeoutMs: 0 });
+    const blocker = blockingJob();
+    const first = outcome(scheduler.run(blocker));
+    let ran = false;
+    expect(await outcome(scheduler.run(() => { ran = true; })), 'QUEUE_TIMEOUT', 'queued job');
+    expect(scheduler.queue.length, 0, 'queue length after expiry');
+    blocker.release('first');
+    await first;
+    await delay(0);
+    expect(ran, false, 'expired job ran');
+    expect(scheduler.counters.expired, 1, 'expired counter');
+  }],
+  ['a run is killed at runTimeoutMs', async () => {
+    const scheduler = new Scheduler({ concurrency: 1, runTimeoutMs: 20 });
+    const job = abortableJob();
+    expect(await outcome(scheduler.run(job)), 'TIMEOUT', 'slow job');
+    expect(job.signal.aborted, true, 'job signal aborted');
+    expect(scheduler.counters.timedOut, 1, 'timedOut counter');
+  }],
+  ['the caller\'s signal aborts a running job', async () => {
+    const scheduler = new Scheduler({ concurrency: 1, runTimeoutMs: 0 });
+    const client = new AbortController();
+    const job = abortableJob();
+    const running = outcome(scheduler.run(job, { signal: client.signal }));
+    await delay(0);
+    client.abort();
+    expect(await running, 'CANCELLED', 'cancelled job');
+    expect(job.signal.aborted, true, 'job signal aborted');
+    await delay(0);
+    expect(scheduler.running, 0, 'running after the job ended');
+  }],
+  ['the caller\'s signal removes a queued job', async () => {
+    const scheduler = new Scheduler({ concurrency: 1, maxWaitMs: 0, runTimeoutMs: 0 });
+    const blocker = blockingJob();
+    const first = outcome(scheduler.run(blocker));
+    const client = new AbortController();
+    let ran = false;
+    const queued = outcome(scheduler.run(() => { ran = true; }, { signal: client.signal }));
+    client.abort();
+    expect(await queued, 'CANCELLED', 'queued job');
+    expect(scheduler.queue.length, 0, 'queue length after cancel');
+    blocker.release('first');
+    await first;
+    expect(ran, false, 'cancelled job ran');
+  }],
+  ['the slot is released only when a timed-out job settles', async () => {
+    const scheduler = new Scheduler({ concurrency: 1, runTimeoutMs: 20 });
+    const stubborn = blockingJob();
+    const first = outcome(scheduler.run(stubborn));
+    let started = false;
+    const next = outcome(scheduler.run(() => { started = true; return 'next'; }));
+    expect(await first, 'TIMEOUT', 'stubborn job');
+    await delay(10);
+    expect(stubborn.signal.aborted, true, 'job signal aborted');
+    expect(scheduler.running, 1, 'running while the job has not settled');
+    expect(started, false, 'next job started early');
+    stubborn.release();
+    expect(await next, 'resolved next', 'next job');
+    await delay(0);
+    expect(scheduler.running, 0, 'running after both jobs');
+  }],
+];
+
+// Results of equal size, so budgets can be given in entries
+const cacheResult = (i) => ({ success: true, output: `result ${i} `.padEnd(80, '.'), type: 'success' });
+
+async function withTempDir(test) {
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'cnack-module-check-'));
+  try {
+    await test(dir);
+  } finally {
+    fs.rmSync(dir, { recursive: true, force: true });
+  }
+}
+
+function cacheFiles(dir) {
+  return fs.readdirSync(dir).flatMap((sub) => fs.readdirSync(path.join(dir, sub)).filter((name) => name.endsWith('.json')));
+}
+
+const CACHE_CASES = [
+  ['the memory tier evicts the least recently used entries past maxBytes', async () => {
+    const entryBytes = JSON.stringify(cacheResult(0)).length + 40; // text and sha1 key
+    const cache = new ResultCache({ maxBytes: entryBytes * 3 });
+    const keys = [0, 1, 2, 3, 4].map((i) => cache.key('Parser', 'mode', `source ${i}`));
+    for (const i of [0, 1, 2]) cache.set(keys[i], cacheResult(i));
+    expect((await cache.get(keys[0])).output, cacheResult(0).output, 'entry 0 before eviction');
+    cache.set(keys[3], cacheResult(3));
+    cache.set(keys[4], cacheResult(4));
+    expect(cache.bytes <= cache.maxBytes, true, `${cache.bytes} bytes within maxBytes`);
+    expect(await cache.get(keys[1]), undefined, 'least recently used entry 1');
+    expect(await cache.get(keys[2]), undefined, 'least recently used entry 2');
+    expect((await cache.get(keys[0])).output, cacheResult(0).output, 'recently read entry 0');
+    expect(cache.counters.evictions, 2, 'evictions counter');
+  }],
+  ['a new instance answers from the disk tier', async () => withTempDir(async (dir) => {
+    const first = new ResultCache({ dir });
+    const key = first.key('Lexer', 'mode', 'int x = 1;');
+    first.set(key, cacheResult(1));
+    await until(() => first.disk.has(key));
+    const second = new ResultCache({ dir });
+    expect(JSON.stringify(await second.get(key)), JSON.stringify(cacheResult(1)), 'disk entry');
+    expect(second.counters.diskHits, 1, 'diskHits counter');
+    expect(JSON.stringify(await second.get(key)), JSON.stringify(cacheResult(1)), 'entry promoted to memory');
+    expect(second.counters.hits, 1, 'hits counter');
+  })],
+  ['the disk tier is pruned to maxDiskBytes, oldest first', async () => withTempDir(async (dir) => {
+    const fileBytes = JSON.stringify(cacheResult(0)).length;
+    const cache = new ResultCache({ dir, maxBytes: 0, maxDiskBytes: fileBytes * 4, pruneDelayMs: 10 });
+    const keys = [];
+    for (let i = 0; i < 8; i++) {
+      keys.push(cache.key('Parser', 'mode', `source ${i}`));
+      cache.set(keys[i], cacheResult(i));
+      await until(() => cache.disk.has(keys[i]));
+    }
+    await until(() => cache.pruneTimer === null && cache.diskBytes <= cache.maxDiskBytes);
+    const files = cacheFiles(dir);
+    expect(files.length, cache.disk.size, 'files on disk against the index');
+    expect(files.length * fileBytes <= cache.maxDiskBytes, true, `${files.length} files within maxDiskBytes`);
+    expect(files.includes(`${keys[7]}.json`), true, 'newest entry kept');
+    expect(files.includes(`${keys[0]}.json`), false, 'oldest entry pruned');
+    expect(await new ResultCache({ dir, maxBytes: 0 }).get(keys[0]), undefined, 'pruned entry after a restart');
+  })],
+  ['keys change with the tool, the source, the arguments and the binary', async () => withTempDir(async (dir) => {
+    const cache = new ResultCache();
+    const binary = path.join(dir, 'lexer');
+    fs.writeFileSync(binary, 'build 1');
+    const key = (tool, args, source) => cache.key(tool, binaryMode(binary, args), source);
+    const base = key('Lexer', [], 'int x;');
+    expect(key('Lexer', [], 'int x;'), base, 'same run');
+    expect(key('Parser', [], 'int x;') !== base, true, 'other tool');
+    expect(key('Lexer', [], 'int y;') !== base, true, 'other source');
+    expect(key('Lexer', ['--columns'], 'int x;') !== base, true, 'other arguments');
+    expect(key('Lexer', ['--cache=/tmp/a.pc', '--cache-max-bytes=1'], 'int x;'), base, 'cache location arguments');
+    fs.writeFileSync(binary, 'build 2, longer');
+    expect(key('Lexer', [], 'int x;') !== base, true, 'rebuilt binary of another size');
+    const sameSize = key('Lexer', [], 'int x;');
+    fs.utimesSync(binary, new Date(2000, 0, 1), new Date(2000, 0, 1));
+    expect(key('Lexer', [], 'int x;') !== sameSize, true, 'binary with another mtime');
+  })],
+];
+
+function collectStream(stream) {
+  return new Promise((resolve, reject) => {
+    const chunks = [];
+    stream.on('data', (chunk) => chunks.push(Buffer.from(chunk)));
+    stream.on('end', () => resolve(Buffer.concat(chunks).toString()));
+    stream.on('error', reject);
+  });
+}
+
+// Feed output to a RecordStream in chunks of chunkSize bytes
+function streamRecords(toRecord, output, chunkSize, last) {
+  const records = new RecordStream(toRecord, async () => last);
+  const text = collectStream(records);
+  for (let at = 0; at < output.length; at += chunkSize) records.write(output.subarray(at, at + chunkSize));
+  records.end();
+  return text;
+}
+
+// What the stream must print: one record per complete line, then the end record
+function expectedRecords(toRecord, output, last) {
+  const lines = output.toString().split('\n');
+  if (lines[lines.length - 1] === '') lines.pop();
+  return lines.map(toRecord).filter((record) => record !== null).map((record) => `${record}\n`).join('') +
+    `${JSON.stringify(last)}\n`;
+}
+
+// Multi-byte characters in a lexeme and in the program output, and two diagnostics
+const RECORD_SOURCE = Buffer.from('execute() {\n  string s = "h\u00e9llo \u2192 w\u00f6rld";\n  display(s);\n  int q = 1 === 2;\n}\nexit;\n');
+const RECORD_CHUNKS = [1, 2, 3, 7, 64, 1 << 20];
+const END_RECORD = { type: 'end', success: true };
+
+function checkChunkings(toRecord, output) {
+  const expected = expectedRecords(toRecord, output, END_RECORD);
+  return Promise.all(RECORD_CHUNKS.map(async (size) => {
+    expect(await streamRecords(toRecord, output, size, END_RECORD), expected, `records from ${size}-byte chunks`);
+  }));
+}
+
+const RECORD_CASES = [
+  ['lexer rows split across chunks', async (bins) => {
+    for (const args of [[], ['--columns']]) {
+      const output = spawnSync(bins.lexer, args, { input: RECORD_SOURCE }).stdout;
+      await checkChunkings(lexerRecord, output);
+      const records = (await streamRecords(lexerRecord, output, 5, END_RECORD)).trim().split('\n').map((line) => JSON.parse(line));
+      const string = records.find((r) => r.tokenType === 'STRING');
+      expect(string.lexeme, '"h\u00e9llo \u2192 w\u00f6rld"', `string lexeme (${args.join(' ') || 'no options'})`);
+      expect(string.column, args.length ? 14 : undefined, `string column (${args.join(' ') || 'no options'})`);
+      expect(JSON.stringify(records[records.length - 1]), JSON.stringify(END_RECORD), 'end record');
+    }
+  }],
+  ['parser diagnostics and output split across chunks', async (bins) => {
+    const output = spawnSync(bins.parser, [], { input: RECORD_SOURCE }).stdout;
+    await checkChunkings(parserRecord, output);
+    const records = (await streamRecords(parserRecord, output, 3, END_RECORD)).trim().split('\n').map((line) => JSON.parse(line));
+    const diagnostics = records.filter((r) => r.type === 'diagnostic');
+    expect(JSON.stringify(diagnostics[0]), JSON.stringify({ type: 'diagnostic', kind: 'Syntax Error', line: 4, message: "Invalid operator '==='" }), 'first diagnostic');
+    expect(diagnostics.length, 2, 'diagnostic records');
+  }],
+  ['a last line without a newline is still a record', async () => {
+    const output = Buffer.from('[Type Error] Line 2: no newline \u00e9');
+    const expected = `${parserRecord(output.toString())}\n${JSON.stringify(END_RECORD)}\n`;
+    for (const size of RECORD_CHUNKS) expect(await streamRecords(parserRecord, output, size, END_RECORD), expected, `${size}-byte chunks`);
+  }],
+  ['a killed run ends with success: false after the rows it printed', async (bins) => {
+    // The lexer waits for more source on an open stdin until it is killed
+    const controller = new AbortController();
+    const child = spawn(bins.lexer, ['--stream', '--stream-block=64'], { signal: controller.signal, killSignal: 'SIGKILL' });
+    child.on('error', () => {});
+    const closed = new Promise((resolve) => child.on('close', (status, signal) => resolve(signal)));
+    const records = new RecordStream(lexerRecord, async () => {
+      const signal = await closed;
+      return signal ? { type: 'end', success: false, error: `killed by ${signal}` } : END_RECORD;
+    });
+    const text = collectStream(child.stdout.pipe(records));
+    records.once('data', () => controller.abort());
+    child.stdin.write('int x = 1;\n'.repeat(100));
+    const lines = (await text).trim().split('\n').map((line) => JSON.parse(line));
+    expect(lines.length > 1, true, 'token records before the kill');
+    expect(lines[0].type, 'token', 'first record');
+    expect(JSON.stringify(lines[lines.length - 1]), JSON.stringify({ type: 'end', success: false, error: 'killed by SIGKILL' }), 'end record');
+  }],
+];
+
+const BATCH_CASES = [
+  ['--files-from frames match one run per file', async (bins) => withTempDir(async (dir) => {
+    const sources = [
+      fs.readFileSync(path.join(TESTS_DIR, 'test1.txt')),
+      RECORD_SOURCE,
+      fs.readFileSync(path.join(TESTS_DIR, 'test4_error.txt')),
+    ];
+    const files = sources.map((source, i) => {
+      const file = path.join(dir, `case ${i}.txt`); // a space in the path, as the path ends the header
+      fs.writeFileSync(file, source);
+      return file;
+    });
+    const listFile = path.join(dir, 'files.txt');
+    fs.writeFileSync(listFile, [...files, path.join(dir, 'missing.txt')].join('\n'));
+    for (const tool of ['lexer', 'parser']) {
+      const entries = parseBatchOutput(spawnSync(bins[tool], [`--files-from=${listFile}`]).stdout);
+      expect(entries.length, files.length + 1, `${tool} frames`);
+      sources.forEach((source, i) => {
+        expect(entries[i].output, spawnSync(bins[tool], [], { input: source }).stdout.toString(), `${tool} output of case ${i}`);
+      });
+      expect(entries[files.length].status, 2, `${tool} status of a missing file`);
+    }
+  })],
+  ['malformed frames are rejected', async () => {
+    const frame = Buffer.from('#### FILE 0 0 6 a.txt\nh\u00e9ll\n');
+    expect(JSON.stringify(parseBatchOutput(frame)), JSON.stringify([{ status: 0, output: 'h\u00e9ll\n' }]), 'a well-formed frame');
+    expectThrows(() => parseBatchOutput(Buffer.from('#### FILE 0 0 0 a.txt')), /without a newline/, 'a header without a newline');
+    expectThrows(() => parseBatchOutput(Buffer.concat([frame, Buffer.from('#### FILE 1 0 0 b.txt')])), /without a newline/, 'a second header without a newline');
+    expectThrows(() => parseBatchOutput(frame.subarray(0, frame.length - 1)), /cut short/, 'a frame cut short');
+    expectThrows(() => parseBatchOutput(Buffer.from('Error: Cannot read file list\n')), /Malformed/, 'output that is not framed');
+  }],
+];
+
+// -----------------------------
+//  DIFFERENTIAL MODE
+// -----------------------------
+// Builds the sources of an older revision (or takes two explicit binaries) and
+// compares both builds on freshly generated random programs.
+
+function buildRevision(rev) {
+  const outDir = fs.mkdtempSync(path.join(os.tmpdir(), 'cnack-rev-'));
+  for (const file of ['lexer.c', 'parser.c']) {
+    const show = spawnSync('git', ['show', `${rev}:backend/${file}`], { cwd: BACKEND_DIR, maxBuffer: 64 * 1024 * 1024 });
+    if (show.status !== 0) throw new Error(`git show ${rev}:backend/${file} failed: ${show.stderr}`);
+    fs.writeFileSync(path.join(outDir, file), show.stdout);
+  }
+  const exe = process.platform === 'win32' ? '.exe' : '';
+  const result = {};
+  for (const [tool, libs] of [['lexer', ['-pthread']], ['parser', ['-lm', '-pthread']]]) {
+    const output = path.join(outDir, tool + exe);
+    const cc = spawnSync('gcc', ['-O2', path.join(outDir, `${tool}.c`), '-o', output, ...libs], { encoding: 'utf8' });
+    if (cc.status !== 0) throw new Error(`gcc failed for ${rev}:${tool}.c\n${cc.stderr}`);
+    result[tool] = output;
+  }
+  return result;
+}
+
+function differential(args) {
+  const current = ensureBinaries();
+  const oldBins = args['old-rev'] ? buildRevision(args['old-rev'])
+    : { lexer: args['old-lexer'], parser: args['old-parser'] };
+  const newBins = { lexer: args['new-lexer'] || current.lexer, parser: args['new-parser'] || current.parser };
+  if (!oldBins.lexer || !oldBins.parser) {
+    console.error('Differential mode needs --old-rev or both --old-lexer and --old-parser');
+    return 2;
+  }
+
+  const cases = parseInt(args.cases || '200', 10);
+  const seed = parseInt(args.seed || String(Date.now() % 100000), 10);
+  let mismatches = 0;
+
+  for (let i = 0; i < cases; i++) {
+    const caseSeed = seed + i;
+    const input = Buffer.from(fuzzProgram(caseSeed, { snippets: 20, mutations: 12 }));
+    for (const tool of ['lexer', 'parser']) {
+      const before = run(oldBins[tool], input);
+      const after = run(newBins[tool], input);
+      if (before !== after) {
+        mismatches++;
+        const saved = path.join(os.tmpdir(), `cnack-diff-${caseSeed}.txt`);
+        fs.writeFileSync(saved, input);
+        console.log(`MISMATCH seed=${caseSeed} (${tool}) input saved to ${saved}\n${describeDiff(before, after)}`);
+      }
+    }
+  }
+  console.log(`\n${cases} random programs (seed ${seed}), ${mismatches} mismatching outputs`);
+  return mismatches ? 1 : 0;
+}
+
+async function main() {
+  const args = parseArgs(process.argv.slice(2));
+  if (args['regen-fuzz']) {
+    regenerateFuzz();
+    return 0;
+  }
+  if (args.differential) return differential(args);
+  const bins = {
+    lexer: args.lexer || ensureBinaries().lexer,
+    parser: args.parser || ensureBinaries().parser,
+  };
+  const status = checkGoldens(bins, !!args.update);
+  if (args.update) return status;
+  const emitted = checkEmitC(bins);
+  const jit = checkJit(bins);
+  const lsp = checkLsp(bins, ensureBinaries().lsp);
+  const addons = await checkAddons(bins);
+  const scheduler = await checkUnits('scheduler', SCHEDULER_CASES);
+  const cache = await checkUnits('result cache', CACHE_CASES);
+  const records = await checkUnits('record stream', RECORD_CASES, bins);
+  const batch = await checkUnits('batch output', BATCH_CASES, bins);
+  return addons || scheduler || cache || records || batch || emitted || jit || lsp || status;
+}
+
+main().then((status) => { process.exitCode = status; });
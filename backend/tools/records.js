@@ -0,0 +1,95 @@
+// -----------------------------
+//  NDJSON RECORD STREAMS
+// -----------------------------
+// Turns the line-oriented output of the lexer and parser into one JSON record per line
+// while the binary is still printing it. Used by the streaming endpoints in server.js,
+// which also splits the framed output of --files-from batches here.
+
+const { Transform } = require('stream');
+
+// Each function turns one output line into the text of its record, or null to skip the line.
+// Token rows are the bulk of a large answer, so they are cut with indexOf and written
+// without building an object first.
+
+// "LINE | [COL |] TYPE | lexeme" rows of the token table; frame and header lines are skipped.
+// The numbers and the type name never contain spaces, so they end at the first one.
+function lexerRecord(line) {
+  const first = line.charCodeAt(0);
+  if (!(first >= 48 && first <= 57)) return null;
+  const lineEnd = line.indexOf(' ');
+  let at = line.indexOf(' | ', lineEnd) + 3;
+  let column = '';
+  const next = line.charCodeAt(at);
+  if (next >= 48 && next <= 57) {
+    const columnEnd = line.indexOf(' ', at);
+    column = `,"column":${line.slice(at, columnEnd)}`;
+    at = line.indexOf(' | ', columnEnd) + 3;
+  }
+  const typeEnd = line.indexOf(' ', at);
+  const lexeme = line.slice(line.indexOf(' | ', typeEnd) + 3);
+  return `{"type":"token","line":${line.slice(0, lineEnd)}${column},"tokenType":"${line.slice(at, typeEnd)}","lexeme":${JSON.stringify(lexeme)}}`;
+}
+
+const DIAGNOSTIC = /^\[([A-Za-z ]+)\] Line (-?\d+): (.*)$/;
+
+function parserRecord(line) {
+  const diagnostic = DIAGNOSTIC.exec(line);
+  if (diagnostic) {
+    return JSON.stringify({ type: 'diagnostic', kind: diagnostic[1], line: +diagnostic[2], message: diagnostic[3] });
+  }
+  return JSON.stringify({ type: 'output', text: line });
+}
+
+// Bytes in, NDJSON out. Each chunk is decoded up to its last newline, so a multi-byte
+// character is never cut in half; finish() resolves to the last record once the input ends.
+class RecordStream extends Transform {
+  constructor(toRecord, finish) {
+    super();
+    this.toRecord = toRecord;
+    this.finish = finish;
+    this.rest = null;
+  }
+
+  _transform(chunk, encoding, callback) {
+    const data = this.rest ? Buffer.concat([this.rest, chunk]) : chunk;
+    const end = data.lastIndexOf(10);
+    this.rest = end + 1 < data.length ? data.subarray(end + 1) : null;
+    if (end !== -1) {
+      let out = '';
+      for (const line of data.toString('utf8', 0, end).split('\n')) out += this.format(line);
+      if (out) this.push(out);
+    }
+    callback();
+  }
+
+  _flush(callback) {
+    const tail = this.rest ? this.format(this.rest.toString()) : '';
+    if (tail) this.push(tail);
+    this.finish().then((last) => callback(null, `${JSON.stringify(last)}\n`), callback);
+  }
+
+  format(line) {
+    const record = this.toRecord(line);
+    return record === null ? '' : `${record}\n`;
+  }
+}
+
+// Split the "#### FILE <index> <status> <bytes> <path>" frames of a --files-from run into
+// { status, output } in frame order. stdout is a Buffer, as <bytes> counts bytes.
+function parseBatchOutput(stdout) {
+  const entries = [];
+  let pos = 0;
+  while (pos < stdout.length) {
+    const eol = stdout.indexOf(10, pos);
+    if (eol === -1) throw new Error('Malformed batch output: frame header without a newline');
+    const header = /^#### FILE (\d+) (\d+) (\d+) /.exec(stdout.subarray(pos, eol).toString());
+    if (!header) throw new Error('Malformed batch output');
+    const bytes = parseInt(header[3], 10);
+    if (eol + 1 + bytes > stdout.length) throw new Error('Malformed batch output: frame cut short');
+    entries.push({ status: parseInt(header[2], 10), output: stdout.subarray(eol + 1, eol + 1 + bytes).toString() });
+    pos = eol + 1 + bytes;
+  }
+  return entries;
+}
+
+module.exports = { RecordStream, lexerRecord, parserRecord, parseBatchOutput };
@@ -0,0 +1,131 @@
+// -----------------------------
+//  ANALYZER SCHEDULER
+// -----------------------------
+// Admission control for lexer and parser runs. At most `concurrency` jobs run at once
+// (one per core by default) and the rest wait in a FIFO queue of bounded length, each
+// for at most maxWaitMs. A running job gets an AbortSignal that fires when it exceeds
+// runTimeoutMs or when its caller goes away; spawn() kills the child on that signal.
+// The job keeps its slot until it has really finished, so a killed child is never
+// replaced before it has exited.
+
+const os = require('os');
+
+class SchedulerError extends Error {
+  // code: QUEUE_FULL, QUEUE_TIMEOUT, TIMEOUT or CANCELLED
+  constructor(code, message) {
+    super(message);
+    this.code = code;
+  }
+}
+
+class Scheduler {
+  constructor({ concurrency = defaultConcurrency(), maxQueue = 64, maxWaitMs = 10000, runTimeoutMs = 30000 } = {}) {
+    this.concurrency = Math.max(1, concurrency);
+    this.maxQueue = maxQueue;
+    this.maxWaitMs = maxWaitMs;
+    this.runTimeoutMs = runTimeoutMs;
+    this.running = 0;
+    this.queue = []; // waiting entries, oldest first
+    this.counters = { admitted: 0, completed: 0, rejected: 0, expired: 0, cancelled: 0, timedOut: 0, maxQueued: 0 };
+    this.totalWaitMs = 0;
+  }
+
+  // Run job(signal) when a slot is free; settles like the job, or with a SchedulerError
+  run(job, { signal } = {}) {
+    return new Promise((resolve, reject) => {
+      const entry = { job, signal, resolve, reject, queuedAt: Date.now(), timer: null, onAbort: null };
+      if (signal && signal.aborted) {
+        this.counters.cancelled++;
+        return reject(new SchedulerError('CANCELLED', 'The client went away'));
+      }
+      if (this.running < this.concurrency) return this.start(entry);
+      if (this.queue.length >= this.maxQueue) {
+        this.counters.rejected++;
+        return reject(new SchedulerError('QUEUE_FULL', `The analyzers are busy (${this.queue.length} requests waiting)`));
+      }
+
+      if (this.maxWaitMs > 0) {
+        entry.timer = setTimeout(() => this.drop(entry, 'expired',
+          new SchedulerError('QUEUE_TIMEOUT', `No analyzer became free within ${this.maxWaitMs} ms`)), this.maxWaitMs);
+      }
+      if (signal) {
+        entry.onAbort = () => this.drop(entry, 'cancelled', new SchedulerError('CANCELLED', 'The client went away'));
+        signal.addEventListener('abort', entry.onAbort, { once: true });
+      }
+      this.queue.push(entry);
+      this.counters.maxQueued = Math.max(this.counters.maxQueued, this.queue.length);
+    });
+  }
+
+  drop(entry, counter, error) {
+    const index = this.queue.indexOf(entry);
+    if (index === -1) return;
+    this.queue.splice(index, 1);
+    this.detach(entry);
+    this.counters[counter]++;
+    entry.reject(error);
+  }
+
+  detach(entry) {
+    clearTimeout(entry.timer);
+    if (entry.onAbort) entry.signal.removeEventListener('abort', entry.onAbort);
+  }
+
+  start(entry) {
+    this.detach(entry);
+    this.running++;
+    this.counters.admitted++;
+    this.totalWaitMs += Date.now() - entry.queuedAt;
+
+    // The caller hears about a timeout or cancellation at once; the slot frees when the job settles
+    const controller = new AbortController();
+    let settled = false;
+    const settle = (error, value) => {
+      if (settled) return;
+      settled = true;
+      if (error) entry.reject(error);
+      else entry.resolve(value);
+    };
+    const abort = (counter, error) => {
+      if (settled) return;
+      this.counters[counter]++;
+      controller.abort(error);
+      settle(error);
+    };
+    const timer = this.runTimeoutMs > 0 ? setTimeout(() => abort('timedOut',
+      new SchedulerError('TIMEOUT', `The analysis did not finish within ${this.runTimeoutMs} ms`)), this.runTimeoutMs) : null;
+    const onAbort = () => abort('cancelled', new SchedulerError('CANCELLED', 'The client went away'));
+    if (entry.signal) entry.signal.addEventListener('abort', onAbort, { once: true });
+
+    Promise.resolve()
+      .then(() => entry.job(controller.signal))
+      .then((value) => settle(null, value), (error) => settle(error))
+      .finally(() => {
+        clearTimeout(timer);
+        if (entry.signal) entry.signal.removeEventListener('abort', onAbort);
+        this.counters.completed++;
+        this.running--;
+        const next = this.queue.shift();
+        if (next) this.start(next);
+      });
+  }
+
+  stats() {
+    return {
+      concurrency: this.concurrency,
+      running: this.running,
+      queued: this.queue.length,
+      maxQueue: this.maxQueue,
+      maxWaitMs: this.maxWaitMs,
+      runTimeoutMs: this.runTimeoutMs,
+      ...this.counters,
+      avgWaitMs: this.counters.admitted ? this.totalWaitMs / this.counters.admitted : 0,
+    };
+  }
+}
+
+function defaultConcurrency() {
+  return typeof os.availableParallelism === 'function' ? os.availableParallelism() : os.cpus().length;
+}
+
+module.exports = { Scheduler, SchedulerError };
@@ -0,0 +1,69 @@
+// -----------------------------
+//  TOKEN STREAMS AND DELTAS
+// -----------------------------
+// Reads the records printed by `lexer --emit-tokens` and applies the delta printed by
+// `lexer --incremental=FILE --edit=OFFSET,REMOVED,INSERTED` to a previous stream, and
+// the highlighting data of `lexer --semantic-tokens`.
+// Shared by server.js (incremental and semantic endpoints) and tools/golden.js (consistency check).
+
+// Parse "#CNACK-TOKENS bytes count" followed by "offset length TYPE line" records
+function parseTokenStream(text) {
+  const lines = text.split('\n');
+  const header = /^#CNACK-TOKENS (\d+) (\d+)$/.exec(lines[0]);
+  if (!header) throw new Error('Not a token stream');
+  const count = parseInt(header[2], 10);
+  return { bytes: parseInt(header[1], 10), tokens: parseRecords(lines, 1, count) };
+}
+
+function parseRecords(lines, from, count) {
+  const tokens = [];
+  for (let i = from; i < from + count; i++) {
+    const parts = (lines[i] || '').split(' ');
+    if (parts.length !== 4) throw new Error(`Malformed token record: '${lines[i]}'`);
+    tokens.push({ offset: +parts[0], length: +parts[1], type: parts[2], line: +parts[3] });
+  }
+  return tokens;
+}
+
+function formatTokenStream(stream) {
+  const records = stream.tokens.map((t) => `${t.offset} ${t.length} ${t.type} ${t.line}\n`);
+  return `#CNACK-TOKENS ${stream.bytes} ${stream.tokens.length}\n${records.join('')}`;
+}
+
+// Parse "#CNACK-DELTA first removed inserted offset_shift line_shift" and its records
+function parseDelta(text) {
+  const lines = text.split('\n');
+  const header = /^#CNACK-DELTA (\d+) (\d+) (\d+) (-?\d+) (-?\d+)$/.exec(lines[0]);
+  if (!header) throw new Error('Not a token delta');
+  const [first, removed, inserted, offsetShift, lineShift] = header.slice(1).map((n) => parseInt(n, 10));
+  return { first, removed, offsetShift, lineShift, tokens: parseRecords(lines, 1, inserted) };
+}
+
+// Return the stream for the edited source; the previous stream is left untouched
+function applyDelta(stream, delta, bytes) {
+  const tail = stream.tokens.slice(delta.first + delta.removed).map((t) => ({
+    ...t, offset: t.offset + delta.offsetShift, line: t.line + delta.lineShift,
+  }));
+  return {
+    bytes,
+    tokens: stream.tokens.slice(0, delta.first).concat(delta.tokens, tail),
+  };
+}
+
+// Parse "#CNACK-SEMANTIC count class..." and its "delta_line delta_column length class" lines
+// into the class names and one flat array of four numbers per token
+function parseSemanticTokens(text) {
+  const lines = text.split('\n');
+  const header = /^#CNACK-SEMANTIC (\d+) (.*)$/.exec(lines[0]);
+  if (!header) throw new Error('Not a semantic token list');
+  const count = parseInt(header[1], 10);
+  const data = new Array(count * 4);
+  for (let i = 0; i < count; i++) {
+    const parts = (lines[i + 1] || '').split(' ');
+    if (parts.length !== 4) throw new Error(`Malformed semantic token: '${lines[i + 1]}'`);
+    for (let k = 0; k < 4; k++) data[i * 4 + k] = +parts[k];
+  }
+  return { legend: header[2].split(' '), data };
+}
+
+module.exports = { parseTokenStream, formatTokenStream, parseDelta, applyDelta, parseSemanticTokens };
@@ -11,7 +11,7 @@ const runLexicalAnalysis = async (code) => {
   const response = await fetch(`${API_URL}/lexical`, {
     method: "POST",
     headers: { "Content-Type": "application/json" },
-    body: JSON.stringify({ code }),
+    body: JSON.stringify({ code, columns: true }),
   })
   if (!response.ok) {
     const error = await response.json()
@@ -35,6 +35,80 @@ const runSyntaxAnalysis = async (code) => {
   return response.json()
 }
 
+// Highlighting from the real lexer: { legend, data } with four numbers per token
+// (line delta, column delta, length, class), as LSP semantic tokens
+const fetchSemanticTokens = async (code, signal) => {
+  const response = await fetch(`${API_URL}/lexical/semantic`, {
+    method: "POST",
+    headers: { "Content-Type": "application/json" },
+    body: JSON.stringify({ code }),
+    signal,
+  })
+  const result = await response.json()
+  if (!response.ok || !result.success) throw new Error(result.error || result.output || "Highlighting failed")
+  return result
+}
+
+// Turn the delta-encoded tokens into absolute { start, end, kind } spans of code
+const decodeSemanticTokens = (code, { legend, data }) => {
+  const lineStarts = [0]
+  for (let i = code.indexOf("\n"); i !== -1; i = code.indexOf("\n", i + 1)) lineStarts.push(i + 1)
+  const spans = []
+  for (let i = 0, line = 0, column = 0; i < data.length; i += 4) {
+    line += data[i]
+    column = data[i] ? data[i + 1] : column + data[i + 1]
+    const start = lineStarts[line] + column
+    spans.push({ start, end: start + data[i + 2], kind: legend[data[i + 3]] })
+  }
+  return spans
+}
+
+// While a newer answer is on its way, spans outside the edited part of the text still apply
+const shiftSpans = (highlight, code) => {
+  if (!highlight) return []
+  const old = highlight.code
+  if (old === code) return highlight.spans
+  let prefix = 0
+  const max = Math.min(old.length, code.length)
+  while (prefix < max && old[prefix] === code[prefix]) prefix++
+  let suffix = 0
+  while (suffix < max - prefix && old[old.length - 1 - suffix] === code[code.length - 1 - suffix]) suffix++
+  const shift = code.length - old.length
+  const spans = []
+  for (const span of highlight.spans) {
+    if (span.end <= prefix) spans.push(span)
+    else if (span.start >= old.length - suffix) spans.push({ ...span, start: span.start + shift, end: span.end + shift })
+  }
+  return spans
+}
+
+// Fallback when the server cannot highlight: the same classes from a regular expression.
+// The word lists follow keywords[] in backend/lexer.c.
+const LOCAL_TOKEN = /\/\/[^\n]*|\/\*[\s\S]*?\*\/|"(?:\\.|[^\\"\n])*"|\d+(?:\.\d+)?|[A-Za-z_]\w*|<<|>>|==|!=|<=|>=|&&|\|\||->|\*\||[()[\]{};,:]|[-+*/%^<>&!|=]/g
+const LOCAL_TYPES = new Set(["int", "float", "char", "bool", "string"])
+const LOCAL_KEYWORDS = new Set(["const", "if", "else", "elif", "switch", "case", "default", "assign", "struct", "for", "while", "do",
+  "break", "continue", "ask", "display", "execute", "exit", "true", "false", "fetch", "fn", "when", "otherwise"])
+
+const localSpans = (code) => {
+  const spans = []
+  for (const match of code.matchAll(LOCAL_TOKEN)) {
+    const word = match[0]
+    let kind = "operator"
+    if (word.startsWith("//") || word.startsWith("/*")) kind = "comment"
+    else if (word.startsWith('"')) kind = "string"
+    else if (/^\d/.test(word)) kind = "number"
+    else if (LOCAL_TYPES.has(word)) kind = "type"
+    else if (LOCAL_KEYWORDS.has(word)) kind = "keyword"
+    else if (word === "auto_ref") kind = "builtin"
+    else if (/^\w/.test(word)) kind = "variable"
+    else if (/^[()[\]{};,:]$/.test(word)) kind = "punctuation"
+    spans.push({ start: match.index, end: match.index + word.length, kind })
+  }
+  return spans
+}
+
+const HIGHLIGHT_DELAY_MS = 120
+
 // ===========================
 // 2. COMPONENTS
 // ===========================
@@ -119,38 +193,45 @@ const CodeEditor = ({ value, onChange, disabled, darkMode }) => {
     }
   };
 
-  const renderHighlightedCode = () => {
-    const words = value.split(/(\/\/[^\n]*|\/\*[\s\S]*?\*\/|"(?:\\.|[^\\"])*"|\s+|<<|>>|==|!=|<=|>=|&&|\|\||\*\||[()\[\]{};,:]|[-+*/%<>&!|=])/);
-    
-    return words.map((word, i) => {
-      if (!word) return null;
-      
-      let color = darkMode ? "#e2e8f0" : "#0f4687"; 
-
-      if (word.startsWith('"')) {
-        return <span key={i} style={{ color: "#80a6c0ff" }}>{word}</span>;
-      }
-      if (word.startsWith("//") || word.startsWith("/*")) {
-        color = "#6272a4"; 
-      } 
-      else if (/^(int|string|float|char|double|boolean|void|if|else|elif|switch|case|default|assign|otherwise|while|for|do|break|continue|return|execute|exit|const|ask|display|true|false|fetch|when|fn)$/.test(word)) {
-        color = "#437ae6ff"; 
-      } 
-      else if (/^(auto_ref)$/.test(word)) {
-        color = "#e6c643";
-      }
-      else if (!isNaN(word) && word.trim() !== "") {
-        color = "#bd93f9"; 
-      } 
-      else if (/^(\(|\)|\{|\}|\[|\]|;|,|:)$/.test(word)) {
-        color = darkMode ? "#6290d0ff" : "#4a89c6"; 
-      } 
-      else if (/^(=|\+|-|\*|\/|%|<|>|&|!|<<|>>|==|!=|<=|>=|&&|\|\||\*\|)$/.test(word)) {
-        color = "#b63388ff"; 
-      }
+  // Ask the lexer for tokens once typing pauses; a newer edit cancels the request in flight
+  const [highlight, setHighlight] = useState(null);
+  useEffect(() => {
+    if (!value) return;
+    const request = new AbortController();
+    const timer = setTimeout(() => {
+      fetchSemanticTokens(value, request.signal)
+        .then((tokens) => setHighlight({ code: value, spans: decodeSemanticTokens(value, tokens) }))
+        .catch((err) => {
+          if (request.signal.aborted) return
+          console.warn(`Semantic highlighting unavailable, using the local highlighter: ${err.message}`)
+          setHighlight({ code: value, spans: localSpans(value) })
+        })
+    }, HIGHLIGHT_DELAY_MS);
+    return () => { clearTimeout(timer); request.abort(); };
+  }, [value]);
 
-      return <span key={i} style={{ color }}>{word}</span>;
-    });
+  const renderHighlightedCode = () => {
+    const plain = darkMode ? "#e2e8f0" : "#0f4687";
+    const colors = {
+      keyword: "#437ae6ff",
+      type: "#437ae6ff",
+      builtin: "#e6c643",
+      number: "#bd93f9",
+      string: "#80a6c0ff",
+      comment: "#6272a4",
+      operator: "#b63388ff",
+      punctuation: darkMode ? "#6290d0ff" : "#4a89c6",
+    };
+
+    const parts = [];
+    let at = 0;
+    for (const span of shiftSpans(highlight, value)) {
+      if (span.start > at) parts.push(<span key={`t${at}`} style={{ color: plain }}>{value.slice(at, span.start)}</span>);
+      parts.push(<span key={span.start} style={{ color: colors[span.kind] || plain }}>{value.slice(span.start, span.end)}</span>);
+      at = span.end;
+    }
+    if (at < value.length) parts.push(<span key={`t${at}`} style={{ color: plain }}>{value.slice(at)}</span>);
+    return parts;
   };
 
   const sharedStyles = {
@@ -231,16 +312,23 @@ const Output = ({ output, error, loading, darkMode, activeTab }) => {
     const lines = out.split("\n");
     const tokens = []
     let startParsing = false
+    let hasColumns = false
     for (const line of lines) {
+      if (line.startsWith("LINE")) { hasColumns = line.includes("| COL"); continue }
       if (line.includes("-------|")) { startParsing = true; continue }
       if (startParsing && line.trim()) {
-        const first = line.indexOf("|")
-        const second = line.indexOf("|", first + 1)
-        if (first !== -1 && second !== -1) {
-          const lineNum = line.slice(0, first).trim()
-          const type = line.slice(first + 1, second).trim()
-          const lexeme = line.slice(second + 1).trim()
-          tokens.push({ line: lineNum, type, lexeme })
+        // LINE | [COL |] TOKEN TYPE | LEXEME, where the lexeme itself may contain '|'
+        const cells = []
+        let from = 0
+        for (let i = 0; i < (hasColumns ? 3 : 2); i++) {
+          const bar = line.indexOf("|", from)
+          if (bar === -1) break
+          cells.push(line.slice(from, bar).trim())
+          from = bar + 1
+        }
+        if (cells.length === (hasColumns ? 3 : 2)) {
+          const [lineNum, col, type] = hasColumns ? cells : [cells[0], "", cells[1]]
+          tokens.push({ line: lineNum, col, type, lexeme: line.slice(from).trim() })
         }
       }
     }
@@ -260,17 +348,17 @@ const Output = ({ output, error, loading, darkMode, activeTab }) => {
     if (filteredTokens.length > 0) {
         contentToRender = (
             <div style={{ background: darkMode ? "#28313b" : "#f8fafc", borderRadius: "8px", overflow: "hidden", border: `1px solid ${darkMode ? "#334155" : "#e0e7ff"}` }}>
-                <div style={{ display: "grid", gridTemplateColumns: "repeat(3, 1fr)", padding: "16px 20px", background: "#4a89c6", fontWeight: "600", fontSize: "12px", color: "#ffffff", textAlign: "center" }}>
-                <div>LINE</div><div>TOKEN TYPE</div><div>LEXEME</div>
+                <div style={{ display: "grid", gridTemplateColumns: "repeat(4, 1fr)", padding: "16px 20px", background: "#4a89c6", fontWeight: "600", fontSize: "12px", color: "#ffffff", textAlign: "center" }}>
+                <div>LINE</div><div>COL</div><div>TOKEN TYPE</div><div>LEXEME</div>
                 </div>
                 {filteredTokens.map((t, i) => (
                 <div key={i} style={{ 
-                    display: "grid", gridTemplateColumns: "repeat(3, 1fr)", padding: "12px 20px", 
+                    display: "grid", gridTemplateColumns: "repeat(4, 1fr)", padding: "12px 20px", 
                     background: i % 2 === 0 ? (darkMode ? "#1f2730" : "#ffffff") : (darkMode ? "#28313b" : "#f8fafc"), 
                     borderBottom: `1px solid ${darkMode ? "#334155" : "#e0e7ff"}`, 
                     fontSize: "13px", textAlign: "center", color: darkMode ? "#cbd5e1" : "#0f4687" 
                 }}>
-                    <div>{t.line}</div><div>{t.type}</div><div>{t.lexeme}</div>
+                    <div>{t.line}</div><div>{t.col}</div><div>{t.type}</div><div>{t.lexeme}</div>
                 </div>
                 ))}
             </div>